@@ -0,0 +1,146 @@
+// Copyright 2024 <github.com/razaqq>
+#pragma once
+
+#include "Client/DatabaseManager.hpp"
+
+#include "Core/Defer.hpp"
+#include "Core/Sqlite.hpp"
+#include "Core/ThreadPool.hpp"
+
+#include <QCoreApplication>
+#include <QMetaObject>
+#include <QObject>
+#include <QPointer>
+
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace PotatoAlert::Client {
+
+// Owns the connections to the match history database and runs every access to it off the calling thread.
+// Writes run one after another on a dedicated thread with the only writing connection.
+// Reads run on a pool of read-only connections, which WAL lets read next to the writer.
+// A read sees every write whose result was delivered before the read was queued.
+class DatabaseExecutor
+{
+public:
+	explicit DatabaseExecutor(const std::filesystem::path& path, size_t readerCount = 2);
+	// finishes every queued read and write, then vacuums the database
+	~DatabaseExecutor();
+
+	DatabaseExecutor(const DatabaseExecutor&) = delete;
+	DatabaseExecutor(DatabaseExecutor&&) = delete;
+	DatabaseExecutor& operator=(const DatabaseExecutor&) = delete;
+	DatabaseExecutor& operator=(DatabaseExecutor&&) = delete;
+
+	explicit operator bool() const
+	{
+		return m_writer != nullptr;
+	}
+
+	template<typename Func>
+	auto Read(Func&& func) -> std::future<std::invoke_result_t<Func&, const DatabaseManager&>>
+	{
+		using Ret = std::invoke_result_t<Func&, const DatabaseManager&>;
+
+		if (!m_readerPool)
+		{
+			return Write(std::forward<Func>(func));
+		}
+
+		return m_readerPool->Enqueue([this, func = std::forward<Func>(func)]() mutable -> Ret
+		{
+			std::unique_ptr<Connection> reader = TakeReader();
+			auto defer = Core::MakeDefer([this, &reader]()
+			{
+				ReturnReader(std::move(reader));
+			});
+			return func(reader->Manager);
+		});
+	}
+
+	template<typename Func>
+	auto Write(Func&& func) -> std::future<std::invoke_result_t<Func&, const DatabaseManager&>>
+	{
+		using Ret = std::invoke_result_t<Func&, const DatabaseManager&>;
+
+		auto task = std::make_shared<std::packaged_task<Ret()>>([this, func = std::forward<Func>(func)]() mutable -> Ret
+		{
+			return func(m_writer->Manager);
+		});
+		std::future<Ret> result = task->get_future();
+		Post([task]() { (*task)(); });
+		return result;
+	}
+
+	// Runs func on a reader and then calls then with its result on the gui thread.
+	// then is not called if the receiver was destroyed in the meantime.
+	template<typename Func, typename Then>
+	void Read(Func&& func, QObject* receiver, Then&& then)
+	{
+		Read(Deliver(std::forward<Func>(func), receiver, std::forward<Then>(then)));
+	}
+
+	// Runs func on the writer and then calls then with its result on the gui thread.
+	// then is not called if the receiver was destroyed in the meantime.
+	template<typename Func, typename Then>
+	void Write(Func&& func, QObject* receiver, Then&& then)
+	{
+		Write(Deliver(std::forward<Func>(func), receiver, std::forward<Then>(then)));
+	}
+
+private:
+	struct Connection
+	{
+		Core::SQLite Db;
+		DatabaseManager Manager;
+
+		explicit Connection(Core::SQLite&& db) : Db(std::move(db)), Manager(Db) {}
+	};
+
+	template<typename Func, typename Then>
+	static auto Deliver(Func&& func, QObject* receiver, Then&& then)
+	{
+		// the pointer is guarded on the calling thread, the receiver might already be gone once func finished
+		return [func = std::forward<Func>(func), receiver = QPointer<QObject>(receiver), then = std::forward<Then>(then)](const DatabaseManager& db) mutable
+		{
+			auto result = std::make_shared<std::invoke_result_t<Func&, const DatabaseManager&>>(func(db));
+			QMetaObject::invokeMethod(QCoreApplication::instance(), [receiver, then, result]() mutable
+			{
+				if (receiver)
+				{
+					then(std::move(*result));
+				}
+			}, Qt::QueuedConnection);
+		};
+	}
+
+	void Post(std::function<void()>&& task);
+	void RunWriter();
+	std::unique_ptr<Connection> TakeReader();
+	void ReturnReader(std::unique_ptr<Connection> reader);
+
+	std::unique_ptr<Connection> m_writer;
+	std::thread m_writerThread;
+	std::mutex m_writerMutex;
+	std::condition_variable m_writerCondition;
+	std::deque<std::function<void()>> m_writes;
+	bool m_stopping = false;
+
+	std::vector<std::unique_ptr<Connection>> m_readers;  // the ones not in use
+	std::mutex m_readerMutex;
+	std::condition_variable m_readerCondition;
+	std::unique_ptr<Core::ThreadPool> m_readerPool;
+};
+
+}  // namespace PotatoAlert::Client
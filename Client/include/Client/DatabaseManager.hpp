@@ -7,8 +7,14 @@
 
 #include "ReplayParser/ReplayParser.hpp"
 
+#include <cstdint>
 #include <expected>
+#include <limits>
+#include <optional>
+#include <span>
 #include <string>
+#include <utility>
+#include <vector>
 
 
 using PotatoAlert::Core::Result;
@@ -20,6 +26,7 @@ namespace PotatoAlert::Client {
 	X(std::string, Hash, TEXT UNIQUE)        \
 	X(std::string, ReplayName, TEXT)         \
 	X(std::string, Date, TEXT)               \
+	X(int64_t, Timestamp, INTEGER)           \
 	X(std::string, Ship, TEXT)               \
 	X(std::string, ShipNation, TEXT)         \
 	X(std::string, ShipClass, TEXT)          \
@@ -44,10 +51,54 @@ struct Match
 
 struct NonAnalyzedMatch
 {
+	uint32_t Id;
 	std::string Hash;
 	std::string ReplayName;
 };
 
+// Selects the matches shown in the match history, a column without a list of values is not filtered.
+struct MatchFilter
+{
+	std::optional<std::vector<std::string>> Ships;
+	std::optional<std::vector<std::string>> Maps;
+	std::optional<std::vector<std::string>> MatchGroups;
+	std::optional<std::vector<std::string>> StatsModes;
+	std::optional<std::vector<std::string>> Players;
+	std::optional<std::vector<std::string>> Regions;
+	int64_t From = std::numeric_limits<int64_t>::min();  // Timestamp
+	int64_t To = std::numeric_limits<int64_t>::max();  // Timestamp
+};
+
+// The position of a match in the match list, which is ordered by Timestamp and then Id, newest first.
+struct MatchListKey
+{
+	int64_t Timestamp;
+	uint32_t Id;
+};
+
+// A page of the match list together with the number of matches passing the filter, read from the same snapshot.
+struct MatchListPage
+{
+	uint32_t Count;
+	std::vector<MatchListKey> SkippedKeys;  // the keys of the pages that were skipped to get to this one
+	std::vector<Match> Matches;
+};
+
+// every distinct value of the columns the match history can be filtered by
+struct MatchFilterValues
+{
+	std::vector<std::string> Ships;
+	std::vector<std::string> Maps;
+	std::vector<std::string> MatchGroups;
+	std::vector<std::string> StatsModes;
+	std::vector<std::string> Players;
+	std::vector<std::string> Regions;
+};
+
+// Seconds since epoch of a match date in the format "dd.mm.yyyy HH:MM:SS", the date is read as UTC.
+// This is only used to sort matches, returns 0 if the date is malformed.
+int64_t GetMatchTimestamp(std::string_view date);
+
 using SqlError = std::string;
 template<typename T>
 using SqlResult = Result<T, SqlError>;
@@ -57,17 +108,32 @@ using SqlResult = Result<T, SqlError>;
 class DatabaseManager
 {
 public:
-	explicit DatabaseManager(Core::SQLite& db);
-	~DatabaseManager();
+	explicit DatabaseManager(Core::SQLite& db) : m_db(db) {}
 
+	// sets up the connection and brings the tables and indexes up to date, only needed on the writing connection
+	SqlResult<void> Initialize() const;
+	SqlResult<void> Vacuum() const;
 	SqlResult<void> CreateTables() const;
 	SqlResult<void> MigrateTables() const;
+	SqlResult<void> CreateIndexes() const;
 
-	// adds the match to db and set the id
+	// adds the match to db and set the id and the timestamp
 	[[nodiscard]] SqlResult<void> AddMatch(Match& match) const;
 	[[nodiscard]] SqlResult<std::optional<Match>> GetMatch(uint32_t id) const;
 	[[nodiscard]] SqlResult<std::optional<Match>> GetMatch(std::string_view hash) const;
 	[[nodiscard]] SqlResult<std::vector<Match>> GetMatches() const;
+	// Gets up to count matches passing the filter, newest first, that come after the key or from the newest one without a key.
+	// The key of the last match is where the next page starts, so a page is read without stepping over the ones before it.
+	// The matches are only a list entry, Json and ArenaInfo are empty and only the Outcome of the ReplaySummary is set.
+	[[nodiscard]] SqlResult<std::vector<Match>> GetMatchList(const MatchFilter& filter, std::optional<MatchListKey> after, uint32_t count) const;
+	// Gets the key of the count-th match passing the filter after the key, which skips a page without reading its matches.
+	// Returns nullopt if fewer matches follow.
+	[[nodiscard]] SqlResult<std::optional<MatchListKey>> GetMatchListKey(const MatchFilter& filter, std::optional<MatchListKey> after, uint32_t count) const;
+	[[nodiscard]] SqlResult<uint32_t> GetMatchCount(const MatchFilter& filter) const;
+	// Reads the count and the page that starts skip pages after the key in one transaction, so a write in between does not show in only one of them.
+	// The page is empty if it is past the last match.
+	[[nodiscard]] SqlResult<MatchListPage> GetMatchListPage(const MatchFilter& filter, std::optional<MatchListKey> after, size_t skip, uint32_t count) const;
+	[[nodiscard]] SqlResult<MatchFilterValues> GetMatchFilterValues() const;
 	[[nodiscard]] SqlResult<void> DeleteMatch(uint32_t id) const;
 	[[nodiscard]] SqlResult<void> DeleteMatch(std::string_view hash) const;
 	[[nodiscard]] SqlResult<void> DeleteMatches(std::span<uint32_t> ids) const;
@@ -81,6 +147,8 @@ public:
 	[[nodiscard]] SqlResult<std::optional<std::string>> GetMatchJson(std::string_view hash) const;
 	[[nodiscard]] SqlResult<void> SetMatchReplaySummary(uint32_t id, const ReplaySummary& replaySummary) const;
 	[[nodiscard]] SqlResult<void> SetMatchReplaySummary(std::string_view hash, const ReplaySummary& replaySummary) const;
+	// sets the summaries of many matches by id in a single transaction, none of them are set if one fails
+	[[nodiscard]] SqlResult<void> SetMatchReplaySummaries(std::span<const std::pair<uint32_t, ReplaySummary>> summaries) const;
 	[[nodiscard]] SqlResult<bool> MatchExists(uint32_t id) const;
 	[[nodiscard]] SqlResult<bool> MatchExists(std::string_view hash) const;
 
@@ -6,14 +6,20 @@
 #include "Core/ThreadPool.hpp"
 
 #include "ReplayParser/ReplayParser.hpp"
+#include "ReplayParser/SummaryCache.hpp"
 
 #include <QFileSystemWatcher>
 #include <QString>
 
 #include <chrono>
 #include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <unordered_set>
 #include <string>
+#include <string_view>
+#include <utility>
 
 
 namespace fs = std::filesystem;
@@ -33,7 +39,7 @@ class ReplayAnalyzer : public QObject
 
 public:
 	ReplayAnalyzer(const ServiceProvider& serviceProvider, const fs::path& gameFilePath)
-		: m_services(serviceProvider), m_gameFilePath(gameFilePath)
+		: m_services(serviceProvider), m_summaryCache(gameFilePath / "summaries.bin"), m_gameFilePath(gameFilePath)
 	{
 		qRegisterMetaType<uint32_t>("uint32_t");
 		qRegisterMetaType<ReplaySummary>("ReplaySummary");
@@ -46,9 +52,17 @@ public:
 	static ReplayResult<void> UnpackGameFiles(std::string_view dst, std::string_view pkgPath, std::string_view idxPath);
 
 private:
+	struct Batch;
+
 	void AnalyzeReplay(const std::filesystem::path& path, std::chrono::seconds readDelay = std::chrono::seconds(0));
+	void AnalyzeBatched(const std::filesystem::path& path, const std::shared_ptr<Batch>& batch);
+	// analyzes the replay unless it was analyzed before, the hash of its meta also finds copies of it
+	ReplayResult<ReplaySummary> Analyze(const std::filesystem::path& path, ReplayParser::StreamBuffers& buffers, std::string_view hash = {});
+	void CommitSummaries(std::span<const std::pair<uint32_t, ReplaySummary>> summaries);
 
 	const ServiceProvider& m_services;
+	// declared before the pool, so it outlives the threads using it
+	ReplayParser::SummaryCache m_summaryCache;
 	Core::ThreadPool m_threadPool;
 	std::unordered_map<std::filesystem::path::string_type, std::future<void>> m_futures;
 	fs::path m_gameFilePath;
@@ -0,0 +1,138 @@
+// Copyright 2024 <github.com/razaqq>
+
+#include "Client/DatabaseExecutor.hpp"
+#include "Client/DatabaseManager.hpp"
+
+#include "Core/Log.hpp"
+#include "Core/Result.hpp"
+#include "Core/Sqlite.hpp"
+#include "Core/ThreadPool.hpp"
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+
+namespace fs = std::filesystem;
+
+using PotatoAlert::Client::DatabaseExecutor;
+using PotatoAlert::Core::SQLite;
+using PotatoAlert::Core::ThreadPool;
+
+DatabaseExecutor::DatabaseExecutor(const fs::path& path, size_t readerCount)
+{
+	SQLite db = SQLite::Open(path, SQLite::Flags::ReadWrite | SQLite::Flags::Create);
+	if (!db)
+	{
+		LOG_ERROR("Failed to open database: {}", db.GetLastError());
+		return;
+	}
+
+	m_writer = std::make_unique<Connection>(std::move(db));
+	PA_TRYV_OR_ELSE(m_writer->Manager.Initialize(),
+	{
+		LOG_ERROR("Failed to initialize database: {}", error);
+	});
+
+	// the readers are opened after the writer brought the schema up to date
+	for (size_t i = 0; i < readerCount; i++)
+	{
+		SQLite reader = SQLite::Open(path, SQLite::Flags::ReadOnly);
+		if (!reader)
+		{
+			LOG_WARN("Failed to open database for reading: {}", reader.GetLastError());
+			break;
+		}
+		m_readers.emplace_back(std::make_unique<Connection>(std::move(reader)));
+	}
+
+	// without a reader the reads run on the writer
+	if (!m_readers.empty())
+	{
+		m_readerPool = std::make_unique<ThreadPool>(m_readers.size());
+	}
+
+	m_writerThread = std::thread(&DatabaseExecutor::RunWriter, this);
+}
+
+DatabaseExecutor::~DatabaseExecutor()
+{
+	if (!m_writer)
+		return;
+
+	// the reads might still queue writes
+	m_readerPool.reset();
+
+	Post([this]()
+	{
+		PA_TRYV_OR_ELSE(m_writer->Manager.Vacuum(),
+		{
+			LOG_ERROR("Failed to VACUUM database: {}", error);
+		});
+	});
+
+	{
+		std::unique_lock lock(m_writerMutex);
+		m_stopping = true;
+	}
+	m_writerCondition.notify_one();
+	m_writerThread.join();
+}
+
+void DatabaseExecutor::Post(std::function<void()>&& task)
+{
+	{
+		std::unique_lock lock(m_writerMutex);
+		m_writes.emplace_back(std::move(task));
+	}
+	m_writerCondition.notify_one();
+}
+
+void DatabaseExecutor::RunWriter()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock lock(m_writerMutex);
+			m_writerCondition.wait(lock, [this]()
+			{
+				return m_stopping || !m_writes.empty();
+			});
+
+			// every queued write still runs when stopping
+			if (m_writes.empty())
+				return;
+
+			task = std::move(m_writes.front());
+			m_writes.pop_front();
+		}
+		task();
+	}
+}
+
+std::unique_ptr<DatabaseExecutor::Connection> DatabaseExecutor::TakeReader()
+{
+	// the pool runs a thread more than it was asked for, which then waits for a reader
+	std::unique_lock lock(m_readerMutex);
+	m_readerCondition.wait(lock, [this]()
+	{
+		return !m_readers.empty();
+	});
+
+	std::unique_ptr<Connection> reader = std::move(m_readers.back());
+	m_readers.pop_back();
+	return reader;
+}
+
+void DatabaseExecutor::ReturnReader(std::unique_ptr<Connection> reader)
+{
+	{
+		std::unique_lock lock(m_readerMutex);
+		m_readers.emplace_back(std::move(reader));
+	}
+	m_readerCondition.notify_one();
+}
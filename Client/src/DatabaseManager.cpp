@@ -9,15 +9,24 @@
 #include "Core/String.hpp"
 #include "Core/Sqlite.hpp"
 
+#include <charconv>
+#include <chrono>
+#include <cstdint>
 #include <optional>
 #include <span>
 #include <string>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 
 using PotatoAlert::Client::DatabaseManager;
+using PotatoAlert::Client::GetMatchTimestamp;
 using PotatoAlert::Client::Match;
+using PotatoAlert::Client::MatchFilter;
+using PotatoAlert::Client::MatchFilterValues;
+using PotatoAlert::Client::MatchListKey;
+using PotatoAlert::Client::MatchListPage;
 using PotatoAlert::Client::NonAnalyzedMatch;
 using PotatoAlert::Client::SqlResult;
 using PotatoAlert::Core::SQLite;
@@ -141,6 +150,106 @@ static inline bool BindValue(std::string_view name, SQLite::Statement& stmt, con
 }
 #endif
 
+static SqlResult<std::vector<std::string>> GetDistinctValues(const SQLite& db, std::string_view selectQuery)
+{
+	SQLite::Statement stmt(db, selectQuery);
+
+	if (!stmt)
+	{
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", db.GetLastError());
+	}
+
+	std::vector<std::string> values;
+	while (!stmt.IsDone())
+	{
+		stmt.ExecuteStep();
+		if (stmt.HasRow())
+		{
+			values.emplace_back(ParseValue<std::string>(stmt, 0));
+		}
+	}
+
+	return values;
+}
+
+// appends the predicates of the filter as positional parameters, which are bound in the same order by BindMatchFilter
+static void AppendMatchFilter(std::string& query, const MatchFilter& filter)
+{
+	query += " WHERE Timestamp BETWEEN ? AND ?";
+
+	auto appendIn = [&query](std::string_view column, const std::optional<std::vector<std::string>>& values)
+	{
+		if (!values)
+			return;
+
+		query += fmt::format(" AND {} IN (", column);
+		for (size_t i = 0; i < values->size(); i++)
+		{
+			query += i == 0 ? "?" : ", ?";
+		}
+		query += ")";
+	};
+	appendIn("Ship", filter.Ships);
+	appendIn("Map", filter.Maps);
+	appendIn("MatchGroup", filter.MatchGroups);
+	appendIn("StatsMode", filter.StatsModes);
+	appendIn("Player", filter.Players);
+	appendIn("Region", filter.Regions);
+}
+
+// continues the match list after the key, which only walks the index of the Timestamp instead of every match before it
+static void AppendMatchListKey(std::string& query, std::optional<MatchListKey> after)
+{
+	if (after)
+	{
+		query += " AND (Timestamp, Id) < (?, ?)";
+	}
+	query += " ORDER BY Timestamp DESC, Id DESC";
+}
+
+static int BindMatchListKey(const SQLite::Statement& stmt, int index, std::optional<MatchListKey> after)
+{
+	if (after)
+	{
+		stmt.Bind(index++, after->Timestamp);
+		stmt.Bind(index++, after->Id);
+	}
+	return index;
+}
+
+// binds the parameters added by AppendMatchFilter and returns the index of the next parameter
+static int BindMatchFilter(const SQLite::Statement& stmt, const MatchFilter& filter)
+{
+	int index = 1;
+	stmt.Bind(index++, filter.From);
+	stmt.Bind(index++, filter.To);
+
+	auto bindIn = [&stmt, &index](const std::optional<std::vector<std::string>>& values)
+	{
+		if (!values)
+			return;
+
+		for (const std::string& value : *values)
+		{
+			stmt.Bind(index++, value);
+		}
+	};
+	bindIn(filter.Ships);
+	bindIn(filter.Maps);
+	bindIn(filter.MatchGroups);
+	bindIn(filter.StatsModes);
+	bindIn(filter.Players);
+	bindIn(filter.Regions);
+
+	return index;
+}
+
+static bool ParseNumber(std::string_view str, int& value)
+{
+	const auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+	return ec == std::errc() && ptr == str.data() + str.size();
+}
+
 static inline Match ParseMatch(const SQLite::Statement& stmt)
 {
 	int index = 0;
@@ -152,30 +261,55 @@ static inline Match ParseMatch(const SQLite::Statement& stmt)
 
 }  // namespace
 
-DatabaseManager::DatabaseManager(SQLite& db) : m_db(db)
+int64_t PotatoAlert::Client::GetMatchTimestamp(std::string_view date)
 {
-	if (!CreateTables())
+	// dd.mm.yyyy HH:MM:SS
+	if (date.size() != 19)
 	{
-		LOG_ERROR("Failed to create database tables");
+		return 0;
 	}
 
-	SqlResult<void> migrate = MigrateTables();
-	if (!migrate)
+	int d, m, y, hours, minutes, seconds;
+	if (!ParseNumber(date.substr(0, 2), d) || !ParseNumber(date.substr(3, 2), m) || !ParseNumber(date.substr(6, 4), y) ||
+		!ParseNumber(date.substr(11, 2), hours) || !ParseNumber(date.substr(14, 2), minutes) || !ParseNumber(date.substr(17, 2), seconds))
 	{
-		LOG_ERROR("Failed to migrate tables: {}", migrate.error());
+		return 0;
 	}
+
+	const std::chrono::year_month_day ymd{ std::chrono::year(y), std::chrono::month(m), std::chrono::day(d) };
+	if (!ymd.ok() || hours < 0 || hours > 23 || minutes < 0 || minutes > 59 || seconds < 0 || seconds > 59)
+	{
+		return 0;
+	}
+
+	const std::chrono::sys_seconds time = std::chrono::sys_days(ymd) + std::chrono::hours(hours) + std::chrono::minutes(minutes) + std::chrono::seconds(seconds);
+	return time.time_since_epoch().count();
 }
 
-DatabaseManager::~DatabaseManager()
+SqlResult<void> DatabaseManager::Initialize() const
 {
-	if (m_db)
+	if (!m_db.SetJournalMode(SQLite::JournalMode::Wal) || !m_db.SetSynchronous(SQLite::Synchronous::Normal))
 	{
-		if (!m_db.Execute("VACUUM"))
-		{
-			LOG_ERROR("Failed to VACUUM database: {}", m_db.GetLastError());
-		}
-		m_db.Close();
+		return PA_SQL_ERROR("Failed to set journal mode: {}", m_db.GetLastError());
+	}
+
+	PA_TRYV(CreateTables());
+	PA_TRYV(MigrateTables());
+
+	// the indexes cover columns added by the migration
+	PA_TRYV(CreateIndexes());
+
+	return {};
+}
+
+SqlResult<void> DatabaseManager::Vacuum() const
+{
+	if (!m_db.Execute("VACUUM"))
+	{
+		return PA_SQL_ERROR("{}", m_db.GetLastError());
 	}
+
+	return {};
 }
 
 SqlResult<void> DatabaseManager::CreateTables() const
@@ -193,13 +327,167 @@ SqlResult<void> DatabaseManager::CreateTables() const
 SqlResult<void> DatabaseManager::MigrateTables() const
 {
 	// TODO: convert the time to YYYY-MM-DD HH:MM:SS
+
+	// the backfills commit in batches to keep the WAL small, so an interrupted migration
+	// leaves the columns partly filled and the next one continues with the matches that are left
+	static constexpr size_t batchSize = 1000;
+
+	// the Timestamp column was added after the table, it is filled by GetMatchTimestamp just like for new matches
+	if (!SQLite::Statement(m_db, "SELECT Timestamp FROM matches LIMIT 0"))
+	{
+		if (!m_db.Execute("ALTER TABLE matches ADD COLUMN Timestamp INTEGER"))
+		{
+			return PA_SQL_ERROR("Failed to add Timestamp column: {}", m_db.GetLastError());
+		}
+	}
+
+	{
+		SQLite::Transaction transaction(m_db);
+		if (!transaction)
+		{
+			return PA_SQL_ERROR("Failed to begin transaction: {}", m_db.GetLastError());
+		}
+
+		std::vector<std::pair<uint32_t, std::string>> dates;
+		{
+			SQLite::Statement stmt(m_db, "SELECT Id, Date FROM matches WHERE Timestamp IS NULL");
+			if (!stmt)
+			{
+				return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+			}
+
+			while (!stmt.IsDone())
+			{
+				stmt.ExecuteStep();
+				if (stmt.HasRow())
+				{
+					dates.emplace_back(ParseValue<uint32_t>(stmt, 0), ParseValue<std::string>(stmt, 1));
+				}
+			}
+		}
+
+		for (const auto& [id, date] : dates)
+		{
+			SQLite::Statement stmt(m_db, "UPDATE matches SET Timestamp = :Timestamp WHERE Id = :Id");
+			if (!stmt)
+			{
+				return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+			}
+
+			stmt.Bind(":Timestamp", GetMatchTimestamp(date));
+			stmt.Bind(":Id", id);
+			stmt.ExecuteStep();
+			if (!stmt.IsDone())
+			{
+				return PA_SQL_ERROR("Failed to set Timestamp of match {}: {}", id, m_db.GetLastError());
+			}
+
+			if (!transaction.CommitBatch(batchSize))
+			{
+				return PA_SQL_ERROR("Failed to commit transaction: {}", m_db.GetLastError());
+			}
+		}
+
+		if (!transaction.Commit())
+		{
+			return PA_SQL_ERROR("Failed to commit transaction: {}", m_db.GetLastError());
+		}
+	}
+
+	// the Outcome column was added after the table, it is filled from the summaries that were stored before
+	if (!SQLite::Statement(m_db, "SELECT Outcome FROM matches LIMIT 0"))
+	{
+		// every match is added with its outcome, so only the backfill leaves it NULL
+		if (!m_db.Execute("ALTER TABLE matches ADD COLUMN Outcome INTEGER"))
+		{
+			return PA_SQL_ERROR("Failed to add Outcome column: {}", m_db.GetLastError());
+		}
+	}
+
+	{
+		SQLite::Transaction transaction(m_db);
+		if (!transaction)
+		{
+			return PA_SQL_ERROR("Failed to begin transaction: {}", m_db.GetLastError());
+		}
+
+		std::vector<std::pair<uint32_t, ReplayParser::MatchOutcome>> outcomes;
+		{
+			SQLite::Statement stmt(m_db, "SELECT Id, ReplaySummary IS NULL, ReplaySummary FROM matches WHERE Outcome IS NULL");
+			if (!stmt)
+			{
+				return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+			}
+
+			while (!stmt.IsDone())
+			{
+				stmt.ExecuteStep();
+				if (stmt.HasRow())
+				{
+					// matches without a summary have an unknown outcome
+					const ReplayParser::MatchOutcome outcome = ParseValue<bool>(stmt, 1)
+							? ReplayParser::MatchOutcome::Unknown
+							: ParseValue<ReplaySummary>(stmt, 2).Outcome;
+					outcomes.emplace_back(ParseValue<uint32_t>(stmt, 0), outcome);
+				}
+			}
+		}
+
+		for (const auto& [id, outcome] : outcomes)
+		{
+			SQLite::Statement stmt(m_db, "UPDATE matches SET Outcome = :Outcome WHERE Id = :Id");
+			if (!stmt)
+			{
+				return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+			}
+
+			stmt.Bind(":Outcome", static_cast<int>(outcome));
+			stmt.Bind(":Id", id);
+			stmt.ExecuteStep();
+			if (!stmt.IsDone())
+			{
+				return PA_SQL_ERROR("Failed to set Outcome of match {}: {}", id, m_db.GetLastError());
+			}
+
+			if (!transaction.CommitBatch(batchSize))
+			{
+				return PA_SQL_ERROR("Failed to commit transaction: {}", m_db.GetLastError());
+			}
+		}
+
+		if (!transaction.Commit())
+		{
+			return PA_SQL_ERROR("Failed to commit transaction: {}", m_db.GetLastError());
+		}
+	}
+
+	return {};
+}
+
+SqlResult<void> DatabaseManager::CreateIndexes() const
+{
+	// every column the match history is filtered by, together with the Timestamp it is ordered by
+	static constexpr std::string_view createStatement =
+			"CREATE INDEX IF NOT EXISTS MatchesTimestamp ON matches (Timestamp);"
+			"CREATE INDEX IF NOT EXISTS MatchesShip ON matches (Ship, Timestamp);"
+			"CREATE INDEX IF NOT EXISTS MatchesMap ON matches (Map, Timestamp);"
+			"CREATE INDEX IF NOT EXISTS MatchesMatchGroup ON matches (MatchGroup, Timestamp);"
+			"CREATE INDEX IF NOT EXISTS MatchesStatsMode ON matches (StatsMode, Timestamp);"
+			"CREATE INDEX IF NOT EXISTS MatchesPlayer ON matches (Player, Timestamp);"
+			"CREATE INDEX IF NOT EXISTS MatchesRegion ON matches (Region, Timestamp);";
+
+	if (!m_db.Execute(createStatement))
+	{
+		return PA_SQL_ERROR("{}", m_db.GetLastError());
+	}
+
 	return {};
 }
 
 SqlResult<void> DatabaseManager::AddMatch(Match& match) const
 {
 	static constexpr std::string_view insertQuery = "INSERT INTO matches ("
-		PA_DB_COLUMNS(MATCH_FIELDS) ") VALUES (" PA_DB_COLUMNS_VALUES(MATCH_FIELDS) ")";
+		PA_DB_COLUMNS(MATCH_FIELDS) ", Outcome) VALUES (" PA_DB_COLUMNS_VALUES(MATCH_FIELDS) ", :Outcome)";
 
 	SQLite::Statement stmt(m_db, insertQuery);
 
@@ -208,9 +496,12 @@ SqlResult<void> DatabaseManager::AddMatch(Match& match) const
 		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
 	}
 
+	match.Timestamp = GetMatchTimestamp(match.Date);
+
 #define BIND_VALUES(Type, Name, SqlType) BIND_VALUE(Name, stmt, match.Name);
 	MATCH_FIELDS(BIND_VALUES)
 #undef BIND_VALUES
+	stmt.Bind(":Outcome", static_cast<int>(match.ReplaySummary.Outcome));
 
 	stmt.ExecuteStep();
 	if (!stmt.IsDone())
@@ -365,9 +656,176 @@ SqlResult<std::vector<Match>> DatabaseManager::GetMatches() const
 	return matches;
 }
 
+SqlResult<std::vector<Match>> DatabaseManager::GetMatchList(const MatchFilter& filter, std::optional<MatchListKey> after, uint32_t count) const
+{
+	PA_PROFILE_FUNCTION();
+
+	std::string selectQuery =
+			"SELECT Id, Hash, ReplayName, Date, Timestamp, Ship, ShipNation, ShipClass, ShipTier, Map, MatchGroup, StatsMode, Player, Region, Analyzed, Outcome "
+			"FROM matches";
+	AppendMatchFilter(selectQuery, filter);
+	AppendMatchListKey(selectQuery, after);
+	selectQuery += " LIMIT ?";
+
+	SQLite::Statement stmt(m_db, selectQuery);
+
+	if (!stmt)
+	{
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+	}
+
+	const int index = BindMatchListKey(stmt, BindMatchFilter(stmt, filter), after);
+	stmt.Bind(index, count);
+
+	std::vector<Match> matches;
+	matches.reserve(count);
+	while (!stmt.IsDone())
+	{
+		stmt.ExecuteStep();
+		if (stmt.HasRow())
+		{
+			matches.emplace_back(Match
+			{
+				.Id = ParseValue<uint32_t>(stmt, 0),
+				.Hash = ParseValue<std::string>(stmt, 1),
+				.ReplayName = ParseValue<std::string>(stmt, 2),
+				.Date = ParseValue<std::string>(stmt, 3),
+				.Timestamp = ParseValue<int64_t>(stmt, 4),
+				.Ship = ParseValue<std::string>(stmt, 5),
+				.ShipNation = ParseValue<std::string>(stmt, 6),
+				.ShipClass = ParseValue<std::string>(stmt, 7),
+				.ShipTier = ParseValue<uint8_t>(stmt, 8),
+				.Map = ParseValue<std::string>(stmt, 9),
+				.MatchGroup = ParseValue<std::string>(stmt, 10),
+				.StatsMode = ParseValue<std::string>(stmt, 11),
+				.Player = ParseValue<std::string>(stmt, 12),
+				.Region = ParseValue<std::string>(stmt, 13),
+				.Analyzed = ParseValue<bool>(stmt, 14),
+				.ReplaySummary = ReplaySummary{ .Outcome = static_cast<ReplayParser::MatchOutcome>(ParseValue<int32_t>(stmt, 15)) }
+			});
+		}
+	}
+
+	return matches;
+}
+
+SqlResult<std::optional<MatchListKey>> DatabaseManager::GetMatchListKey(const MatchFilter& filter, std::optional<MatchListKey> after, uint32_t count) const
+{
+	PA_PROFILE_FUNCTION();
+
+	if (count == 0)
+	{
+		return after;
+	}
+
+	// the offset is at most a page, every page before it is skipped by the key
+	std::string selectQuery = "SELECT Timestamp, Id FROM matches";
+	AppendMatchFilter(selectQuery, filter);
+	AppendMatchListKey(selectQuery, after);
+	selectQuery += " LIMIT 1 OFFSET ?";
+
+	SQLite::Statement stmt(m_db, selectQuery);
+
+	if (!stmt)
+	{
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+	}
+
+	const int index = BindMatchListKey(stmt, BindMatchFilter(stmt, filter), after);
+	stmt.Bind(index, count - 1);
+
+	stmt.ExecuteStep();
+	if (stmt.HasRow())
+	{
+		return MatchListKey
+		{
+			.Timestamp = ParseValue<int64_t>(stmt, 0),
+			.Id = ParseValue<uint32_t>(stmt, 1),
+		};
+	}
+
+	return {};
+}
+
+SqlResult<uint32_t> DatabaseManager::GetMatchCount(const MatchFilter& filter) const
+{
+	PA_PROFILE_FUNCTION();
+
+	std::string countQuery = "SELECT COUNT(*) FROM matches";
+	AppendMatchFilter(countQuery, filter);
+
+	SQLite::Statement stmt(m_db, countQuery);
+
+	if (!stmt)
+	{
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+	}
+
+	BindMatchFilter(stmt, filter);
+
+	stmt.ExecuteStep();
+	if (stmt.HasRow())
+	{
+		uint32_t count;
+		if (stmt.GetInt64(0, count))
+		{
+			return count;
+		}
+		return PA_SQL_ERROR("Result is not an integer");
+	}
+	return PA_SQL_ERROR("Result has no row");
+}
+
+SqlResult<MatchListPage> DatabaseManager::GetMatchListPage(const MatchFilter& filter, std::optional<MatchListKey> after, size_t skip, uint32_t count) const
+{
+	PA_PROFILE_FUNCTION();
+
+	// each statement outside of a transaction reads its own snapshot, the deferred transaction also works on a read-only connection
+	SQLite::Transaction transaction(m_db);
+	if (!transaction)
+	{
+		return PA_SQL_ERROR("Failed to begin transaction: {}", m_db.GetLastError());
+	}
+
+	MatchListPage page;
+	PA_TRYA(page.Count, GetMatchCount(filter));
+	for (size_t i = 0; i < skip; i++)
+	{
+		PA_TRY(key, GetMatchListKey(filter, after, count));
+		if (!key)
+		{
+			return page;
+		}
+		page.SkippedKeys.emplace_back(key.value());
+		after = key;
+	}
+	PA_TRYA(page.Matches, GetMatchList(filter, after, count));
+
+	if (!transaction.Commit())
+	{
+		return PA_SQL_ERROR("Failed to commit transaction: {}", m_db.GetLastError());
+	}
+
+	return page;
+}
+
+SqlResult<MatchFilterValues> DatabaseManager::GetMatchFilterValues() const
+{
+	PA_PROFILE_FUNCTION();
+
+	MatchFilterValues values;
+	PA_TRYA(values.Ships, GetDistinctValues(m_db, "SELECT DISTINCT Ship FROM matches"));
+	PA_TRYA(values.Maps, GetDistinctValues(m_db, "SELECT DISTINCT Map FROM matches"));
+	PA_TRYA(values.MatchGroups, GetDistinctValues(m_db, "SELECT DISTINCT MatchGroup FROM matches"));
+	PA_TRYA(values.StatsModes, GetDistinctValues(m_db, "SELECT DISTINCT StatsMode FROM matches"));
+	PA_TRYA(values.Players, GetDistinctValues(m_db, "SELECT DISTINCT Player FROM matches"));
+	PA_TRYA(values.Regions, GetDistinctValues(m_db, "SELECT DISTINCT Region FROM matches"));
+	return values;
+}
+
 SqlResult<void> DatabaseManager::UpdateMatch(uint32_t id, const Match& match) const
 {
-	static constexpr std::string_view updateStatement = "UPDATE matches SET " PA_DB_COLUMNS_VALUES_UPDATE(MATCH_FIELDS) " WHERE Id = :Id";
+	static constexpr std::string_view updateStatement = "UPDATE matches SET " PA_DB_COLUMNS_VALUES_UPDATE(MATCH_FIELDS) ", Outcome = :Outcome WHERE Id = :Id";
 
 	SQLite::Statement stmt(m_db, updateStatement);
 
@@ -380,6 +838,9 @@ SqlResult<void> DatabaseManager::UpdateMatch(uint32_t id, const Match& match) co
 #define BIND_VALUES(Type, Name, SqlType) BIND_VALUE(Name, stmt, match.Name);
 	MATCH_FIELDS(BIND_VALUES)
 #undef BIND_VALUES
+	// the timestamp is derived from the date, just like when the match was added
+	stmt.Bind(":Timestamp", GetMatchTimestamp(match.Date));
+	stmt.Bind(":Outcome", static_cast<int>(match.ReplaySummary.Outcome));
 
 	stmt.ExecuteStep();
 	if (!stmt.IsDone())
@@ -392,7 +853,7 @@ SqlResult<void> DatabaseManager::UpdateMatch(uint32_t id, const Match& match) co
 
 SqlResult<void> DatabaseManager::UpdateMatch(std::string_view hash, const Match& match) const
 {
-	static constexpr std::string_view updateStatement = "UPDATE matches SET " PA_DB_COLUMNS_VALUES_UPDATE(MATCH_FIELDS) " WHERE Hash = :Hash";
+	static constexpr std::string_view updateStatement = "UPDATE matches SET " PA_DB_COLUMNS_VALUES_UPDATE(MATCH_FIELDS) ", Outcome = :Outcome WHERE Hash = :Hash";
 
 	SQLite::Statement stmt(m_db, updateStatement);
 
@@ -405,6 +866,9 @@ SqlResult<void> DatabaseManager::UpdateMatch(std::string_view hash, const Match&
 #define BIND_VALUES(Type, Name, SqlType) BIND_VALUE(Name, stmt, match.Name);
 	MATCH_FIELDS(BIND_VALUES)
 #undef BIND_VALUES
+	// the timestamp is derived from the date, just like when the match was added
+	stmt.Bind(":Timestamp", GetMatchTimestamp(match.Date));
+	stmt.Bind(":Outcome", static_cast<int>(match.ReplaySummary.Outcome));
 
 	stmt.ExecuteStep();
 	if (!stmt.IsDone())
@@ -463,7 +927,7 @@ SqlResult<std::vector<NonAnalyzedMatch>> DatabaseManager::GetNonAnalyzedMatches(
 {
 	std::vector<NonAnalyzedMatch> matches;
 
-	static constexpr std::string_view selectQuery = "SELECT Hash, ReplayName FROM matches WHERE Analyzed = false";
+	static constexpr std::string_view selectQuery = "SELECT Id, Hash, ReplayName FROM matches WHERE Analyzed = false";
 
 	SQLite::Statement stmt(m_db, selectQuery);
 
@@ -479,8 +943,9 @@ SqlResult<std::vector<NonAnalyzedMatch>> DatabaseManager::GetNonAnalyzedMatches(
 		{
 			matches.emplace_back(NonAnalyzedMatch
 			{
-				ParseValue<std::string>(stmt, 0),
-				ParseValue<std::string>(stmt, 1)
+				ParseValue<uint32_t>(stmt, 0),
+				ParseValue<std::string>(stmt, 1),
+				ParseValue<std::string>(stmt, 2)
 			});
 		}
 	}
@@ -563,7 +1028,7 @@ SqlResult<std::optional<std::string>> DatabaseManager::GetMatchJson(std::string_
 
 SqlResult<void> DatabaseManager::SetMatchReplaySummary(uint32_t id, const ReplaySummary& replaySummary) const
 {
-	static constexpr std::string_view updateStatement = "UPDATE matches SET Analyzed = TRUE, ReplaySummary = :ReplaySummary WHERE Id = :Id";
+	static constexpr std::string_view updateStatement = "UPDATE matches SET Analyzed = TRUE, ReplaySummary = :ReplaySummary, Outcome = :Outcome WHERE Id = :Id";
 
 	SQLite::Statement stmt(m_db, updateStatement);
 
@@ -577,6 +1042,7 @@ SqlResult<void> DatabaseManager::SetMatchReplaySummary(uint32_t id, const Replay
 	rapidjson::Writer writer(buffer);
 	PA_TRYV(ToJson(writer, replaySummary));
 	stmt.Bind(":ReplaySummary", buffer.GetString());
+	stmt.Bind(":Outcome", static_cast<int>(replaySummary.Outcome));
 
 	stmt.ExecuteStep();
 	if (!stmt.IsDone())
@@ -589,7 +1055,7 @@ SqlResult<void> DatabaseManager::SetMatchReplaySummary(uint32_t id, const Replay
 
 SqlResult<void> DatabaseManager::SetMatchReplaySummary(std::string_view hash, const ReplaySummary& replaySummary) const
 {
-	static constexpr std::string_view updateStatement = "UPDATE matches SET Analyzed = TRUE, ReplaySummary = :ReplaySummary WHERE Hash = :Hash";
+	static constexpr std::string_view updateStatement = "UPDATE matches SET Analyzed = TRUE, ReplaySummary = :ReplaySummary, Outcome = :Outcome WHERE Hash = :Hash";
 
 	SQLite::Statement stmt(m_db, updateStatement);
 
@@ -602,6 +1068,7 @@ SqlResult<void> DatabaseManager::SetMatchReplaySummary(std::string_view hash, co
 	rapidjson::Writer writer(buffer);
 	PA_TRYV(ToJson(writer, replaySummary));
 	stmt.Bind(":ReplaySummary", buffer.GetString());
+	stmt.Bind(":Outcome", static_cast<int>(replaySummary.Outcome));
 
 	stmt.ExecuteStep();
 	if (!stmt.IsDone())
@@ -612,6 +1079,29 @@ SqlResult<void> DatabaseManager::SetMatchReplaySummary(std::string_view hash, co
 	return {};
 }
 
+SqlResult<void> DatabaseManager::SetMatchReplaySummaries(std::span<const std::pair<uint32_t, ReplaySummary>> summaries) const
+{
+	PA_PROFILE_FUNCTION();
+
+	SQLite::Transaction transaction(m_db);
+	if (!transaction)
+	{
+		return PA_SQL_ERROR("Failed to begin transaction: {}", m_db.GetLastError());
+	}
+
+	for (const auto& [id, summary] : summaries)
+	{
+		PA_TRYV(SetMatchReplaySummary(id, summary));
+	}
+
+	if (!transaction.Commit())
+	{
+		return PA_SQL_ERROR("Failed to commit transaction: {}", m_db.GetLastError());
+	}
+
+	return {};
+}
+
 SqlResult<bool> DatabaseManager::MatchExists(uint32_t id) const
 {
 	static constexpr std::string_view existsQuery = "SELECT 1 FROM matches WHERE Id = :Id";
@@ -4,6 +4,7 @@
 
 #include "Client/AppDirectories.hpp"
 #include "Client/Config.hpp"
+#include "Client/DatabaseExecutor.hpp"
 #include "Client/DatabaseManager.hpp"
 #include "Client/Game.hpp"
 #include "Client/ReplayAnalyzer.hpp"
@@ -328,52 +329,53 @@ void PotatoClient::LookupResult(const std::string& url, const std::string& authT
 
 						if (config.Get<ConfigKey::MatchHistory>())
 						{
-							const DatabaseManager& dbm = m_services.Get<DatabaseManager>();
+							rapidjson::StringBuffer buffer;
+							rapidjson::Writer writer(buffer);
+							serverResponse.Result.value().Accept(writer);
 
-							PA_TRY_OR_ELSE(exists, dbm.MatchExists(m_lastArenaInfoHash),
+							Match match
 							{
-								LOG_ERROR("Failed to check if match exists in database: {}", error);
-								return;
-							});
-
-							if (!exists)
+								.Hash = m_lastArenaInfoHash,
+								.ReplayName = GetReplayName(res.Match.Info),
+								.Date = res.Match.Info.DateTime,
+								.Ship = res.Match.Info.ShipName,
+								.ShipNation = res.Match.Info.ShipNation,
+								.ShipClass = res.Match.Info.ShipClass,
+								.ShipTier = res.Match.Info.ShipTier,
+								.Map = res.Match.Info.Map,
+								.MatchGroup = res.Match.Info.MatchGroup,
+								.StatsMode = res.Match.Info.StatsMode,
+								.Player = res.Match.Info.Player,
+								.Region = res.Match.Info.Region,
+								.Json = buffer.GetString(),
+								.ArenaInfo = matchContext.ArenaInfo,
+								.Analyzed = false,
+								.ReplaySummary = ReplaySummary{}
+							};
+
+							// the check and the insert run together on the writer, so the match is never added twice
+							m_services.Get<DatabaseExecutor>().Write([match = std::move(match)](const DatabaseManager& dbm) mutable -> SqlResult<std::optional<Match>>
 							{
-								LOG_TRACE("Adding match to match history '{}'", m_lastArenaInfoHash);
-								
-								rapidjson::StringBuffer buffer;
-								rapidjson::Writer writer(buffer);
-								serverResponse.Result.value().Accept(writer);
-
-								Match match
+								PA_TRY(exists, dbm.MatchExists(match.Hash));
+								if (exists)
 								{
-									.Hash = m_lastArenaInfoHash,
-									.ReplayName = GetReplayName(res.Match.Info),
-									.Date = res.Match.Info.DateTime,
-									.Ship = res.Match.Info.ShipName,
-									.ShipNation = res.Match.Info.ShipNation,
-									.ShipClass = res.Match.Info.ShipClass,
-									.ShipTier = res.Match.Info.ShipTier,
-									.Map = res.Match.Info.Map,
-									.MatchGroup = res.Match.Info.MatchGroup,
-									.StatsMode = res.Match.Info.StatsMode,
-									.Player = res.Match.Info.Player,
-									.Region = res.Match.Info.Region,
-									.Json = buffer.GetString(),
-									.ArenaInfo = matchContext.ArenaInfo,
-									.Analyzed = false,
-									.ReplaySummary = ReplaySummary{}
-								};
-
-								SqlResult<void> addResult = dbm.AddMatch(match);
-								if (addResult)
+									return std::nullopt;
+								}
+
+								LOG_TRACE("Adding match to match history '{}'", match.Hash);
+								PA_TRYV(dbm.AddMatch(match));
+								return std::move(match);
+							}, this, [this](SqlResult<std::optional<Match>>&& result)
+							{
+								if (!result)
 								{
-									emit MatchHistoryNewMatch(match);
+									LOG_ERROR("Failed to add match to database: {}", result.error());
 								}
-								else
+								else if (result.value())
 								{
-									LOG_ERROR("Failed to add match to database: {}", addResult.error());
+									emit MatchHistoryNewMatch(*result.value());
 								}
-							}
+							});
 						}
 
 						if (config.Get<ConfigKey::SaveMatchCsv>())
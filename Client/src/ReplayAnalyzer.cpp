@@ -1,22 +1,32 @@
 // Copyright 2022 <github.com/razaqq>
 
+#include "Client/DatabaseExecutor.hpp"
 #include "Client/DatabaseManager.hpp"
 #include "Client/ReplayAnalyzer.hpp"
 
 #include "Core/Encoding.hpp"
 #include "Core/File.hpp"
+#include "Core/Format.hpp"
+#include "Core/Sha256.hpp"
 #include "Core/String.hpp"
+#include "Core/Xml.hpp"
 
 #include "GameFileUnpack/GameFileUnpack.hpp"
 
+#include "ReplayParser/GameFiles.hpp"
 #include "ReplayParser/ReplayParser.hpp"
 
-#include <algorithm>
 #include <chrono>
 #include <filesystem>
+#include <memory>
+#include <mutex>
 #include <optional>
-#include <ranges>
+#include <span>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 
 namespace fs = std::filesystem;
@@ -24,8 +34,54 @@ namespace fs = std::filesystem;
 using namespace std::chrono_literals;
 using namespace PotatoAlert::Core;
 using PotatoAlert::Client::ReplayAnalyzer;
+using PotatoAlert::GameFileUnpack::GameFile;
 using PotatoAlert::GameFileUnpack::Unpacker;
+using PotatoAlert::ReplayParser::EntitySpec;
 using PotatoAlert::ReplayParser::ReplayResult;
+using PotatoAlert::ReplayParser::ScriptSource;
+using PotatoAlert::ReplayParser::StreamBuffers;
+
+namespace {
+
+// summaries of a directory are committed in transactions of this many matches
+static constexpr size_t SummaryBatchSize = 256;
+
+// every thread of the pool reuses its decode buffers and packet memory for all replays it analyzes
+static StreamBuffers& ThreadBuffers()
+{
+	thread_local StreamBuffers buffers;
+	return buffers;
+}
+
+// reads the game scripts straight from the pkgs, so they never have to be unpacked to disk
+class PkgScriptSource : public ScriptSource
+{
+public:
+	explicit PkgScriptSource(const Unpacker& unpacker) : m_unpacker(unpacker) {}
+
+	XmlResult<void> LoadXml(tinyxml2::XMLDocument& doc, std::string_view path) const override
+	{
+		const std::optional<GameFile> file = m_unpacker.Open(fmt::format("scripts/{}", path));
+		if (!file)
+		{
+			return PA_XML_ERROR("{} not found in the game files", path);
+		}
+		return ParseXml(doc, file->Data());
+	}
+
+private:
+	const Unpacker& m_unpacker;
+};
+
+}  // namespace
+
+struct ReplayAnalyzer::Batch
+{
+	std::unordered_map<std::string, uint32_t> Matches;  // hash to id of every match that is not analyzed yet
+	std::mutex Mutex;
+	std::vector<std::pair<uint32_t, ReplaySummary>> Summaries;
+	size_t Remaining = 0;
+};
 
 bool ReplayAnalyzer::HasGameFiles(Version gameVersion) const
 {
@@ -35,9 +91,14 @@ bool ReplayAnalyzer::HasGameFiles(Version gameVersion) const
 
 ReplayResult<void> ReplayAnalyzer::UnpackGameFiles(const fs::path& dst, const fs::path& pkgPath, const fs::path& idxPath)
 {
-	const Unpacker unpacker(pkgPath, idxPath);
-	if (!unpacker.Extract("scripts/", dst))
-		return PA_REPLAY_ERROR("Failed to unpack game scripts");
+	const Unpacker unpacker(pkgPath, idxPath, dst / "idx.bin");
+
+	// the scripts are parsed from memory, only the compiled specs are written to disk
+	const std::vector<EntitySpec> specs = ReplayParser::ParseScripts(PkgScriptSource(unpacker));
+	if (specs.empty())
+		return PA_REPLAY_ERROR("Failed to parse game scripts");
+	ReplayParser::StoreEntitySpecs(dst, specs);
+
 	if (!unpacker.Extract("content/GameParams.data", dst))
 		return PA_REPLAY_ERROR("Failed to unpack game params");
 	return {};
@@ -45,12 +106,7 @@ ReplayResult<void> ReplayAnalyzer::UnpackGameFiles(const fs::path& dst, const fs
 
 ReplayResult<void> ReplayAnalyzer::UnpackGameFiles(std::string_view dst, std::string_view pkgPath, std::string_view idxPath)
 {
-	const Unpacker unpacker(pkgPath, idxPath);
-	if (!unpacker.Extract("scripts/", dst))
-		return PA_REPLAY_ERROR("Failed to unpack game scripts");
-	if (!unpacker.Extract("content/GameParams.data", dst))
-		return PA_REPLAY_ERROR("Failed to unpack game params");
-	return {};
+	return UnpackGameFiles(fs::path(dst), fs::path(pkgPath), fs::path(idxPath));
 }
 
 void ReplayAnalyzer::OnFileChanged(const std::filesystem::path& file)
@@ -71,15 +127,21 @@ void ReplayAnalyzer::AnalyzeReplay(const fs::path& path, std::chrono::seconds re
 		LOG_TRACE(STR("Analyzing replay file {} after {} delay..."), file, readDelay);
 		std::this_thread::sleep_for(readDelay);
 
-		PA_TRY_OR_ELSE(summary, ReplayParser::AnalyzeReplay(file, m_gameFilePath),
+		// the replay of the match that just ended is waited for, so it is decrypted on all cores
+		// into buffers of its own, which are freed again instead of keeping the whole stream per thread
+		StreamBuffers buffers;
+		buffers.ParallelDecrypt = true;
+		PA_TRY_OR_ELSE(summary, Analyze(file, buffers),
 		{
 			LOG_ERROR("{}", error);
 			return;
 		});
+		m_summaryCache.Save();
 
-		const DatabaseManager& dbm = m_services.Get<DatabaseManager>();
-
-		PA_TRY_OR_ELSE(match, dbm.GetMatch(summary.Hash),
+		PA_TRY_OR_ELSE(match, m_services.Get<DatabaseExecutor>().Read([&summary](const DatabaseManager& dbm)
+		{
+			return dbm.GetMatch(summary.Hash);
+		}).get(),
 		{
 			LOG_ERROR("Failed to get match from match history: {}", error);
 			return;
@@ -87,12 +149,8 @@ void ReplayAnalyzer::AnalyzeReplay(const fs::path& path, std::chrono::seconds re
 
 		if (match)
 		{
-			PA_TRYV_OR_ELSE(dbm.SetMatchReplaySummary(summary.Hash, summary),
-			{
-				LOG_ERROR("Failed to set replay summary for match '{}': {}", summary.Hash, error);
-				return;
-			});
-			emit ReplaySummaryReady(match.value().Id, summary);
+			const std::pair<uint32_t, ReplaySummary> result = { match.value().Id, std::move(summary) };
+			CommitSummaries(std::span(&result, 1));
 		}
 	};
 
@@ -109,35 +167,140 @@ void ReplayAnalyzer::AnalyzeReplay(const fs::path& path, std::chrono::seconds re
 	}
 }
 
-void ReplayAnalyzer::AnalyzeDirectory(const fs::path& directory)
+void ReplayAnalyzer::AnalyzeBatched(const fs::path& path, const std::shared_ptr<Batch>& batch)
 {
-	const DatabaseManager& dbm = m_services.Get<DatabaseManager>();
+	auto analyze = [this, batch](const fs::path& file) -> void
+	{
+		// the summary hash is the hash of the meta, so replays of other matches are skipped without decrypting them
+		std::optional<uint32_t> id;
+		std::string hash;
+		if (ReplayResult<std::string> meta = ReplayParser::ReadMetaString(file); !meta)
+		{
+			LOG_ERROR("{}", meta.error());
+		}
+		else if (!Sha256(meta.value(), hash))
+		{
+			LOG_ERROR("Failed to get SHA256 hash of replay meta of {}", file);
+		}
+		else if (auto match = batch->Matches.find(hash); match != batch->Matches.end())
+		{
+			id = match->second;
+		}
+
+		std::optional<std::pair<uint32_t, ReplaySummary>> result;
+		if (id)
+		{
+			ReplayResult<ReplaySummary> summary = Analyze(file, ThreadBuffers(), hash);
+			if (!summary)
+			{
+				LOG_ERROR("{}", summary.error());
+			}
+			else
+			{
+				result.emplace(id.value(), std::move(summary.value()));
+			}
+		}
 
-	PA_TRY_OR_ELSE(matches, dbm.GetNonAnalyzedMatches(),
+		// whoever fills the batch or finishes the last replay commits it, while the other threads keep parsing
+		std::vector<std::pair<uint32_t, ReplaySummary>> summaries;
+		bool flush = false;
+		{
+			std::unique_lock lock(batch->Mutex);
+			if (result)
+			{
+				batch->Summaries.emplace_back(std::move(result.value()));
+			}
+			if (--batch->Remaining == 0 || batch->Summaries.size() >= SummaryBatchSize)
+			{
+				summaries = std::exchange(batch->Summaries, {});
+				flush = true;
+			}
+		}
+		CommitSummaries(summaries);
+		if (flush)
+		{
+			m_summaryCache.Save();
+		}
+	};
+
+	m_futures.insert_or_assign(path.native(), m_threadPool.Enqueue(analyze, path));
+}
+
+ReplayResult<ReplaySummary> ReplayAnalyzer::Analyze(const fs::path& path, StreamBuffers& buffers, std::string_view hash)
+{
+	if (std::optional<ReplaySummary> cached = hash.empty() ? m_summaryCache.Find(path) : m_summaryCache.Find(path, hash))
 	{
-		LOG_ERROR("Failed to get non-analyzed matches from match history: {}", error);
+		LOG_TRACE(STR("Using cached summary of replay {}"), path);
+		return std::move(cached.value());
+	}
+
+	PA_TRY(summary, ReplayParser::AnalyzeReplay(path, m_gameFilePath, buffers));
+	m_summaryCache.Insert(path, summary);
+	return summary;
+}
+
+void ReplayAnalyzer::CommitSummaries(std::span<const std::pair<uint32_t, ReplaySummary>> summaries)
+{
+	if (summaries.empty())
 		return;
-	});
 
-	std::ranges::sort(matches, [](const NonAnalyzedMatch& left, const NonAnalyzedMatch& right)
+	// the writer runs one transaction after another, this thread waits for its own
+	PA_TRYV_OR_ELSE(m_services.Get<DatabaseExecutor>().Write([summaries](const DatabaseManager& dbm)
 	{
-		return left.ReplayName < right.ReplayName;
+		return dbm.SetMatchReplaySummaries(summaries);
+	}).get(),
+	{
+		LOG_ERROR("Failed to set replay summaries of {} matches: {}", summaries.size(), error);
+		return;
 	});
 
-	for (const auto& entry : fs::recursive_directory_iterator(directory))
+	for (const auto& [id, summary] : summaries)
 	{
-		if (entry.is_regular_file() && entry.path().extension() == ".wowsreplay")
+		emit ReplaySummaryReady(id, summary);
+	}
+}
+
+void ReplayAnalyzer::AnalyzeDirectory(const fs::path& directory)
+{
+	// the replays are only looked for once the matches were read, without blocking the caller
+	m_services.Get<DatabaseExecutor>().Read([](const DatabaseManager& dbm)
+	{
+		return dbm.GetNonAnalyzedMatches();
+	}, this, [this, directory](SqlResult<std::vector<NonAnalyzedMatch>>&& result)
+	{
+		PA_TRY_OR_ELSE(matches, std::move(result),
 		{
-			auto found = std::ranges::find_if(matches, [&](const NonAnalyzedMatch& match)
-			{
-				const std::string fileName = String::ToLower(entry.path().filename().string());
-				return String::ToLower(match.ReplayName) == fileName;
-			});
+			LOG_ERROR("Failed to get non-analyzed matches from match history: {}", error);
+			return;
+		});
 
-			if (found != matches.end())
+		const std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+		std::unordered_set<std::string> replayNames;
+		for (const NonAnalyzedMatch& match : matches)
+		{
+			batch->Matches.emplace(match.Hash, match.Id);
+			replayNames.emplace(String::ToLower(match.ReplayName));
+		}
+
+		std::vector<fs::path> files;
+		for (const auto& entry : fs::recursive_directory_iterator(directory))
+		{
+			if (entry.is_regular_file() && entry.path().extension() == ".wowsreplay" &&
+				replayNames.contains(String::ToLower(entry.path().filename().string())))
 			{
-				AnalyzeReplay(entry.path());
+				// skip replays that are already being analyzed, they commit their summary on their own
+				auto running = m_futures.find(entry.path().native());
+				if (running == m_futures.end() || running->second.wait_for(0s) == std::future_status::ready)
+				{
+					files.emplace_back(entry.path());
+				}
 			}
 		}
-	}
+
+		batch->Remaining = files.size();
+		for (const fs::path& file : files)
+		{
+			AnalyzeBatched(file, batch);
+		}
+	});
 }
@@ -31,6 +31,10 @@ public:
 	bool Decrypt(std::span<const Byte> src, std::span<Byte> dst) const;
 	bool Encrypt(std::span<const Byte> src, std::span<Byte> dst) const;
 
+	// Decrypts the chained mode of the replay stream, where every decrypted block is xored with the previous plaintext block.
+	// prev is the plaintext block before src, all zero at the start of a stream, and is updated so a stream can be decrypted in chunks.
+	bool DecryptCbcLike(std::span<const Byte> src, std::span<Byte> dst, std::array<Byte, 8>& prev) const;
+
 	void EncryptBlock(uint32_t* left, uint32_t* right) const;
 	void DecryptBlock(uint32_t* left, uint32_t* right) const;
 
@@ -42,6 +46,10 @@ private:
 	std::array<uint32_t, N + 2> m_pArray;
 	std::array<std::array<uint32_t, 256>, 4> m_sBoxes;
 	[[nodiscard]] uint32_t F(uint32_t x) const;
+
+	// decrypts Count independent blocks round by round, so the s-box lookups of the blocks can overlap
+	template<size_t Count>
+	void DecryptChained(const Byte* src, Byte* dst, uint64_t& prev) const;
 };
 
 }  // namespace PotatoAlert::Core
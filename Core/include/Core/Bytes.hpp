@@ -3,7 +3,9 @@
 
 #include <Core/String.hpp>
 
+#include <array>
 #include <cassert>
+#include <cstdint>
 #include <cstring>
 #include <iomanip>
 #include <ios>
@@ -11,7 +13,9 @@
 #include <span>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <type_traits>
+#include <vector>
 
 
 namespace PotatoAlert::Core {
@@ -105,6 +109,28 @@ template<is_byte TIn, is_string TStr>
 	return false;
 }
 
+// appends the raw bytes of the value, the counterpart of TakeInto
+template<typename T> requires std::is_trivially_copyable_v<T>
+[[maybe_unused]] static void Write(std::vector<Byte>& out, T value)  // NOLINT(clang-diagnostic-unused-template)
+{
+	const Byte* begin = reinterpret_cast<const Byte*>(&value);
+	out.insert(out.end(), begin, begin + sizeof(T));
+}
+
+// appends the string prefixed by its size as uint32_t
+inline void WriteString(std::vector<Byte>& out, std::string_view str)
+{
+	Write<uint32_t>(out, static_cast<uint32_t>(str.size()));
+	out.insert(out.end(), str.begin(), str.end());
+}
+
+// reads a string written by WriteString
+inline bool ReadString(std::span<const Byte>& data, std::string& out)
+{
+	uint32_t size;
+	return TakeInto(data, size) && TakeString(data, out, size);
+}
+
 template<is_byte TOut, typename... Ts> requires std::conjunction_v<std::is_integral<Ts>...>
 [[maybe_unused]] static std::array<TOut, sizeof...(Ts)> MakeBytes(Ts&&... args) noexcept
 {
@@ -8,6 +8,7 @@
 #include <filesystem>
 #include <span>
 #include <string>
+#include <system_error>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -156,6 +157,10 @@ public:
 		return RawMoveFilePointer(m_handle, 0, FilePointerMoveMethod::Begin);
 	}
 
+	// writes the data to a temporary file next to the path and renames it over the path after,
+	// so a concurrent reader or a crash never leaves a partially written file behind
+	static bool WriteAtomic(const std::filesystem::path& path, std::span<const Byte> data);
+
 	static bool Move(std::string_view src, std::string_view dst)
 	{
 		return RawMove(src, dst);
@@ -232,4 +237,28 @@ private:
 };
 DEFINE_FLAGS(File::Flags)
 
+inline bool File::WriteAtomic(const std::filesystem::path& path, std::span<const Byte> data)
+{
+	std::filesystem::path tempPath = path;
+	tempPath += ".tmp";
+	if (const File file = Open(tempPath, Flags::Open | Flags::Create | Flags::Write | Flags::Truncate))
+	{
+		if (!file.Write(data))
+			return false;
+	}
+	else
+	{
+		return false;
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, path, ec);
+	if (ec)
+	{
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+	return true;
+}
+
 }  // namespace PotatoAlert::Core
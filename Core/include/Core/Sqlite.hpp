@@ -5,8 +5,9 @@
 
 #include <cstdint>
 #include <filesystem>
+#include <memory>
 #include <string>
-#include <utility>
+#include <string_view>
 
 
 namespace PotatoAlert::Core {
@@ -35,35 +36,31 @@ public:
 		PrivateCache     = 0x00040000,
 	};
 
-	SQLite()
+	enum class JournalMode
 	{
-		m_handle = Handle::Null;
-	}
-
-	explicit SQLite(Handle handle) : m_handle(handle) {}
+		Delete,
+		Truncate,
+		Persist,
+		Memory,
+		Wal,
+		Off,
+	};
 
-	SQLite(SQLite&& src) noexcept
+	enum class Synchronous
 	{
-		m_handle = std::exchange(src.m_handle, Handle::Null);
-	}
+		Off,
+		Normal,
+		Full,
+		Extra,
+	};
 
+	SQLite();
+	explicit SQLite(Handle handle);
+	SQLite(SQLite&& src) noexcept;
 	SQLite(const SQLite&) = delete;
-
-	SQLite& operator=(SQLite&& src) noexcept
-	{
-		if (m_handle != Handle::Null)
-			RawClose(m_handle);
-		m_handle = std::exchange(src.m_handle, Handle::Null);
-		return *this;
-	}
-
+	SQLite& operator=(SQLite&& src) noexcept;
 	SQLite& operator=(const SQLite&) = delete;
-
-	~SQLite()
-	{
-		if (m_handle != Handle::Null)
-			RawClose(m_handle);
-	}
+	~SQLite();
 
 	[[nodiscard]] Handle GetHandle() const
 	{
@@ -80,10 +77,8 @@ public:
 		return SQLite(RawOpen(path, flags));
 	}
 
-	void Close()
-	{
-		RawClose(std::exchange(m_handle, Handle::Null));
-	}
+	// finalizes all cached statements, statements still alive are finalized when they are destroyed
+	void Close();
 
 	bool FlushBuffer() const
 	{
@@ -93,6 +88,10 @@ public:
 	[[nodiscard]] std::string GetLastError() const;
 	[[nodiscard]] int64_t GetLastRowId() const;
 
+	// WAL lets readers run next to the writer, together with Synchronous::Normal a commit no longer waits for a sync of the disk
+	bool SetJournalMode(JournalMode mode) const;
+	bool SetSynchronous(Synchronous mode) const;
+
 	bool Execute(std::string_view sql) const
 	{
 		return RawExecute(m_handle, sql, nullptr, nullptr);
@@ -109,6 +108,8 @@ public:
 			&callback);
 	}
 
+	// A prepared statement, which is taken from the statement cache of the database if the same sql was prepared before.
+	// On destruction it is reset and put back into the cache, so it is only prepared once no matter how often it runs.
 	struct Statement
 	{
 	public:
@@ -122,6 +123,7 @@ public:
 		
 		bool Bind(int index, int value) const;
 		bool Bind(int index, uint32_t value) const;
+		bool Bind(int index, int64_t value) const;
 		bool Bind(int index, double value) const;
 		bool Bind(int index, const char* value) const;
 		bool Bind(int index, const std::string& value) const;
@@ -129,6 +131,7 @@ public:
 
 		bool Bind(std::string_view name, int value) const;
 		bool Bind(std::string_view name, uint32_t value) const;
+		bool Bind(std::string_view name, int64_t value) const;
 		bool Bind(std::string_view name, double value) const;
 		bool Bind(std::string_view name, const char* value) const;
 		bool Bind(std::string_view name, const std::string& value) const;
@@ -159,6 +162,34 @@ public:
 		int m_columnCount;
 	};
 
+	// Begins a transaction, which is rolled back on destruction unless it was committed.
+	// Every statement outside of a transaction is committed, and synced to disk, on its own.
+	class Transaction
+	{
+	public:
+		explicit Transaction(const SQLite& db);
+		~Transaction();
+
+		Transaction(Transaction&&) = delete;
+		Transaction(const Transaction&) = delete;
+		Transaction& operator=(const Transaction&) = delete;
+		Transaction& operator=(Transaction&&) = delete;
+
+		bool Commit();
+		void Rollback();
+
+		// Counts one write and commits once batchSize writes are pending, then begins the next transaction.
+		// This bounds the work lost on a failure and how long other connections wait for the lock during a bulk write.
+		bool CommitBatch(size_t batchSize);
+
+		explicit operator bool() const { return m_active; }
+
+	private:
+		const SQLite& m_db;
+		bool m_active;
+		size_t m_pending = 0;
+	};
+
 	explicit operator bool() const
 	{
 		return m_handle != Handle::Null;
@@ -175,7 +206,10 @@ public:
 	}
 
 private:
+	struct StatementCache;
+
 	Handle m_handle;
+	std::unique_ptr<StatementCache> m_statements;
 
 	static Handle RawOpen(std::string_view path, Flags flags);
 	static Handle RawOpen(const std::filesystem::path& path, Flags flags);
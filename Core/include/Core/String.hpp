@@ -31,6 +31,8 @@ void ReplaceAll(std::string& str, std::string_view before, std::string_view afte
 bool Contains(std::string_view str, std::string_view part);
 bool StartsWith(std::string_view str, std::string_view start);
 bool EndsWith(std::string_view str, std::string_view end);
+// '*' matches any run and '?' any single character, neither of them matches a '/'
+bool MatchesGlob(std::string_view str, std::string_view pattern);
 
 template<typename T>
 bool ParseNumber(std::string_view str, T& value) requires std::is_integral_v<T> || std::is_floating_point_v<T>
@@ -1,12 +1,14 @@
 // Copyright 2023 <github.com/razaqq>
 #pragma once
 
+#include "Core/Bytes.hpp"
 #include "Core/Log.hpp"
 #include "Core/Result.hpp"
 
 #include <expected>
 #include <filesystem>
 #include <format>
+#include <span>
 #include <string>
 #include <type_traits>
 
@@ -32,4 +34,15 @@ static inline XmlResult<void> LoadXml(tinyxml2::XMLDocument& doc, const std::fil
 	return {};
 }
 
+template<typename T = void>
+static inline XmlResult<void> ParseXml(tinyxml2::XMLDocument& doc, std::span<const Byte> xml)
+{
+	const tinyxml2::XMLError err = doc.Parse(reinterpret_cast<const char*>(xml.data()), xml.size());
+	if (err != tinyxml2::XML_SUCCESS)
+	{
+		return PA_XML_ERROR("{}", doc.ErrorStr());
+	}
+	return {};
+}
+
 }  // namespace PotatoAlert::Core
@@ -3,12 +3,52 @@
 
 #include "Core/Bytes.hpp"
 
+#include <memory>
+#include <optional>
 #include <span>
 #include <vector>
 
 
+struct z_stream_s;
+
 namespace PotatoAlert::Core::Zlib {
 
-std::vector<Byte> Inflate(std::span<const Byte> in, bool hasHeader = true);
+// The output grows geometrically from the size hint, give the inflated size if it is known to allocate only once.
+std::vector<Byte> Inflate(std::span<const Byte> in, bool hasHeader = true, size_t sizeHint = 0);
+// Inflates the whole stream into out, returns the inflated size or nullopt if the stream is invalid or does not fit.
+std::optional<size_t> Inflate(std::span<const Byte> in, std::span<Byte> out, bool hasHeader = true);
+
+// Incrementally inflates a stream that is fed in pieces, without ever holding the whole input or output.
+class Inflater
+{
+public:
+	enum class Status
+	{
+		Ok,
+		StreamEnd,
+		Error,
+	};
+
+	explicit Inflater(bool hasHeader = true);
+	Inflater(const Inflater&) = delete;
+	Inflater(Inflater&&) = delete;
+	Inflater& operator=(const Inflater&) = delete;
+	Inflater& operator=(Inflater&&) = delete;
+	~Inflater();
+
+	// Inflates as much of in into out as possible, both spans are advanced past the consumed input and produced output.
+	// Returns Ok if more input or output space is required to make progress.
+	Status Inflate(std::span<const Byte>& in, std::span<Byte>& out);
+
+	// Starts a new stream, keeping the allocated state of the previous one.
+	bool Reset();
+
+	// Starts a new stream and inflates all of it into out, see Zlib::Inflate.
+	std::optional<size_t> InflateAll(std::span<const Byte> in, std::span<Byte> out);
+
+private:
+	std::unique_ptr<z_stream_s> m_stream;
+	bool m_initialized = false;
+};
 
 }  // namespace PotatoAlert::Core::Zlib
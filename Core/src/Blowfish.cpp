@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <array>
 #include <bit>
+#include <cstdint>
 #include <cstring>
 #include <memory>
 #include <span>
@@ -13,6 +14,10 @@
 
 
 using PotatoAlert::Core::Blowfish;
+using PotatoAlert::Core::Byte;
+
+// blocks decrypted at once by DecryptCbcLike, enough to hide the latency of the dependent s-box lookups of one block
+static constexpr size_t InterleavedBlocks = 4;
 
 static const std::array<uint32_t, N + 2> P = {
 	0x243F6A88L, 0x85A308D3L, 0x13198A2EL, 0x03707344L, 0xA4093822L,
@@ -381,6 +386,74 @@ bool Blowfish::Decrypt(std::span<const Byte> src, std::span<Byte> dst) const
 	return true;
 }
 
+bool Blowfish::DecryptCbcLike(std::span<const Byte> src, std::span<Byte> dst, std::array<Byte, 8>& prev) const
+{
+	if (dst.size() < src.size())
+	{
+		return false;
+	}
+
+	if (src.size() % BlockSize() != 0)
+	{
+		return false;
+	}
+
+	uint64_t chain;
+	std::memcpy(&chain, prev.data(), sizeof(chain));
+
+	const size_t blocks = src.size() / BlockSize();
+	size_t i = 0;
+	for (; i + InterleavedBlocks <= blocks; i += InterleavedBlocks)
+	{
+		DecryptChained<InterleavedBlocks>(src.data() + i * BlockSize(), dst.data() + i * BlockSize(), chain);
+	}
+	for (; i < blocks; i++)
+	{
+		DecryptChained<1>(src.data() + i * BlockSize(), dst.data() + i * BlockSize(), chain);
+	}
+
+	std::memcpy(prev.data(), &chain, sizeof(chain));
+	return true;
+}
+
+template<size_t Count>
+void Blowfish::DecryptChained(const Byte* src, Byte* dst, uint64_t& prev) const
+{
+	std::array<uint32_t, Count> left;
+	std::array<uint32_t, Count> right;
+	for (size_t j = 0; j < Count; j++)
+	{
+		uint32_t block[2];
+		std::memcpy(block, src + j * BlockSize(), sizeof(block));
+		left[j] = std::byteswap(block[0]);
+		right[j] = std::byteswap(block[1]);
+	}
+
+	// two rounds of DecryptBlock per iteration, which swaps the halves after every round
+	for (size_t i = N + 1; i > 1; i -= 2)
+	{
+		for (size_t j = 0; j < Count; j++)
+		{
+			left[j] ^= m_pArray[i];
+			right[j] ^= F(left[j]);
+		}
+		for (size_t j = 0; j < Count; j++)
+		{
+			right[j] ^= m_pArray[i - 1];
+			left[j] ^= F(right[j]);
+		}
+	}
+
+	for (size_t j = 0; j < Count; j++)
+	{
+		const uint32_t block[2] = { std::byteswap(right[j] ^ m_pArray[0]), std::byteswap(left[j] ^ m_pArray[1]) };
+		uint64_t plain;
+		std::memcpy(&plain, block, sizeof(plain));
+		prev ^= plain;
+		std::memcpy(dst + j * BlockSize(), &prev, sizeof(prev));
+	}
+}
+
 void Blowfish::EncryptBlock(uint32_t* left, uint32_t* right) const
 {
 	for (size_t i = 0; i < N; ++i)
@@ -233,7 +233,9 @@ bool File::RawWrite(Handle handle, std::span<const T> data, bool resetFilePointe
 		return false;
 	}
 
-	if (ftruncate64(UnwrapHandle<int>(handle), data.size() == -1))
+	// like SetEndOfFile, the file ends where the write did, which is not the size of the data when appending
+	const off64_t end = lseek64(UnwrapHandle<int>(handle), 0, SEEK_CUR);
+	if (end == -1 || ftruncate64(UnwrapHandle<int>(handle), end) == -1)
 	{
 		// TODO: handle error
 		return false;
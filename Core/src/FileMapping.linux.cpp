@@ -4,9 +4,13 @@
 #include "Core/FileMapping.hpp"
 
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#include <cerrno>
 #include <cstdint>
+#include <cstring>
+#include <string>
 
 
 using PotatoAlert::Core::File;
@@ -29,27 +33,47 @@ static constexpr T UnwrapHandle(FileMapping::Handle handle)
 template<typename T>
 static constexpr T UnwrapHandle(File::Handle handle)
 {
-	return reinterpret_cast<T>(static_cast<uintptr_t>(handle) - 1);
+	return static_cast<T>(static_cast<uintptr_t>(handle) - 1);
 }
 
 }  // namespace
 
 std::string FileMapping::LastError()
 {
-	return "";
+	return std::strerror(errno);
 }
 
 FileMapping::Handle FileMapping::RawOpen(File::Handle file, Flags flags, uint64_t maxSize)
 {
+	// the mapping keeps its own descriptor, so it stays valid after the file is closed
+	const int fd = dup(UnwrapHandle<int>(file));
+	if (fd == -1)
+	{
+		return Handle::Null;
+	}
+
+	// like CreateFileMapping, a writable mapping grows the file to its maximum size
+	if (HasFlag(flags, Flags::Write))
+	{
+		struct stat st;
+		if (fstat(fd, &st) == -1 || (static_cast<uint64_t>(st.st_size) < maxSize && ftruncate(fd, static_cast<off_t>(maxSize)) == -1))
+		{
+			close(fd);
+			return Handle::Null;
+		}
+	}
+
+	return CreateHandle<Handle>(fd);
 }
 
 void FileMapping::RawClose(Handle handle)
 {
+	close(UnwrapHandle<int>(handle));
 }
 
 void* FileMapping::RawMap(Handle handle, Flags flags, uint64_t offset, size_t size)
 {
-	int prot = 0;
+	int prot = PROT_NONE;
 
 	if (HasFlag(flags, Flags::Read))
 		prot |= PROT_READ;
@@ -57,14 +81,12 @@ void* FileMapping::RawMap(Handle handle, Flags flags, uint64_t offset, size_t si
 		prot |= PROT_WRITE;
 	if (HasFlag(flags, Flags::Execute))
 		prot |= PROT_EXEC;
-	if (HasFlag(flags, Flags::None))
-		prot |= PROT_NONE;
-
-	int shareFlag = 0;
 
-	size_t length = 0;
-	long pageSize = sysconf(_SC_PAGE_SIZE);
-	void* addr = mmap(nullptr, length, prot, shareFlag, UnwrapHandle<int>(handle), offset);
+	void* addr = mmap(nullptr, size, prot, MAP_SHARED, UnwrapHandle<int>(handle), static_cast<off_t>(offset));
+	if (addr == MAP_FAILED)
+	{
+		return nullptr;
+	}
 	return addr;
 }
 
@@ -7,8 +7,14 @@
 #include <cstdint>
 #include <filesystem>
 #include <limits>
+#include <memory>
+#include <mutex>
+#include <ranges>
 #include <string>
+#include <string_view>
 #include <type_traits>
+#include <unordered_map>
+#include <utility>
 
 
 using PotatoAlert::Core::SQLite;
@@ -23,6 +29,84 @@ static sqlite3* UnwrapHandle(SQLite::Handle handle)
 	return reinterpret_cast<sqlite3*>(static_cast<uintptr_t>(handle));
 }
 
+// Prepared statements by their sql, a statement is taken out while it is used, so it is never shared between threads.
+struct SQLite::StatementCache
+{
+	// statements with generated sql, like lists of ids, would otherwise grow the cache forever
+	static constexpr size_t MaxSize = 64;
+
+	std::mutex Mutex;
+	std::unordered_map<std::string, sqlite3_stmt*> Statements;
+
+	~StatementCache()
+	{
+		for (sqlite3_stmt* stmt : Statements | std::views::values)
+		{
+			sqlite3_finalize(stmt);
+		}
+	}
+
+	sqlite3_stmt* Take(std::string_view sql)
+	{
+		std::unique_lock lock(Mutex);
+		if (auto it = Statements.find(std::string(sql)); it != Statements.end())
+		{
+			sqlite3_stmt* stmt = it->second;
+			Statements.erase(it);
+			return stmt;
+		}
+		return nullptr;
+	}
+
+	// returns false if the statement was not cached and has to be finalized
+	bool Return(sqlite3_stmt* stmt)
+	{
+		sqlite3_reset(stmt);
+		sqlite3_clear_bindings(stmt);
+
+		std::unique_lock lock(Mutex);
+		if (Statements.size() >= MaxSize)
+		{
+			return false;
+		}
+		return Statements.emplace(sqlite3_sql(stmt), stmt).second;
+	}
+};
+
+SQLite::SQLite() : m_handle(Handle::Null)
+{
+}
+
+SQLite::SQLite(Handle handle) : m_handle(handle), m_statements(std::make_unique<StatementCache>())
+{
+}
+
+SQLite::SQLite(SQLite&& src) noexcept
+	: m_handle(std::exchange(src.m_handle, Handle::Null)), m_statements(std::move(src.m_statements))
+{
+}
+
+SQLite& SQLite::operator=(SQLite&& src) noexcept
+{
+	Close();
+	m_handle = std::exchange(src.m_handle, Handle::Null);
+	m_statements = std::move(src.m_statements);
+	return *this;
+}
+
+SQLite::~SQLite()
+{
+	Close();
+}
+
+void SQLite::Close()
+{
+	// the statements have to be finalized before the connection is closed
+	m_statements.reset();
+	if (m_handle != Handle::Null)
+		RawClose(std::exchange(m_handle, Handle::Null));
+}
+
 SQLite::Handle SQLite::RawOpen(std::string_view path, Flags flags)
 {
 	sqlite3* db;
@@ -62,6 +146,42 @@ int64_t SQLite::GetLastRowId() const
 	return sqlite3_last_insert_rowid(UnwrapHandle(m_handle));
 }
 
+bool SQLite::SetJournalMode(JournalMode mode) const
+{
+	switch (mode)
+	{
+		case JournalMode::Delete:
+			return Execute("PRAGMA journal_mode = DELETE");
+		case JournalMode::Truncate:
+			return Execute("PRAGMA journal_mode = TRUNCATE");
+		case JournalMode::Persist:
+			return Execute("PRAGMA journal_mode = PERSIST");
+		case JournalMode::Memory:
+			return Execute("PRAGMA journal_mode = MEMORY");
+		case JournalMode::Wal:
+			return Execute("PRAGMA journal_mode = WAL");
+		case JournalMode::Off:
+			return Execute("PRAGMA journal_mode = OFF");
+	}
+	return false;
+}
+
+bool SQLite::SetSynchronous(Synchronous mode) const
+{
+	switch (mode)
+	{
+		case Synchronous::Off:
+			return Execute("PRAGMA synchronous = OFF");
+		case Synchronous::Normal:
+			return Execute("PRAGMA synchronous = NORMAL");
+		case Synchronous::Full:
+			return Execute("PRAGMA synchronous = FULL");
+		case Synchronous::Extra:
+			return Execute("PRAGMA synchronous = EXTRA");
+	}
+	return false;
+}
+
 bool SQLite::RawExecute(Handle handle, std::string_view sql, int (*callback)(void* ctx, int columns, char** columnText, char** columnNames), void* context)
 {
 	return sqlite3_exec(UnwrapHandle(handle), std::string(sql).c_str(), callback, context, nullptr) == SQLITE_OK;
@@ -71,15 +191,26 @@ bool SQLite::RawExecute(Handle handle, std::string_view sql, int (*callback)(voi
 
 SQLite::Statement::Statement(const SQLite& db, std::string_view sql) : m_db(db)
 {
-	sqlite3_stmt* stmt;
-	m_valid = sqlite3_prepare_v2(UnwrapHandle(db.m_handle), sql.data(), -1, &stmt, nullptr) == SQLITE_OK;
+	sqlite3_stmt* stmt = db.m_statements ? db.m_statements->Take(sql) : nullptr;
+	if (stmt != nullptr)
+	{
+		m_valid = true;
+	}
+	else
+	{
+		m_valid = sqlite3_prepare_v3(UnwrapHandle(db.m_handle), std::string(sql).c_str(), -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) == SQLITE_OK;
+	}
 	m_stmt = reinterpret_cast<uintptr_t>(stmt);
 	m_columnCount = sqlite3_column_count(stmt);
 }
 
 SQLite::Statement::~Statement()
 {
-	sqlite3_finalize(reinterpret_cast<sqlite3_stmt*>(m_stmt));
+	sqlite3_stmt* stmt = reinterpret_cast<sqlite3_stmt*>(m_stmt);
+	if (!m_valid || !m_db.m_statements || !m_db.m_statements->Return(stmt))
+	{
+		sqlite3_finalize(stmt);
+	}
 }
 
 
@@ -93,6 +224,11 @@ bool SQLite::Statement::Bind(int index, uint32_t value) const
 	return sqlite3_bind_int(reinterpret_cast<sqlite3_stmt*>(m_stmt), index, value) == SQLITE_OK;
 }
 
+bool SQLite::Statement::Bind(int index, int64_t value) const
+{
+	return sqlite3_bind_int64(reinterpret_cast<sqlite3_stmt*>(m_stmt), index, value) == SQLITE_OK;
+}
+
 bool SQLite::Statement::Bind(int index, double value) const
 {
 	return sqlite3_bind_double(reinterpret_cast<sqlite3_stmt*>(m_stmt), index, value) == SQLITE_OK;
@@ -131,6 +267,15 @@ bool SQLite::Statement::Bind(std::string_view name, uint32_t value) const
 	return false;
 }
 
+bool SQLite::Statement::Bind(std::string_view name, int64_t value) const
+{
+	if (const int index = sqlite3_bind_parameter_index(reinterpret_cast<sqlite3_stmt*>(m_stmt), name.data()))
+	{
+		return Bind(index, value);
+	}
+	return false;
+}
+
 bool SQLite::Statement::Bind(std::string_view name, double value) const
 {
 	if (const int index = sqlite3_bind_parameter_index(reinterpret_cast<sqlite3_stmt*>(m_stmt), name.data()))
@@ -167,6 +312,62 @@ bool SQLite::Statement::Bind(std::string_view name, std::string_view value) cons
 	return false;
 }
 
+// ----------------------------------------------
+
+SQLite::Transaction::Transaction(const SQLite& db) : m_db(db)
+{
+	m_active = m_db.Execute("BEGIN TRANSACTION");
+}
+
+SQLite::Transaction::~Transaction()
+{
+	Rollback();
+}
+
+bool SQLite::Transaction::Commit()
+{
+	if (!m_active)
+	{
+		return false;
+	}
+
+	// a failed commit is still active, so the error can be read before it is rolled back
+	if (!m_db.Execute("COMMIT TRANSACTION"))
+	{
+		return false;
+	}
+	m_active = false;
+	m_pending = 0;
+	return true;
+}
+
+void SQLite::Transaction::Rollback()
+{
+	if (m_active)
+	{
+		m_db.Execute("ROLLBACK TRANSACTION");
+		m_active = false;
+		m_pending = 0;
+	}
+}
+
+bool SQLite::Transaction::CommitBatch(size_t batchSize)
+{
+	if (++m_pending < batchSize)
+	{
+		return m_active;
+	}
+
+	if (!Commit())
+	{
+		return false;
+	}
+	m_active = m_db.Execute("BEGIN TRANSACTION");
+	return m_active;
+}
+
+// ----------------------------------------------
+
 void SQLite::Statement::ExecuteStep()
 {
 	int ret = sqlite3_step(reinterpret_cast<sqlite3_stmt*>(m_stmt));
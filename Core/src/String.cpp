@@ -164,6 +164,41 @@ bool s::EndsWith(std::string_view str, std::string_view end)
 	return str.substr(str.size() - end.size(), end.size()) == end;
 }
 
+bool s::MatchesGlob(std::string_view str, std::string_view pattern)
+{
+	// a star only ever backtracks within one path component
+	size_t p = 0;
+	size_t s = 0;
+	size_t star = std::string_view::npos;
+	size_t starMatch = 0;
+	while (s < str.size())
+	{
+		if (p < pattern.size() && (pattern[p] == str[s] || (pattern[p] == '?' && str[s] != '/')))
+		{
+			p++;
+			s++;
+		}
+		else if (p < pattern.size() && pattern[p] == '*')
+		{
+			star = p++;
+			starMatch = s;
+		}
+		else if (star != std::string_view::npos && str[starMatch] != '/')
+		{
+			p = star + 1;
+			s = ++starMatch;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	while (p < pattern.size() && pattern[p] == '*')
+		p++;
+	return p == pattern.size();
+}
+
 std::string s::ReplaceAll(std::string_view str, std::string_view before, std::string_view after)
 {
 	std::string newString;
@@ -7,52 +7,128 @@
 
 #include "zlib.h"
 
-#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <span>
 #include <vector>
 
 
-std::vector<Byte> PotatoAlert::Core::Zlib::Inflate(std::span<const Byte> in, bool hasHeader)
+using PotatoAlert::Core::Zlib::Inflater;
+
+namespace {
+
+static constexpr size_t MinInflateSize = 4096;
+
+}  // namespace
+
+std::vector<Byte> PotatoAlert::Core::Zlib::Inflate(std::span<const Byte> in, bool hasHeader, size_t sizeHint)
 {
-	std::vector<Byte> out;
-	unsigned char chunk[2048];
-
-	z_stream stream = {};
-	int ret = 0;
-	if (hasHeader)
-		ret = inflateInit(&stream);
-	else
-		ret = inflateInit2(&stream, -15);
-
-	stream.next_in = reinterpret_cast<const Bytef*>(in.data());
-	stream.avail_in = static_cast<uInt>(in.size());
-
-	do {
-		do {
-			stream.next_out = chunk;
-			stream.avail_out = sizeof(chunk);
-
-			ret = inflate(&stream, Z_NO_FLUSH);
-			switch (ret)
-			{
-				case Z_OK:
-				case Z_STREAM_END:
-					break;
-
-				default:
-					out.resize(0);
-					goto exit;
-			}
-
-			size_t size = sizeof(chunk) - stream.avail_out;
-
-			size_t pos = out.size();
-			out.resize(out.size() + size);
-			std::memcpy(out.data() + pos, chunk, size);
-		} while (stream.avail_out == 0);
-	} while (ret != Z_STREAM_END);
-
-exit:
-	inflateEnd(&stream);
+	Inflater inflater(hasHeader);
+	std::vector<Byte> out(sizeHint > 0 ? sizeHint : std::max(2 * in.size(), MinInflateSize));
+	size_t size = 0;
+
+	Inflater::Status status = Inflater::Status::Ok;
+	while (status == Inflater::Status::Ok)
+	{
+		if (size == out.size())
+		{
+			out.resize(2 * out.size());
+		}
+
+		std::span<Byte> free{ out.data() + size, out.size() - size };
+		const size_t available = in.size() + free.size();
+		status = inflater.Inflate(in, free);
+		size = out.size() - free.size();
+
+		// there is always output space, so no progress means the input is truncated
+		if (status == Inflater::Status::Ok && in.size() + free.size() == available)
+		{
+			status = Inflater::Status::Error;
+		}
+	}
+
+	if (status != Inflater::Status::StreamEnd)
+	{
+		return {};
+	}
+	out.resize(size);
 	return out;
 }
+
+std::optional<size_t> PotatoAlert::Core::Zlib::Inflate(std::span<const Byte> in, std::span<Byte> out, bool hasHeader)
+{
+	Inflater inflater(hasHeader);
+	return inflater.InflateAll(in, out);
+}
+
+
+Inflater::Inflater(bool hasHeader) : m_stream(std::make_unique<z_stream>())
+{
+	m_initialized = (hasHeader ? inflateInit(m_stream.get()) : inflateInit2(m_stream.get(), -15)) == Z_OK;
+}
+
+Inflater::~Inflater()
+{
+	if (m_stream && m_initialized)
+		inflateEnd(m_stream.get());
+}
+
+bool Inflater::Reset()
+{
+	return m_initialized && inflateReset(m_stream.get()) == Z_OK;
+}
+
+Inflater::Status Inflater::Inflate(std::span<const Byte>& in, std::span<Byte>& out)
+{
+	if (!m_initialized)
+		return Status::Error;
+
+	// zlib counts in uInt, anything beyond that is left for the next call
+	const uInt inSize = static_cast<uInt>(std::min<size_t>(in.size(), std::numeric_limits<uInt>::max()));
+	const uInt outSize = static_cast<uInt>(std::min<size_t>(out.size(), std::numeric_limits<uInt>::max()));
+
+	m_stream->next_in = reinterpret_cast<const Bytef*>(in.data());
+	m_stream->avail_in = inSize;
+	// zlib rejects a null output even if there is nothing to write
+	Bytef empty;
+	m_stream->next_out = out.empty() ? &empty : reinterpret_cast<Bytef*>(out.data());
+	m_stream->avail_out = outSize;
+
+	const int ret = inflate(m_stream.get(), Z_NO_FLUSH);
+
+	in = in.subspan(inSize - m_stream->avail_in);
+	out = out.subspan(outSize - m_stream->avail_out);
+
+	switch (ret)
+	{
+		case Z_OK:
+		case Z_BUF_ERROR:  // no progress was possible, not fatal
+			return Status::Ok;
+		case Z_STREAM_END:
+			return Status::StreamEnd;
+		default:
+			return Status::Error;
+	}
+}
+
+std::optional<size_t> Inflater::InflateAll(std::span<const Byte> in, std::span<Byte> out)
+{
+	if (!Reset())
+		return {};
+
+	const size_t outSize = out.size();
+	Status status = Status::Ok;
+	while (status == Status::Ok)
+	{
+		const size_t available = in.size() + out.size();
+		status = Inflate(in, out);
+		if (in.size() + out.size() == available)
+			break;
+	}
+
+	if (status != Status::StreamEnd)
+		return {};
+	return outSize - out.size();
+}
@@ -6,10 +6,15 @@
 #include <array>
 #include <cstddef>
 #include <filesystem>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 
 namespace PotatoAlert::GameFileUnpack {
@@ -30,7 +35,7 @@ struct IdxHeader
 	int64_t Unknown1;
 	int64_t Unknown2;
 
-	static std::optional<IdxHeader> Parse(std::span<Core::Byte> data);
+	static std::optional<IdxHeader> Parse(std::span<const Core::Byte> data);
 };
 
 static constexpr uint32_t NodeSize = 32;
@@ -41,7 +46,7 @@ struct Node
 	uint64_t Parent;
 	std::array<Core::Byte, 8> Unknown;
 
-	static std::optional<Node> Parse(std::span<Core::Byte> data, std::span<Core::Byte> fullData);
+	static std::optional<Node> Parse(std::span<const Core::Byte> data, std::span<const Core::Byte> fullData);
 };
 
 static constexpr uint32_t FileRecordSize = 48;
@@ -54,7 +59,7 @@ struct FileRecord
 	int32_t Size;
 	int64_t UncompressedSize;
 
-	static std::optional<FileRecord> Parse(std::span<Core::Byte> data, const std::unordered_map<uint64_t, Node>& nodes);
+	static std::optional<FileRecord> Parse(std::span<const Core::Byte> data, const std::unordered_map<uint64_t, Node>& nodes);
 };
 
 
@@ -64,40 +69,164 @@ struct IdxFile
 	std::unordered_map<uint64_t, Node> Nodes;
 	std::unordered_map<std::string, FileRecord> Files;
 
-	static std::optional<IdxFile> Parse(std::span<Core::Byte> data);
+	static std::optional<IdxFile> Parse(std::span<const Core::Byte> data);
+	// parses only the file records, each with its pkg name and full path, without keeping any maps around
+	static std::optional<std::vector<FileRecord>> ParseRecords(std::span<const Core::Byte> data);
 };
 
+// A file of a DirectoryTree, its strings point into the tree it was found in.
+struct FileView
+{
+	std::string_view PkgName;
+	std::string_view Path;
+	uint64_t Id;
+	int64_t Offset;
+	int32_t Size;
+	int64_t UncompressedSize;
+};
+
+// Stores all paths in one string pool and keeps the files sorted by path,
+// so every directory is a contiguous range of files and lookups never allocate.
 class DirectoryTree
 {
+	struct Entry
+	{
+		uint32_t Path;  // offset into the string pool
+		uint32_t PathSize;
+		uint32_t PkgName;  // index into the pkg names
+		int32_t Size;
+		uint64_t Id;
+		int64_t Offset;
+		int64_t UncompressedSize;
+	};
+
 public:
-	struct TreeNode
+	class Files
 	{
-		std::unordered_map<std::string, TreeNode> Nodes;
-		std::optional<FileRecord> File;
+	public:
+		class Iterator
+		{
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = FileView;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = FileView;
+
+			Iterator() = default;
+
+			FileView operator*() const { return m_tree->View(*m_entry); }
+			Iterator& operator++() { ++m_entry; return *this; }
+			Iterator operator++(int) { Iterator it = *this; ++m_entry; return it; }
+			bool operator==(const Iterator& other) const = default;
+
+		private:
+			friend class Files;
+			Iterator(const DirectoryTree* tree, const Entry* entry) : m_tree(tree), m_entry(entry) {}
+
+			const DirectoryTree* m_tree = nullptr;
+			const Entry* m_entry = nullptr;
+		};
+
+		[[nodiscard]] Iterator begin() const { return { m_tree, m_entries.data() }; }
+		[[nodiscard]] Iterator end() const { return { m_tree, m_entries.data() + m_entries.size() }; }
+		[[nodiscard]] size_t size() const { return m_entries.size(); }
+		[[nodiscard]] bool empty() const { return m_entries.empty(); }
+
+	private:
+		friend class DirectoryTree;
+		Files(const DirectoryTree* tree, std::span<const Entry> entries) : m_tree(tree), m_entries(entries) {}
+
+		const DirectoryTree* m_tree;
+		std::span<const Entry> m_entries;
 	};
 
-	void Insert(const FileRecord& fileRecord);
-	[[nodiscard]] std::optional<TreeNode> Find(std::string_view path) const;
+	DirectoryTree() = default;
+	// if a path occurs more than once, the last record wins
+	explicit DirectoryTree(std::span<const FileRecord> records);
+
+	// the file with exactly this path, otherwise every file below the directory with this path
+	[[nodiscard]] Files Find(std::string_view path) const;
+	// only the file with exactly this path
+	[[nodiscard]] std::optional<FileView> FindFile(std::string_view path) const;
+	// every file matching the pattern, '*' matches any number and '?' a single character other than '/'
+	[[nodiscard]] std::vector<FileView> Glob(std::string_view pattern) const;
+	[[nodiscard]] size_t Size() const { return m_entries.size(); }
+
+private:
+	std::string m_strings;
+	std::vector<std::string> m_pkgNames;
+	std::vector<Entry> m_entries;
+
+	[[nodiscard]] std::string_view Path(const Entry& entry) const
+	{
+		return std::string_view(m_strings).substr(entry.Path, entry.PathSize);
+	}
+	[[nodiscard]] FileView View(const Entry& entry) const;
+	[[nodiscard]] const Entry* FindEntry(std::string_view path) const;
+	[[nodiscard]] std::span<const Entry> Prefixed(std::string_view prefix) const;
+};
+
+// A file inside the pkgs, read without extracting it to disk. Stored files point straight into the mapped pkg,
+// compressed ones are inflated on first access. Must not outlive the Unpacker it was opened from.
+class GameFile
+{
+public:
+	[[nodiscard]] std::span<const Core::Byte> Data() const;
+	[[nodiscard]] size_t Size() const { return m_size; }
+	[[nodiscard]] std::string_view Path() const { return m_path; }
 
 private:
-	TreeNode m_root;
+	friend class Unpacker;
+	GameFile(std::string_view path, std::span<const Core::Byte> raw, size_t size) : m_path(path), m_raw(raw), m_size(size) {}
 
-	TreeNode& CreatePath(std::string_view path);
+	std::string_view m_path;
+	std::span<const Core::Byte> m_raw;
+	size_t m_size;
+	mutable std::optional<std::vector<Core::Byte>> m_inflated;
 };
 
+// compressed files of at least this size are inflated straight into a mapping of the output file
+static constexpr uint64_t MappedInflateSize = 1024 * 1024;
+
+// Inflates the raw deflate data into a new file at path, which has to inflate to exactly size bytes.
+// Smaller files are inflated through a buffer, as is any file that fails to be mapped.
+bool InflateFile(const std::filesystem::path& path, std::span<const Core::Byte> data, uint64_t size, uint64_t mappedInflateSize = MappedInflateSize);
+
 class Unpacker
 {
 public:
-	Unpacker(const std::filesystem::path& pkgPath, const std::filesystem::path& idxPath);
-	Unpacker(std::string_view pkgPath, std::string_view idxPath);
+	// Loads every idx file below idxPath in parallel. If a cache file is given, the combined index is stored in it
+	// and loaded from it instead as long as no idx file was added, removed or modified.
+	Unpacker(const std::filesystem::path& pkgPath, const std::filesystem::path& idxPath, const std::filesystem::path& cacheFile = {});
+	Unpacker(std::string_view pkgPath, std::string_view idxPath, std::string_view cacheFile = {});
+	Unpacker(const Unpacker&) = delete;
+	Unpacker(Unpacker&&) = delete;
+	Unpacker& operator=(const Unpacker&) = delete;
+	Unpacker& operator=(Unpacker&&) = delete;
+	~Unpacker();
+
+	// Extracts all files below the node, reading each pkg front to back and inflating and writing on a thread pool.
 	bool Extract(std::string_view node, const std::filesystem::path& dst) const;
 	bool Extract(std::string_view node, std::string_view dst) const;
 
+	// Read-only access to single files, the pkg of a file is mapped on first use.
+	[[nodiscard]] bool Exists(std::string_view path) const;
+	[[nodiscard]] std::optional<GameFile> Open(std::string_view path) const;
+	[[nodiscard]] const DirectoryTree& Files() const { return m_directoryTree; }
+
 private:
+	struct PkgFile;
+
 	DirectoryTree m_directoryTree;
 	std::filesystem::path m_pkgPath;
 
-	bool ExtractFile(const FileRecord& fileRecord, const std::filesystem::path& dst) const;
+	// every pkg is opened and mapped once and stays mapped for the lifetime of the unpacker
+	mutable std::mutex m_pkgMutex;
+	mutable std::unordered_map<std::string, std::unique_ptr<PkgFile>> m_pkgFiles;
+
+	const PkgFile* GetPkgFile(std::string_view pkgName) const;
+	static bool ExtractFile(const FileView& fileRecord, std::span<const Core::Byte> pkgData, const std::filesystem::path& dst);
 };
 
 }  // namespace PotatoAlert::GameFileUnpack
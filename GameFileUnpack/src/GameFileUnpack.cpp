@@ -5,36 +5,57 @@
 #include "Core/FileMapping.hpp"
 #include "Core/Log.hpp"
 #include "Core/String.hpp"
+#include "Core/ThreadPool.hpp"
 #include "Core/Zlib.hpp"
 
 #include "GameFileUnpack/GameFileUnpack.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <filesystem>
+#include <future>
+#include <iterator>
+#include <mutex>
 #include <optional>
+#include <set>
 #include <string>
 #include <span>
+#include <tuple>
+#include <unordered_map>
 #include <vector>
 
 
 using PotatoAlert::Core::Byte;
 using PotatoAlert::Core::File;
 using PotatoAlert::Core::FileMapping;
+using PotatoAlert::Core::ReadString;
+using PotatoAlert::Core::String::MatchesGlob;
 using PotatoAlert::Core::Take;
 using PotatoAlert::Core::TakeInto;
 using PotatoAlert::Core::TakeString;
+using PotatoAlert::Core::ThreadPool;
+using PotatoAlert::Core::Write;
+using PotatoAlert::Core::WriteString;
+using PotatoAlert::Core::Zlib::Inflater;
+namespace Zlib = PotatoAlert::Core::Zlib;
 using PotatoAlert::GameFileUnpack::DirectoryTree;
-using TreeNode = DirectoryTree::TreeNode;
 using PotatoAlert::GameFileUnpack::IdxFile;
 using PotatoAlert::GameFileUnpack::IdxHeader;
 using PotatoAlert::GameFileUnpack::Node;
 using PotatoAlert::GameFileUnpack::FileRecord;
+using PotatoAlert::GameFileUnpack::FileRecordSize;
+using PotatoAlert::GameFileUnpack::FileView;
+using PotatoAlert::GameFileUnpack::GameFile;
+using PotatoAlert::GameFileUnpack::HeaderSize;
+using PotatoAlert::GameFileUnpack::NodeSize;
 using PotatoAlert::GameFileUnpack::Unpacker;
 
 namespace fs = std::filesystem;
 
 namespace {
 
-static bool ReadNullTerminatedString(std::span<Byte> data, int64_t offset, std::string& out)
+static bool ReadNullTerminatedString(std::span<const Byte> data, int64_t offset, std::string& out)
 {
 	size_t length = 0;
 	for (int64_t i = offset; i < data.size(); i++)
@@ -61,6 +82,245 @@ static bool ReadNullTerminatedString(std::span<Byte> data, int64_t offset, std::
 	return true;
 }
 
+static constexpr uint32_t IndexCacheMagic = 0x58494150;  // "PAIX"
+static constexpr uint32_t IndexCacheVersion = 1;
+
+struct IdxFileInfo
+{
+	fs::path Path;
+	std::string Name;  // relative to the idx directory
+	uint64_t Size;
+	int64_t Time;
+};
+
+static std::optional<std::vector<FileRecord>> ParseIdxFile(const fs::path& path)
+{
+	const File file = File::Open(path, File::Flags::Open | File::Flags::Read);
+	if (!file)
+	{
+		LOG_ERROR("Failed to open idxFile for reading: {}", File::LastError());
+		return {};
+	}
+
+	const uint64_t fileSize = file.Size();
+	FileMapping mapping = FileMapping::Open(file, FileMapping::Flags::Read, fileSize);
+	if (!mapping)
+	{
+		LOG_ERROR("Failed to create idxFile mapping: {}", FileMapping::LastError());
+		return {};
+	}
+
+	const void* dataPtr = mapping.Map(FileMapping::Flags::Read, 0, fileSize);
+	if (!dataPtr)
+	{
+		LOG_ERROR("Failed to map idxFile into memory: {}", FileMapping::LastError());
+		return {};
+	}
+
+	std::optional<std::vector<FileRecord>> records = IdxFile::ParseRecords(std::span{ static_cast<const Byte*>(dataPtr), fileSize });
+	mapping.Unmap(dataPtr, fileSize);
+	if (!records)
+	{
+		LOG_ERROR(STR("Failed to parse idxFile {}"), path);
+	}
+	return records;
+}
+
+static std::optional<std::vector<FileRecord>> LoadIndexCache(const fs::path& path, std::span<const IdxFileInfo> idxFiles)
+{
+	std::vector<Byte> bytes;
+	if (const File file = File::Open(path, File::Flags::Open | File::Flags::Read))
+	{
+		if (!file.ReadAll(bytes))
+			return {};
+	}
+	else
+	{
+		return {};
+	}
+
+	std::span<const Byte> data = bytes;
+	uint32_t magic, formatVersion, idxCount;
+	if (!TakeInto(data, magic) || !TakeInto(data, formatVersion) || !TakeInto(data, idxCount))
+		return {};
+
+	if (magic != IndexCacheMagic || formatVersion != IndexCacheVersion || idxCount != idxFiles.size())
+		return {};
+
+	for (const IdxFileInfo& idxFile : idxFiles)
+	{
+		std::string name;
+		uint64_t size;
+		int64_t time;
+		if (!ReadString(data, name) || !TakeInto(data, size) || !TakeInto(data, time))
+			return {};
+		if (name != idxFile.Name || size != idxFile.Size || time != idxFile.Time)
+			return {};
+	}
+
+	uint32_t pkgCount;
+	if (!TakeInto(data, pkgCount))
+		return {};
+	std::vector<std::string> pkgNames(pkgCount);
+	for (std::string& pkgName : pkgNames)
+	{
+		if (!ReadString(data, pkgName))
+			return {};
+	}
+
+	uint32_t recordCount;
+	if (!TakeInto(data, recordCount))
+		return {};
+	std::vector<FileRecord> records(recordCount);
+	for (FileRecord& record : records)
+	{
+		uint32_t pkg;
+		if (!TakeInto(data, pkg) || pkg >= pkgNames.size() || !ReadString(data, record.Path) || !TakeInto(data, record.Id) ||
+			!TakeInto(data, record.Offset) || !TakeInto(data, record.Size) || !TakeInto(data, record.UncompressedSize))
+			return {};
+		record.PkgName = pkgNames[pkg];
+	}
+
+	if (!data.empty())
+		return {};
+
+	return records;
+}
+
+static void WriteIndexCache(const fs::path& path, std::span<const IdxFileInfo> idxFiles, std::span<const FileRecord> records)
+{
+	std::vector<Byte> data;
+	Write<uint32_t>(data, IndexCacheMagic);
+	Write<uint32_t>(data, IndexCacheVersion);
+	Write<uint32_t>(data, static_cast<uint32_t>(idxFiles.size()));
+	for (const IdxFileInfo& idxFile : idxFiles)
+	{
+		WriteString(data, idxFile.Name);
+		Write<uint64_t>(data, idxFile.Size);
+		Write<int64_t>(data, idxFile.Time);
+	}
+
+	// every pkg holds thousands of files, so its name is only stored once
+	std::vector<std::string_view> pkgNames;
+	std::unordered_map<std::string_view, uint32_t> pkgIndices;
+	for (const FileRecord& record : records)
+	{
+		if (pkgIndices.emplace(record.PkgName, static_cast<uint32_t>(pkgNames.size())).second)
+			pkgNames.emplace_back(record.PkgName);
+	}
+	Write<uint32_t>(data, static_cast<uint32_t>(pkgNames.size()));
+	for (std::string_view pkgName : pkgNames)
+	{
+		WriteString(data, pkgName);
+	}
+
+	Write<uint32_t>(data, static_cast<uint32_t>(records.size()));
+	for (const FileRecord& record : records)
+	{
+		Write<uint32_t>(data, pkgIndices.at(record.PkgName));
+		WriteString(data, record.Path);
+		Write<uint64_t>(data, record.Id);
+		Write<int64_t>(data, record.Offset);
+		Write<int32_t>(data, record.Size);
+		Write<int64_t>(data, record.UncompressedSize);
+	}
+
+	std::error_code ec;
+	fs::create_directories(path.parent_path(), ec);
+
+	if (!File::WriteAtomic(path, data))
+	{
+		LOG_WARN(STR("Failed to write idx cache {} - {}"), path, StringWrap(File::LastError()));
+	}
+}
+
+// upper bound for the inflate buffers of files that are queued or being extracted
+static constexpr uint64_t MaxInFlightBytes = 256 * 1024 * 1024;
+// compressed files are inflated through a buffer of at most this size, unless they are inflated into a mapping
+static constexpr uint64_t InflateBufferSize = 256 * 1024;
+
+// Blocks the producer until enough of the budget was released by the consumers.
+class MemoryBudget
+{
+public:
+	explicit MemoryBudget(uint64_t capacity) : m_available(capacity), m_capacity(capacity) {}
+
+	// acquires the size, but at most the whole capacity, so a single file larger than it still gets extracted on its own
+	uint64_t Acquire(uint64_t size)
+	{
+		const uint64_t acquired = std::min(size, m_capacity);
+		std::unique_lock lock(m_mutex);
+		m_released.wait(lock, [this, acquired]() { return m_available >= acquired; });
+		m_available -= acquired;
+		return acquired;
+	}
+
+	void Release(uint64_t size)
+	{
+		{
+			std::unique_lock lock(m_mutex);
+			m_available += size;
+		}
+		m_released.notify_one();
+	}
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_released;
+	uint64_t m_available;
+	const uint64_t m_capacity;
+};
+
+// Inflates into a writable mapping of the output file, which grows the file to its final size up front.
+// Returns nullopt if the file could not be mapped, nothing was inflated yet in that case.
+static std::optional<bool> InflateIntoMapping(const File& file, std::span<const Byte> data, uint64_t size)
+{
+	FileMapping mapping = FileMapping::Open(file, FileMapping::Flags::Read | FileMapping::Flags::Write, size);
+	if (!mapping)
+	{
+		return {};
+	}
+
+	void* view = mapping.Map(FileMapping::Flags::Read | FileMapping::Flags::Write, 0, size);
+	if (!view)
+	{
+		return {};
+	}
+
+	const std::optional<size_t> inflated = Zlib::Inflate(data, std::span{ static_cast<Byte*>(view), size }, false);
+	mapping.Unmap(view, size);
+
+	return inflated == size;
+}
+
+// Inflates through a fixed buffer, writing each filled buffer to the end of the file.
+static bool InflateThroughBuffer(const File& file, std::span<const Byte> data, uint64_t size)
+{
+	std::vector<Byte> buffer(static_cast<size_t>(std::clamp<uint64_t>(size, 1, InflateBufferSize)));
+
+	Inflater inflater(false);
+	Inflater::Status status = Inflater::Status::Ok;
+	uint64_t written = 0;
+	while (status == Inflater::Status::Ok)
+	{
+		std::span<Byte> out = buffer;
+		const size_t available = data.size();
+		status = inflater.Inflate(data, out);
+
+		const size_t produced = buffer.size() - out.size();
+		if (produced > 0 && !file.Write(std::span<const Byte>(buffer.data(), produced), false))
+		{
+			return false;
+		}
+		written += produced;
+
+		if (produced == 0 && available == data.size())
+			break;
+	}
+
+	return status == Inflater::Status::StreamEnd && written == size;
+}
+
 static bool WriteFileData(const fs::path& file, std::span<const Byte> data)
 {
 	// write the data
@@ -82,59 +342,200 @@ static bool WriteFileData(const fs::path& file, std::span<const Byte> data)
 
 }
 
-std::optional<DirectoryTree::TreeNode> DirectoryTree::Find(std::string_view path) const
+bool PotatoAlert::GameFileUnpack::InflateFile(const fs::path& path, std::span<const Byte> data, uint64_t size, uint64_t mappedInflateSize)
 {
-	const TreeNode* current = &m_root;
-	for (std::string_view part : Core::String::Split(path, "/"))
+	const File file = File::Open(path, File::Flags::Open | File::Flags::Create | File::Flags::Read | File::Flags::Write | File::Flags::Truncate);
+	if (!file)
+	{
+		LOG_ERROR(STR("Failed to open file for writing {} - {}"), path, StringWrap(File::LastError()));
+		return false;
+	}
+
+	std::optional<bool> inflated;
+	if (size >= mappedInflateSize)
 	{
-		if (part.empty()) continue;
-		if (auto it = current->Nodes.find(part.data()); it != current->Nodes.end())
+		inflated = InflateIntoMapping(file, data, size);
+	}
+	if (!inflated)
+	{
+		inflated = InflateThroughBuffer(file, data, size);
+	}
+
+	if (!inflated.value() || file.Size() != size)
+	{
+		LOG_ERROR(STR("Failed to inflate {} bytes into {}"), size, path);
+		return false;
+	}
+	return true;
+}
+
+DirectoryTree::DirectoryTree(std::span<const FileRecord> records)
+{
+	std::vector<const FileRecord*> sorted;
+	sorted.reserve(records.size());
+	for (const FileRecord& record : records)
+	{
+		sorted.emplace_back(&record);
+	}
+	std::ranges::stable_sort(sorted, [](const FileRecord* left, const FileRecord* right)
+	{
+		return left->Path < right->Path;
+	});
+
+	size_t stringsSize = 0;
+	for (const FileRecord* record : sorted)
+	{
+		stringsSize += record->Path.size();
+	}
+	m_strings.reserve(stringsSize);
+	m_entries.reserve(sorted.size());
+
+	std::unordered_map<std::string_view, uint32_t> pkgIndices;
+	for (size_t i = 0; i < sorted.size(); i++)
+	{
+		const FileRecord& record = *sorted[i];
+		if (i + 1 < sorted.size() && sorted[i + 1]->Path == record.Path)
 		{
-			current = &it->second;
+			continue;
 		}
-		else
+
+		auto [it, inserted] = pkgIndices.emplace(record.PkgName, static_cast<uint32_t>(m_pkgNames.size()));
+		if (inserted)
 		{
-			return {};
+			m_pkgNames.emplace_back(record.PkgName);
 		}
-	}
 
-	return *current;
+		m_entries.emplace_back(Entry
+		{
+			.Path = static_cast<uint32_t>(m_strings.size()),
+			.PathSize = static_cast<uint32_t>(record.Path.size()),
+			.PkgName = it->second,
+			.Size = record.Size,
+			.Id = record.Id,
+			.Offset = record.Offset,
+			.UncompressedSize = record.UncompressedSize,
+		});
+		m_strings.append(record.Path);
+	}
 }
 
-void DirectoryTree::Insert(const FileRecord& fileRecord)
+DirectoryTree::Files DirectoryTree::Find(std::string_view path) const
 {
-	if (const size_t pos = fileRecord.Path.rfind('/'); pos != std::string::npos)
+	while (path.starts_with('/'))
+		path.remove_prefix(1);
+	while (path.ends_with('/'))
+		path.remove_suffix(1);
+
+	if (path.empty())
 	{
-		TreeNode& node = CreatePath(fileRecord.Path);
-		node.File = fileRecord;
+		return { this, m_entries };
 	}
-	else
+
+	if (const Entry* file = FindEntry(path))
+	{
+		return { this, std::span(file, 1) };
+	}
+
+	// orders the paths below the directory as equal, all others before or after them
+	auto compare = [path](std::string_view other) -> int
+	{
+		if (const int result = other.substr(0, path.size()).compare(path); result != 0)
+			return result;
+		if (other.size() == path.size())
+			return -1;
+		return other[path.size()] < '/' ? -1 : other[path.size()] > '/' ? 1 : 0;
+	};
+	const auto first = std::ranges::partition_point(m_entries, [this, &compare](const Entry& entry)
+	{
+		return compare(Path(entry)) < 0;
+	});
+	const auto last = std::partition_point(first, m_entries.end(), [this, &compare](const Entry& entry)
+	{
+		return compare(Path(entry)) == 0;
+	});
+	return { this, std::span(first, last) };
+}
+
+std::optional<FileView> DirectoryTree::FindFile(std::string_view path) const
+{
+	while (path.starts_with('/'))
+		path.remove_prefix(1);
+
+	if (const Entry* file = FindEntry(path))
 	{
-		m_root.Nodes[fileRecord.Path] = TreeNode{ .File = fileRecord };
+		return View(*file);
 	}
+	return {};
 }
 
-DirectoryTree::TreeNode& DirectoryTree::CreatePath(std::string_view path)
+std::vector<FileView> DirectoryTree::Glob(std::string_view pattern) const
 {
-	TreeNode* current = &m_root;
-	for (std::string_view part : Core::String::Split(path, "/"))
+	std::vector<FileView> files;
+	for (const Entry& entry : Prefixed(pattern.substr(0, pattern.find_first_of("*?"))))
 	{
-		if (part.empty()) continue;
-		if (auto it = current->Nodes.find(part.data()); it != current->Nodes.end())
+		if (MatchesGlob(Path(entry), pattern))
 		{
-			current = &it->second;
+			files.emplace_back(View(entry));
 		}
-		else
-		{
-			// can ignore the 2nd value since we already checked if it exists
-			auto [node, _] = current->Nodes.emplace(part, TreeNode{});
-			current = &node->second;
- 		}
 	}
-	return *current;
+	return files;
+}
+
+FileView DirectoryTree::View(const Entry& entry) const
+{
+	return FileView
+	{
+		.PkgName = m_pkgNames[entry.PkgName],
+		.Path = Path(entry),
+		.Id = entry.Id,
+		.Offset = entry.Offset,
+		.Size = entry.Size,
+		.UncompressedSize = entry.UncompressedSize,
+	};
+}
+
+const DirectoryTree::Entry* DirectoryTree::FindEntry(std::string_view path) const
+{
+	const auto file = std::ranges::lower_bound(m_entries, path, {}, [this](const Entry& entry)
+	{
+		return Path(entry);
+	});
+	if (file != m_entries.end() && Path(*file) == path)
+	{
+		return &*file;
+	}
+	return nullptr;
+}
+
+std::span<const DirectoryTree::Entry> DirectoryTree::Prefixed(std::string_view prefix) const
+{
+	const auto first = std::ranges::partition_point(m_entries, [this, prefix](const Entry& entry)
+	{
+		return Path(entry).substr(0, prefix.size()) < prefix;
+	});
+	const auto last = std::partition_point(first, m_entries.end(), [this, prefix](const Entry& entry)
+	{
+		return Path(entry).starts_with(prefix);
+	});
+	return std::span(first, last);
 }
 
-Unpacker::Unpacker(const fs::path& pkgPath, const fs::path& idxPath) : m_pkgPath(pkgPath)
+struct Unpacker::PkgFile
+{
+	File Handle;
+	FileMapping Mapping;
+	std::span<const Byte> Data;
+
+	~PkgFile()
+	{
+		if (!Data.empty())
+			Mapping.Unmap(Data.data(), Data.size());
+	}
+};
+
+Unpacker::~Unpacker() = default;
+
+Unpacker::Unpacker(const fs::path& pkgPath, const fs::path& idxPath, const fs::path& cacheFile) : m_pkgPath(pkgPath)
 {
 	if (!fs::exists(idxPath))
 	{
@@ -142,78 +543,136 @@ Unpacker::Unpacker(const fs::path& pkgPath, const fs::path& idxPath) : m_pkgPath
 		return;
 	}
 
+	std::vector<IdxFileInfo> idxFiles;
 	for (const auto& entry : fs::recursive_directory_iterator(idxPath))
 	{
 		if (entry.is_regular_file() && entry.path().extension() == ".idx")
 		{
-			if (File file = File::Open(entry.path(), File::Flags::Open | File::Flags::Read))
-			{
-				if (std::vector<Byte> data; file.ReadAll(data))
-				{
-					if (std::optional<IdxFile> idxFileRes = IdxFile::Parse(std::span{ data }))
-					{
-						IdxFile idxFile = idxFileRes.value();
-						for (const auto& [path, fileRecord] : idxFile.Files)
-						{
-							m_directoryTree.Insert(
-									FileRecord{ idxFile.PkgName, path, fileRecord.Id, fileRecord.Offset, fileRecord.Size, fileRecord.UncompressedSize });
-						}
-					}
-					else
-					{
-						LOG_ERROR("Failed to parse idxFile");
-					}
-				}
-				else
-				{
-					LOG_ERROR("Failed to read idxFile: {}", File::LastError());
-				}
-			}
-			else
-			{
-				LOG_ERROR("Failed to open idxFile for reading: {}", File::LastError());
-			}
+			std::error_code ec;
+			const fs::file_time_type time = entry.last_write_time(ec);
+			idxFiles.emplace_back(IdxFileInfo{ entry.path(), fs::relative(entry.path(), idxPath, ec).generic_string(), entry.file_size(ec), time.time_since_epoch().count() });
 		}
 	}
-}
+	std::ranges::sort(idxFiles, [](const IdxFileInfo& left, const IdxFileInfo& right)
+	{
+		return left.Name < right.Name;
+	});
 
-Unpacker::Unpacker(std::string_view pkgPath, std::string_view idxPath) : m_pkgPath(pkgPath)
-{
-	Unpacker(fs::path(pkgPath), fs::path(idxPath));
+	if (!cacheFile.empty())
+	{
+		if (std::optional<std::vector<FileRecord>> records = LoadIndexCache(cacheFile, idxFiles))
+		{
+			m_directoryTree = DirectoryTree(records.value());
+			return;
+		}
+	}
+
+	ThreadPool threadPool;
+	std::vector<std::future<std::optional<std::vector<FileRecord>>>> parsed;
+	parsed.reserve(idxFiles.size());
+	for (const IdxFileInfo& idxFile : idxFiles)
+	{
+		parsed.emplace_back(threadPool.Enqueue(ParseIdxFile, idxFile.Path));
+	}
+
+	bool complete = true;
+	std::vector<FileRecord> records;
+	for (std::future<std::optional<std::vector<FileRecord>>>& result : parsed)
+	{
+		if (std::optional<std::vector<FileRecord>> fileRecords = result.get())
+		{
+			std::ranges::move(fileRecords.value(), std::back_inserter(records));
+		}
+		else
+		{
+			complete = false;
+		}
+	}
+
+	// never cache a partial index, the failed idx files would be missing until one of them changes
+	if (!cacheFile.empty() && complete)
+	{
+		WriteIndexCache(cacheFile, idxFiles, records);
+	}
+
+	m_directoryTree = DirectoryTree(records);
 }
 
+Unpacker::Unpacker(std::string_view pkgPath, std::string_view idxPath, std::string_view cacheFile)
+	: Unpacker(fs::path(pkgPath), fs::path(idxPath), fs::path(cacheFile)) {}
+
 bool Unpacker::Extract(std::string_view nodeName, const fs::path& dst) const
 {
-	std::optional<DirectoryTree::TreeNode> nodeResult = m_directoryTree.Find(nodeName);
-	if (!nodeResult)
+	const DirectoryTree::Files files = m_directoryTree.Find(nodeName);
+	if (files.empty())
 	{
 		LOG_ERROR("There exists no node with name {} in directory tree", nodeName);
 		return false;
 	}
-	TreeNode rootNode = nodeResult.value();
+	std::vector<FileView> records(files.begin(), files.end());
+
+	// group the files by pkg and read every pkg sequentially
+	std::ranges::sort(records, [](const FileView& left, const FileView& right)
+	{
+		return std::tie(left.PkgName, left.Offset) < std::tie(right.PkgName, right.Offset);
+	});
+
+	// create all output directories up front, so the workers only write files
+	std::set<fs::path> directories;
+	for (const FileView& record : records)
+	{
+		directories.emplace((dst / record.Path).parent_path());
+	}
+	for (const fs::path& directory : directories)
+	{
+		std::error_code ec;
+		fs::create_directories(directory, ec);
+		if (ec)
+		{
+			LOG_ERROR("Failed to create game file scripts directory: {}", ec);
+			return false;
+		}
+	}
 
-	std::vector<TreeNode*> stack = { &rootNode };
+	ThreadPool threadPool;
+	MemoryBudget budget(MaxInFlightBytes);
+	std::atomic<bool> failed = false;
 
-	while (!stack.empty())
+	const PkgFile* pkgFile = nullptr;
+	std::string_view pkgName;
+	for (const FileView& record : records)
 	{
-		TreeNode* node = stack.back();
-		stack.pop_back();
-		for (auto& [_, child] : node->Nodes)
+		if (!pkgFile || record.PkgName != pkgName)
+		{
+			pkgName = record.PkgName;
+			pkgFile = GetPkgFile(pkgName);
+		}
+		if (!pkgFile)
 		{
-			stack.push_back(&child);
+			failed = true;
 		}
 
-		if (node->File)
+		if (failed)
 		{
-			if (!ExtractFile(node->File.value(), dst))
+			break;
+		}
+
+		// stored files are written straight from the mapping, only inflated ones need a buffer
+		const bool compressed = record.Size != record.UncompressedSize;
+		const uint64_t cost = budget.Acquire(compressed ? std::min(static_cast<uint64_t>(record.UncompressedSize), InflateBufferSize) : 0);
+		threadPool.Enqueue([&record, pkgFile, cost, &dst, &budget, &failed]()
+		{
+			if (!ExtractFile(record, pkgFile->Data, dst))
 			{
-				LOG_ERROR("Failed to extract file: {}", node->File.value().Path);
-				return false;
+				LOG_ERROR("Failed to extract file: {}", record.Path);
+				failed = true;
 			}
-		}
+			budget.Release(cost);
+		});
 	}
 
-	return true;
+	threadPool.WaitUntilNothingInFlight();
+	return !failed;
 }
 
 bool Unpacker::Extract(std::string_view nodeName, std::string_view dst) const
@@ -221,69 +680,119 @@ bool Unpacker::Extract(std::string_view nodeName, std::string_view dst) const
 	return Extract(nodeName, fs::path(dst));
 }
 
-bool Unpacker::ExtractFile(const FileRecord& fileRecord, const fs::path& dst) const
+bool Unpacker::Exists(std::string_view path) const
+{
+	return m_directoryTree.FindFile(path).has_value();
+}
+
+std::optional<GameFile> Unpacker::Open(std::string_view path) const
 {
-	if (File inFile = File::Open(m_pkgPath / fileRecord.PkgName, File::Flags::Open | File::Flags::Read))
+	const std::optional<FileView> fileResult = m_directoryTree.FindFile(path);
+	if (!fileResult)
 	{
-		uint64_t fileSize = inFile.Size();
-		if (FileMapping mapping = FileMapping::Open(inFile, FileMapping::Flags::Read, fileSize))
-		{
-			if (const void* dataPtr = mapping.Map(FileMapping::Flags::Read, 0, fileSize))
-			{
-				if (fileRecord.Offset + fileRecord.Size > fileSize)
-				{
-					LOG_ERROR("Got offset ({} - {}) out of size bounds ({})",
-							  fileRecord.Offset, fileRecord.Offset + fileRecord.Size, fileSize);
-					return false;
-				}
-
-				// create output directories if they don't exist yet
-				const fs::path outDir = (fs::path(dst) / fileRecord.Path).remove_filename();
-				if (!fs::exists(outDir))
-				{
-					std::error_code ec;
-					fs::create_directories(outDir, ec);
-					if (ec)
-					{
-						LOG_ERROR("Failed to create game file scripts directory: {}", ec);
-						return false;
-					}
-				}
-
-				const fs::path filePath = fs::path(dst) / fileRecord.Path;
-
-				// check if data is compressed and inflate
-				std::span data{ static_cast<const Byte*>(dataPtr), fileSize };
-				if (fileRecord.Size != fileRecord.UncompressedSize)
-				{
-					std::vector<Byte> inflated = Core::Zlib::Inflate(
-						data.subspan(fileRecord.Offset, fileRecord.Size), false
-					);
-					return WriteFileData(filePath, std::span{ inflated });
-				}
-
-				return WriteFileData(filePath, data.subspan(fileRecord.Offset, fileRecord.Size));
-			}
-			else
-			{
-				LOG_ERROR("Failed to map PkgFile into memory: {}", FileMapping::LastError());
-				return false;
-			}
-		}
-		else
+		LOG_ERROR("There exists no file with name {} in directory tree", path);
+		return {};
+	}
+	const FileView file = fileResult.value();
+
+	const PkgFile* pkgFile = GetPkgFile(file.PkgName);
+	if (!pkgFile)
+	{
+		return {};
+	}
+
+	if (file.Offset < 0 || file.Size < 0 || file.UncompressedSize < 0 ||
+		static_cast<uint64_t>(file.Offset + file.Size) > pkgFile->Data.size())
+	{
+		LOG_ERROR("Got offset ({} - {}) out of size bounds ({})", file.Offset, file.Offset + file.Size, pkgFile->Data.size());
+		return {};
+	}
+
+	return GameFile(file.Path, pkgFile->Data.subspan(file.Offset, file.Size), static_cast<size_t>(file.UncompressedSize));
+}
+
+std::span<const Byte> GameFile::Data() const
+{
+	if (m_raw.size() == m_size)
+	{
+		return m_raw;
+	}
+
+	if (!m_inflated)
+	{
+		m_inflated.emplace(m_size);
+		if (Core::Zlib::Inflate(m_raw, *m_inflated, false) != m_size)
 		{
-			LOG_ERROR("Failed to create file mapping: {}", FileMapping::LastError());
-			return false;
+			LOG_ERROR("Failed to inflate {} into {} bytes", m_path, m_size);
+			m_inflated->clear();
 		}
 	}
-	else
+	return *m_inflated;
+}
+
+const Unpacker::PkgFile* Unpacker::GetPkgFile(std::string_view pkgName) const
+{
+	std::unique_lock lock(m_pkgMutex);
+
+	if (auto it = m_pkgFiles.find(std::string(pkgName)); it != m_pkgFiles.end())
+	{
+		return it->second.get();
+	}
+
+	std::unique_ptr<PkgFile> pkgFile = std::make_unique<PkgFile>();
+	pkgFile->Handle = File::Open(m_pkgPath / pkgName, File::Flags::Open | File::Flags::Read);
+	if (!pkgFile->Handle)
 	{
 		LOG_ERROR("Failed to open pkg file for reading: {}", File::LastError());
+		return nullptr;
+	}
+
+	const uint64_t fileSize = pkgFile->Handle.Size();
+	pkgFile->Mapping = FileMapping::Open(pkgFile->Handle, FileMapping::Flags::Read, fileSize);
+	if (!pkgFile->Mapping)
+	{
+		LOG_ERROR("Failed to create file mapping: {}", FileMapping::LastError());
+		return nullptr;
+	}
+
+	const void* dataPtr = pkgFile->Mapping.Map(FileMapping::Flags::Read, 0, fileSize);
+	if (!dataPtr)
+	{
+		LOG_ERROR("Failed to map PkgFile into memory: {}", FileMapping::LastError());
+		return nullptr;
+	}
+	pkgFile->Data = std::span{ static_cast<const Byte*>(dataPtr), fileSize };
+
+	return m_pkgFiles.emplace(std::string(pkgName), std::move(pkgFile)).first->second.get();
+}
+
+bool Unpacker::ExtractFile(const FileView& fileRecord, std::span<const Byte> pkgData, const fs::path& dst)
+{
+	if (fileRecord.Offset < 0 || fileRecord.Size < 0 || static_cast<uint64_t>(fileRecord.Offset + fileRecord.Size) > pkgData.size())
+	{
+		LOG_ERROR("Got offset ({} - {}) out of size bounds ({})",
+				  fileRecord.Offset, fileRecord.Offset + fileRecord.Size, pkgData.size());
 		return false;
 	}
+
+	const fs::path filePath = dst / fileRecord.Path;
+	const std::span<const Byte> data = pkgData.subspan(fileRecord.Offset, fileRecord.Size);
+
+	// check if data is compressed and inflate
+	if (fileRecord.Size != fileRecord.UncompressedSize)
+	{
+		if (fileRecord.UncompressedSize < 0)
+		{
+			LOG_ERROR("Invalid uncompressed size {} of {}", fileRecord.UncompressedSize, fileRecord.Path);
+			return false;
+		}
+		return InflateFile(filePath, data, static_cast<uint64_t>(fileRecord.UncompressedSize));
+	}
+
+	return WriteFileData(filePath, data);
 }
 
-std::optional<IdxHeader> IdxHeader::Parse(std::span<Byte> data)
+std::optional<IdxHeader> IdxHeader::Parse(std::span<const Byte> data)
 {
 	if (data.size() != HeaderSize)
 	{
@@ -324,7 +833,7 @@ std::optional<IdxHeader> IdxHeader::Parse(std::span<Byte> data)
 	return header;
 }
 
-std::optional<Node> Node::Parse(std::span<Byte> data, std::span<Byte> fullData)
+std::optional<Node> Node::Parse(std::span<const Byte> data, std::span<const Byte> fullData)
 {
 	if (data.size() != NodeSize)
 	{
@@ -362,7 +871,7 @@ std::optional<Node> Node::Parse(std::span<Byte> data, std::span<Byte> fullData)
 	return node;
 }
 
-std::optional<FileRecord> FileRecord::Parse(std::span<Byte> data, const std::unordered_map<uint64_t, Node>& nodes)
+std::optional<FileRecord> FileRecord::Parse(std::span<const Byte> data, const std::unordered_map<uint64_t, Node>& nodes)
 {
 	if (data.size() != FileRecordSize)
 	{
@@ -406,7 +915,7 @@ std::optional<FileRecord> FileRecord::Parse(std::span<Byte> data, const std::uno
 	return fileRecord;
 }
 
-std::optional<IdxFile> IdxFile::Parse(std::span<Byte> data)
+static std::optional<IdxFile> ParseIdx(std::span<const Byte> data, std::vector<FileRecord>& records)
 {
 	const std::span originalData = data;
 
@@ -437,7 +946,9 @@ std::optional<IdxFile> IdxFile::Parse(std::span<Byte> data)
 
 	for (int32_t i = 0; i < header.Nodes; i++)
 	{
-		if (std::optional<Node> nodeResult = Node::Parse(Take(data, NodeSize), data))
+		// the name pointer is relative to the start of the node, copy the span before taking from it
+		const std::span<const Byte> nodeData = data;
+		if (std::optional<Node> nodeResult = Node::Parse(Take(data, NodeSize), nodeData))
 		{
 			file.Nodes[nodeResult.value().Id] = nodeResult.value();
 		}
@@ -462,11 +973,12 @@ std::optional<IdxFile> IdxFile::Parse(std::span<Byte> data)
 				  header.Files, header.Files * FileRecordSize, data.size());
 		return {};
 	}
+	records.reserve(header.Files);
 	for (int32_t i = 0; i < header.Files; i++)
 	{
 		if (std::optional<FileRecord> fileRecordResult = FileRecord::Parse(Take(fileRecordData, FileRecordSize), file.Nodes))
 		{
-			file.Files[fileRecordResult.value().Path] = fileRecordResult.value();
+			records.emplace_back(std::move(fileRecordResult.value()));
 		}
 		else
 		{
@@ -503,3 +1015,36 @@ std::optional<IdxFile> IdxFile::Parse(std::span<Byte> data)
 
 	return file;
 }
+
+std::optional<IdxFile> IdxFile::Parse(std::span<const Byte> data)
+{
+	std::vector<FileRecord> records;
+	std::optional<IdxFile> file = ParseIdx(data, records);
+	if (!file)
+	{
+		return {};
+	}
+
+	for (FileRecord& record : records)
+	{
+		std::string path = record.Path;
+		file->Files.emplace(std::move(path), std::move(record));
+	}
+	return file;
+}
+
+std::optional<std::vector<FileRecord>> IdxFile::ParseRecords(std::span<const Byte> data)
+{
+	std::vector<FileRecord> records;
+	const std::optional<IdxFile> file = ParseIdx(data, records);
+	if (!file)
+	{
+		return {};
+	}
+
+	for (FileRecord& record : records)
+	{
+		record.PkgName = file->PkgName;
+	}
+	return records;
+}
@@ -8,13 +8,15 @@
 #include "Gui/IconButton.hpp"
 #include "Gui/MatchHistory/MatchHistoryFilter.hpp"
 #include "Gui/MatchHistory/MatchHistoryModel.hpp"
-#include "Gui/MatchHistory/MatchHistorySortFilter.hpp"
 #include "Gui/MatchHistory/MatchHistoryView.hpp"
 #include "Gui/Pagination.hpp"
 
 #include <QLabel>
 #include <QPushButton>
 
+#include <cstdint>
+#include <vector>
+
 
 namespace PotatoAlert::Gui {
 
@@ -25,9 +27,9 @@ class MatchHistory : public QWidget
 public:
 	explicit MatchHistory(const Client::ServiceProvider& serviceProvider, QWidget* parent = nullptr);
 
-	void SwitchPage(int page) const;
+	void SwitchPage(int page);
 	[[nodiscard]] int PageCount() const;
-	void AddMatch(const Client::Match& match) const;
+	void AddMatch(const Client::Match& match);
 	void SetReplaySummary(uint32_t id, const ReplaySummary& summary) const;
 	
 	bool eventFilter(QObject* watched, QEvent* event) override;
@@ -45,8 +47,8 @@ public:
 	}
 
 private:
-	void LoadMatches() const;
-	void Refresh() const;
+	void LoadMatches();
+	void Refresh();
 
 private:
 	const Client::ServiceProvider& m_services;
@@ -55,10 +57,12 @@ private:
 	MatchHistoryFilter* m_filter = new MatchHistoryFilter(m_filterButton, this);
 	MatchHistoryView* m_view;
 	MatchHistoryModel* m_model;
-	MatchHistorySortFilter* m_sortFilter;
 	QLabel* m_entryCount = new QLabel();
 	Pagination* m_pagination = new Pagination();
 	int m_page = 0;
+	uint32_t m_matchCount = 0;
+	std::vector<Client::MatchListKey> m_pageKeys;  // the key of the last match of every page up to the furthest one read
+	uint32_t m_pageRequest = 0;  // only the result of the latest SwitchPage is shown
 	static constexpr int EntriesPerPage = 100;
 
 signals:
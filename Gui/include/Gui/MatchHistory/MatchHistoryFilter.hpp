@@ -62,14 +62,10 @@ public:
 	explicit MatchHistoryFilter(QWidget* align, QWidget* parent = nullptr);
 
 	void AdjustPosition();
-	void BuildFilter(std::span<const Client::Match> matches) const;
-
-	[[nodiscard]] const Filter& ShipFilter() const { return m_shipList->GetFilter(); }
-	[[nodiscard]] const Filter& MapFilter() const { return m_mapList->GetFilter(); }
-	[[nodiscard]] const Filter& ModeFilter() const { return m_modeList->GetFilter(); }
-	[[nodiscard]] const Filter& StatsModeFilter() const { return m_statsModeList->GetFilter(); }
-	[[nodiscard]] const Filter& PlayerFilter() const { return m_playerList->GetFilter(); }
-	[[nodiscard]] const Filter& RegionFilter() const { return m_regionList->GetFilter(); }
+	void BuildFilter(const Client::MatchFilterValues& values) const;
+
+	// the checked values of every list, a list with all values checked does not filter
+	[[nodiscard]] Client::MatchFilter GetMatchFilter() const;
 
 private:
 	QWidget* m_align;
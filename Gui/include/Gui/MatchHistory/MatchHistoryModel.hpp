@@ -42,25 +42,11 @@ public:
 		return m_matches[idx];
 	}
 
-	void DeleteMatch(size_t idx)
-	{
-		m_matches.erase(m_matches.begin() + idx);
-	}
-
-	void AddMatch(const Client::Match& match)
-	{
-		m_matches.push_back(match);
-	}
-
-	void SetMatches(std::vector<Client::Match>&& matches)
-	{
-		m_matches = std::move(matches);
-	}
+	// the model only holds the matches of the current page, filtered and sorted by the database
+	void SetMatches(std::vector<Client::Match>&& matches);
 
 	void SetReplaySummary(uint32_t id, const ReplaySummary& summary);
 
-	static std::time_t GetMatchTime(const Client::Match& match);
-
 	[[nodiscard]] QVariant data(const QModelIndex& index, int role) const override;
 	[[nodiscard]] QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
 
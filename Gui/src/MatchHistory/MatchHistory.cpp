@@ -1,39 +1,50 @@
 // Copyright 2022 <github.com/razaqq>
 
 #include "Client/Config.hpp"
+#include "Client/DatabaseExecutor.hpp"
 #include "Client/DatabaseManager.hpp"
 #include "Client/ServiceProvider.hpp"
 #include "Client/StatsParser.hpp"
 #include "Client/StringTable.hpp"
 
-#include "Core/Instrumentor.hpp"
 #include "Core/Log.hpp"
 
 #include "Gui/Events.hpp"
 #include "Gui/Fonts.hpp"
 #include "Gui/MatchHistory/MatchHistory.hpp"
 #include "Gui/MatchHistory/MatchHistoryModel.hpp"
-#include "Gui/MatchHistory/MatchHistorySortFilter.hpp"
 #include "Gui/MatchHistory/MatchHistoryView.hpp"
 #include "Gui/MatchHistory/ReplaySummaryButtonDelegate.hpp"
 #include "Gui/QuestionDialog.hpp"
 
 #include <QHBoxLayout>
-#include <QSortFilterProxyModel>
+#include <QSignalBlocker>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <format>
+#include <optional>
+#include <string>
+#include <utility>
 #include <vector>
 
 
 using PotatoAlert::Client::Config;
 using PotatoAlert::Client::ConfigKey;
+using PotatoAlert::Client::DatabaseExecutor;
 using PotatoAlert::Client::DatabaseManager;
+using PotatoAlert::Client::Match;
+using PotatoAlert::Client::MatchListKey;
+using PotatoAlert::Client::MatchListPage;
+using PotatoAlert::Client::SqlResult;
 using PotatoAlert::Client::StatsParser::MatchContext;
 using PotatoAlert::Client::StatsParser::ParseMatch;
 using PotatoAlert::Client::StringTable::GetString;
 using PotatoAlert::Client::StringTable::StringTableKey;
 using PotatoAlert::Gui::MatchHistory;
 
+
 MatchHistory::MatchHistory(const Client::ServiceProvider& serviceProvider, QWidget* parent) : QWidget(parent), m_services(serviceProvider)
 {
 	qApp->installEventFilter(this);
@@ -41,22 +52,33 @@ MatchHistory::MatchHistory(const Client::ServiceProvider& serviceProvider, QWidg
 	m_view = new MatchHistoryView();
 	m_model = new MatchHistoryModel(m_services);
 
-	m_sortFilter = new MatchHistorySortFilter(m_filter, m_model);
-	m_sortFilter->setSourceModel(m_model);
-
 	ReplaySummaryButtonDelegate* summaryButtonDelegate = new ReplaySummaryButtonDelegate();
 	connect(summaryButtonDelegate, &ReplaySummaryButtonDelegate::ReplaySummarySelected, [this](const QModelIndex& index)
 	{
-		emit ReplaySummarySelected(m_model->GetMatch(m_sortFilter->mapToSource(index).row()));
+		// the model only holds the list entry, the summary is loaded when it is opened
+		const uint32_t matchId = m_model->GetMatch(index.row()).Id;
+		m_services.Get<DatabaseExecutor>().Read([matchId](const DatabaseManager& dbm)
+		{
+			return dbm.GetMatch(matchId);
+		}, this, [this](SqlResult<std::optional<Match>>&& result)
+		{
+			PA_TRY_OR_ELSE(match, std::move(result),
+			{
+				LOG_ERROR("Failed to get match from database: {}", error);
+				return;
+			});
+			if (match)
+			{
+				emit ReplaySummarySelected(match.value());
+			}
+		});
 	});
 
-	m_view->setModel(m_sortFilter);
+	m_view->setModel(m_model);
 	m_view->setItemDelegateForColumn(MatchHistoryModel::ButtonColumn(), summaryButtonDelegate);
-	m_view->sortByColumn(0, Qt::DescendingOrder);
 
 	m_view->Init();
 
-	// maybe we should do this async
 	LoadMatches();
 
 	QHBoxLayout* horLayout = new QHBoxLayout();
@@ -101,9 +123,9 @@ MatchHistory::MatchHistory(const Client::ServiceProvider& serviceProvider, QWidg
 
 	connect(m_deleteButton, &QPushButton::clicked, [this](bool _)
 	{
-		const QItemSelection sourceSelection = m_sortFilter->mapSelectionToSource(m_view->selectionModel()->selection());
+		const QModelIndexList selectedRows = m_view->selectionModel()->selectedRows();
 
-		if (sourceSelection.empty())
+		if (selectedRows.empty())
 		{
 			return;
 		}
@@ -112,31 +134,24 @@ MatchHistory::MatchHistory(const Client::ServiceProvider& serviceProvider, QWidg
 		QuestionDialog* dialog = new QuestionDialog(lang, this, GetString(lang, StringTableKey::HISTORY_DELETE_QUESTION));
 		if (dialog->Run() == QuestionAnswer::Yes)
 		{
-			std::vector<int> removedMatches{};
-
-			for (const QItemSelectionRange& s : sourceSelection)
+			std::vector<uint32_t> removedMatches{};
+			for (const QModelIndex& index : selectedRows)
 			{
-				if (s.isValid() && s.left() == 0)
-				{
-					int row = s.top();
-					removedMatches.emplace_back(row);
-
-					const uint32_t matchId = m_model->GetMatch(row).Id;
-					PA_TRYV_OR_ELSE(m_services.Get<DatabaseManager>().DeleteMatch(matchId),
-					{
-						LOG_ERROR("Failed to delete match from match history: {}", error);
-					});
-				}
-			}
-
-			std::ranges::sort(removedMatches, [](int a, int b){ return a > b; });
-			for (int i : removedMatches)
-			{
-				m_model->DeleteMatch(i);
+				removedMatches.emplace_back(m_model->GetMatch(index.row()).Id);
 			}
 
 			m_view->selectionModel()->clearSelection();
-			Refresh();
+			m_services.Get<DatabaseExecutor>().Write([removedMatches = std::move(removedMatches)](const DatabaseManager& dbm) mutable
+			{
+				return dbm.DeleteMatches(removedMatches);
+			}, this, [this](SqlResult<void>&& result)
+			{
+				PA_TRYV_OR_ELSE(std::move(result),
+				{
+					LOG_ERROR("Failed to delete matches from match history: {}", error);
+				});
+				Refresh();
+			});
 		}
 	});
 
@@ -149,16 +164,32 @@ MatchHistory::MatchHistory(const Client::ServiceProvider& serviceProvider, QWidg
 
 	connect(m_view, &QTableView::doubleClicked, [this](const QModelIndex& index)
 	{
-		const Client::Match& match = m_model->GetMatch(m_sortFilter->mapToSource(index).row());
-		const bool showKarma = m_services.Get<Config>().Get<ConfigKey::ShowKarma>();
-		const bool fontShadow = m_services.Get<Config>().Get<ConfigKey::FontShadow>();
-		const int fontScaling = m_services.Get<Config>().Get<ConfigKey::FontScaling>();
-		PA_TRY_OR_ELSE(res, ParseMatch(match.Json, MatchContext{}, { showKarma, fontShadow, (float)fontScaling / 100.0f }),
+		const uint32_t matchId = m_model->GetMatch(index.row()).Id;
+		m_services.Get<DatabaseExecutor>().Read([matchId](const DatabaseManager& dbm)
 		{
-			LOG_ERROR("Failed to parse match as JSON: {}", error);
-			return;
+			return dbm.GetMatchJson(matchId);
+		}, this, [this](SqlResult<std::optional<std::string>>&& result)
+		{
+			PA_TRY_OR_ELSE(json, std::move(result),
+			{
+				LOG_ERROR("Failed to get match json from database: {}", error);
+				return;
+			});
+			if (!json)
+			{
+				return;
+			}
+
+			const bool showKarma = m_services.Get<Config>().Get<ConfigKey::ShowKarma>();
+			const bool fontShadow = m_services.Get<Config>().Get<ConfigKey::FontShadow>();
+			const int fontScaling = m_services.Get<Config>().Get<ConfigKey::FontScaling>();
+			PA_TRY_OR_ELSE(res, ParseMatch(json.value(), MatchContext{}, { showKarma, fontShadow, (float)fontScaling / 100.0f }),
+			{
+				LOG_ERROR("Failed to parse match as JSON: {}", error);
+				return;
+			});
+			emit ReplaySelected(res.Match);
 		});
-		emit ReplaySelected(res.Match);
 	});
 
 	connect(m_view->selectionModel(), &QItemSelectionModel::selectionChanged, [this](const QItemSelection& selected, const QItemSelection& deselection)
@@ -169,60 +200,97 @@ MatchHistory::MatchHistory(const Client::ServiceProvider& serviceProvider, QWidg
 	connect(m_filter, &MatchHistoryFilter::FilterChanged, this, &MatchHistory::Refresh);
 }
 
-void MatchHistory::SwitchPage(int page) const
+void MatchHistory::SwitchPage(int page)
 {
-	m_sortFilter->ResetFilter();
+	const uint32_t request = ++m_pageRequest;
 
-	const int fromEntry = std::min(
-		page * EntriesPerPage + EntriesPerPage - 1,
-		std::max(m_sortFilter->rowCount() - 1, 0)
-	);
-	const int toEntry = page * EntriesPerPage;
+	// a page starts after the last match of the one before it, the keys of pages that were not read yet are looked up on the way
+	const size_t knownKeys = std::min(static_cast<size_t>(page), m_pageKeys.size());
+	const std::optional<MatchListKey> knownKey = knownKeys > 0 ? std::optional(m_pageKeys[knownKeys - 1]) : std::nullopt;
 
-	if (fromEntry == 0 && toEntry == 0)
+	m_services.Get<DatabaseExecutor>().Read([filter = m_filter->GetMatchFilter(), knownKey, skip = page - knownKeys](const DatabaseManager& dbm)
 	{
-		m_entryCount->setText("Entries 0 / 0");
-		return;
-	}
+		return dbm.GetMatchListPage(filter, knownKey, skip, EntriesPerPage);
+	}, this, [this, page, knownKeys, request](SqlResult<MatchListPage>&& result)
+	{
+		// a newer page was requested in the meantime
+		if (request != m_pageRequest)
+		{
+			return;
+		}
 
-	m_entryCount->setText(std::format("Entries {}-{} / {}", toEntry + 1, fromEntry + 1, m_sortFilter->rowCount()).c_str());
+		PA_TRY_OR_ELSE(matchPage, std::move(result),
+		{
+			LOG_ERROR("Failed to get matches from database: {}", error);
+			return;
+		});
+		auto& [count, skippedKeys, matches] = matchPage;
+		m_matchCount = count;
+
+		const int pageCount = PageCount();
+		if (page >= pageCount)
+		{
+			// the page is gone since it was selected, this switches to the last one
+			m_pagination->SetTotalPageCount(pageCount);
+			return;
+		}
+		{
+			const QSignalBlocker blocker(m_pagination);
+			m_pagination->SetTotalPageCount(pageCount);
+		}
 
-	const size_t from = m_sortFilter->mapToSource(m_sortFilter->index(fromEntry, 0)).row();
-	const size_t to = m_sortFilter->mapToSource(m_sortFilter->index(toEntry, 0)).row();
+		if (m_pageKeys.size() == knownKeys)
+		{
+			m_pageKeys.insert(m_pageKeys.end(), skippedKeys.begin(), skippedKeys.end());
+		}
+		if (m_pageKeys.size() == static_cast<size_t>(page) && !matches.empty())
+		{
+			m_pageKeys.emplace_back(MatchListKey{ .Timestamp = matches.back().Timestamp, .Id = matches.back().Id });
+		}
 
-	m_sortFilter->SetFilterRange(
-		MatchHistoryModel::GetMatchTime(m_model->GetMatch(from)),
-		MatchHistoryModel::GetMatchTime(m_model->GetMatch(to))
-	);
+		if (matches.empty())
+		{
+			m_entryCount->setText("Entries 0 / 0");
+		}
+		else
+		{
+			const uint32_t offset = page * EntriesPerPage;
+			m_entryCount->setText(std::format("Entries {}-{} / {}", offset + 1, offset + matches.size(), count).c_str());
+		}
+
+		m_model->SetMatches(std::move(matches));
+	});
 }
 
 int MatchHistory::PageCount() const
 {
-	m_sortFilter->ResetFilter();  // TODO: this is not ideal
-	return std::max(static_cast<int>(std::ceil(m_sortFilter->rowCount() / (float)EntriesPerPage)), 1);
+	return std::max(static_cast<int>(std::ceil(m_matchCount / (float)EntriesPerPage)), 1);
 }
 
-void MatchHistory::AddMatch(const Client::Match& match) const
+void MatchHistory::AddMatch(const Client::Match& match)
 {
-	m_model->AddMatch(match);
+	// the match is already in the database, it shows up if it passes the filter
 	Refresh();
 }
 
-void MatchHistory::LoadMatches() const
+void MatchHistory::LoadMatches()
 {
-	PA_PROFILE_SCOPE();
-
 	LOG_TRACE("Loading MatchHistory...");
-	PA_TRY_OR_ELSE(matches, m_services.Get<Client::DatabaseManager>().GetMatches(),
+	m_services.Get<DatabaseExecutor>().Read([](const DatabaseManager& dbm)
 	{
-		LOG_ERROR("Failed to get matches from database: {}", error);
-		return;
-	});
-	LOG_TRACE("Loaded MatchHistory");
+		return dbm.GetMatchFilterValues();
+	}, this, [this](SqlResult<Client::MatchFilterValues>&& result)
+	{
+		PA_TRY_OR_ELSE(filterValues, std::move(result),
+		{
+			LOG_ERROR("Failed to get match filter values from database: {}", error);
+			return;
+		});
 
-	m_filter->BuildFilter(matches);
-	m_model->SetMatches(std::move(matches));
-	Refresh();
+		m_filter->BuildFilter(filterValues);
+		Refresh();
+		LOG_TRACE("Loaded MatchHistory");
+	});
 }
 
 void MatchHistory::SetReplaySummary(uint32_t id, const ReplaySummary& summary) const
@@ -250,11 +318,9 @@ void MatchHistory::showEvent(QShowEvent* event)
 		m_filter->setVisible(true);
 }
 
-void MatchHistory::Refresh() const
+void MatchHistory::Refresh()
 {
-	m_sortFilter->invalidate();
-	const int newPageCount = PageCount();
-	const int newPage = std::min(m_pagination->CurrentPage(), newPageCount - 1);
-	m_pagination->SetTotalPageCount(newPageCount);
-	SwitchPage(newPage);
+	// the pages start at other matches now, the pages still being read are dropped along with their keys
+	m_pageKeys.clear();
+	SwitchPage(m_pagination->CurrentPage());
 }
@@ -16,15 +16,37 @@
 #include <QVBoxLayout>
 #include <QWidget>
 
+#include <algorithm>
+#include <optional>
+#include <ranges>
 #include <set>
 #include <span>
 #include <string>
+#include <vector>
 
 
 using PotatoAlert::Gui::Filter;
 using PotatoAlert::Gui::FilterList;
 using PotatoAlert::Gui::MatchHistoryFilter;
 
+namespace {
+
+static std::optional<std::vector<std::string>> GetCheckedValues(const Filter& filter)
+{
+	if (std::ranges::all_of(filter | std::views::values, [](bool isChecked){ return isChecked; }))
+		return std::nullopt;
+
+	std::vector<std::string> values;
+	for (const auto& [value, isChecked] : filter)
+	{
+		if (isChecked)
+			values.emplace_back(value.toStdString());
+	}
+	return values;
+}
+
+}  // namespace
+
 class FilterModel : public QAbstractListModel
 {
 public:
@@ -191,7 +213,7 @@ void MatchHistoryFilter::AdjustPosition()
 	setGeometry(QRect(topLeft - QPoint(0, height()), QSize(width(), height())));
 }
 
-void MatchHistoryFilter::BuildFilter(std::span<const Client::Match> matches) const
+void MatchHistoryFilter::BuildFilter(const Client::MatchFilterValues& values) const
 {
 	m_shipList->Clear();
 	m_mapList->Clear();
@@ -200,13 +222,29 @@ void MatchHistoryFilter::BuildFilter(std::span<const Client::Match> matches) con
 	m_playerList->Clear();
 	m_regionList->Clear();
 
-	for (const Client::Match& match : matches)
+	for (const std::string& ship : values.Ships)
+		m_shipList->AddItem(ship);
+	for (const std::string& map : values.Maps)
+		m_mapList->AddItem(map);
+	for (const std::string& mode : values.MatchGroups)
+		m_modeList->AddItem(mode);
+	for (const std::string& statsMode : values.StatsModes)
+		m_statsModeList->AddItem(statsMode);
+	for (const std::string& player : values.Players)
+		m_playerList->AddItem(player);
+	for (const std::string& region : values.Regions)
+		m_regionList->AddItem(region);
+}
+
+PotatoAlert::Client::MatchFilter MatchHistoryFilter::GetMatchFilter() const
+{
+	return Client::MatchFilter
 	{
-		m_shipList->AddItem(match.Ship);
-		m_mapList->AddItem(match.Map);
-		m_modeList->AddItem(match.MatchGroup);
-		m_statsModeList->AddItem(match.StatsMode);
-		m_playerList->AddItem(match.Player);
-		m_regionList->AddItem(match.Region);
-	}
+		.Ships = GetCheckedValues(m_shipList->GetFilter()),
+		.Maps = GetCheckedValues(m_mapList->GetFilter()),
+		.MatchGroups = GetCheckedValues(m_modeList->GetFilter()),
+		.StatsModes = GetCheckedValues(m_statsModeList->GetFilter()),
+		.Players = GetCheckedValues(m_playerList->GetFilter()),
+		.Regions = GetCheckedValues(m_regionList->GetFilter()),
+	};
 }
@@ -19,8 +19,8 @@
 #include <cstdint>
 #include <chrono>
 #include <ranges>
-#include <sstream>
 #include <chrono>
+#include <utility>
 #include <vector>
 
 
@@ -36,6 +36,13 @@ MatchHistoryModel::MatchHistoryModel(const Client::ServiceProvider& serviceProvi
 	qApp->installEventFilter(this);
 }
 
+void MatchHistoryModel::SetMatches(std::vector<Client::Match>&& matches)
+{
+	beginResetModel();
+	m_matches = std::move(matches);
+	endResetModel();
+}
+
 void MatchHistoryModel::SetReplaySummary(uint32_t id, const ReplaySummary& summary)
 {
 	const auto it = std::ranges::find_if(m_matches, [id](const Client::Match& match)
@@ -50,14 +57,6 @@ void MatchHistoryModel::SetReplaySummary(uint32_t id, const ReplaySummary& summa
 	}
 }
 
-std::time_t MatchHistoryModel::GetMatchTime(const Client::Match& match)
-{
-	std::tm tm = {};
-	std::stringstream ss(match.Date);
-	ss >> std::get_time(&tm, "%d.%m.%Y %H:%M:%S");
-	return std::chrono::system_clock::from_time_t(std::mktime(&tm)).time_since_epoch().count();
-}
-
 QVariant MatchHistoryModel::data(const QModelIndex& index, int role) const
 {
 	if (!index.isValid())
@@ -74,7 +73,7 @@ QVariant MatchHistoryModel::data(const QModelIndex& index, int role) const
 		{
 			if (index.column() == 0)
 			{
-				return static_cast<qulonglong>(GetMatchTime(m_matches[index.row()]));
+				return static_cast<qlonglong>(m_matches[index.row()].Timestamp);
 			}
 			return QVariant();
 		}
@@ -4,11 +4,10 @@
 #include "Core/Directory.hpp"
 #include "Core/Process.hpp"
 #include "Core/StandardPaths.hpp"
-#include "Core/Sqlite.hpp"
 
 #include "Client/AppDirectories.hpp"
 #include "Client/Config.hpp"
-#include "Client/DatabaseManager.hpp"
+#include "Client/DatabaseExecutor.hpp"
 #include "Client/FontLoader.hpp"
 #include "Client/ServiceProvider.hpp"
 #include "Client/ReplayAnalyzer.hpp"
@@ -35,7 +34,7 @@
 using PotatoAlert::Client::AppDirectories;
 using PotatoAlert::Client::Config;
 using PotatoAlert::Client::ConfigKey;
-using PotatoAlert::Client::DatabaseManager;
+using PotatoAlert::Client::DatabaseExecutor;
 using PotatoAlert::Client::LoadFonts;
 using PotatoAlert::Client::PotatoClient;
 using PotatoAlert::Client::ReplayAnalyzer;
@@ -43,7 +42,6 @@ using PotatoAlert::Client::ServiceProvider;
 using PotatoAlert::Core::ApplicationGuard;
 using PotatoAlert::Core::ExitCurrentProcess;
 using PotatoAlert::Core::ExitCurrentProcessWithError;
-using PotatoAlert::Core::SQLite;
 using PotatoAlert::Gui::DarkPalette;
 using PotatoAlert::Gui::FontScalingChangeEvent;
 using PotatoAlert::Gui::LanguageChangeEvent;
@@ -74,23 +72,20 @@ static int RunMain(int argc, char* argv[])
 	Config config(appDirs.ConfigFile);
 	serviceProvider.Add(config);
 
+	// declared before everything using it, so it outlives the threads queueing work on it
+	DatabaseExecutor database(appDirs.DatabaseFile);
+	if (!database)
+	{
+		ExitCurrentProcessWithError(1);
+	}
+	serviceProvider.Add(database);
+
 	ReplayAnalyzer replayAnalyzer(serviceProvider, appDirs.ReplayVersionsDir);
 	serviceProvider.Add(replayAnalyzer);
 
 	PotatoClient client(serviceProvider);
 	serviceProvider.Add(client);
 
-	SQLite db = SQLite::Open(appDirs.DatabaseFile, SQLite::Flags::ReadWrite | SQLite::Flags::Create);
-	if (!db)
-	{
-		LOG_ERROR("Failed to open database: {}", db.GetLastError());
-		ExitCurrentProcessWithError(1);
-	}
-
-	DatabaseManager dbm(db);
-	serviceProvider.Add(dbm);
-	auto res = dbm.GetMatches();
-
 	QApplication::setQuitOnLastWindowClosed(false);
 	
 	QApplication::setOrganizationName(PRODUCT_COMPANY_NAME);
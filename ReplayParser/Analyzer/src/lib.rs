@@ -1,7 +1,6 @@
 #![no_main]
 
 use std::collections::HashMap;
-use cxx::CxxVector;
 use num_derive::FromPrimitive;
 use num_traits::FromPrimitive;
 use serde_pickle::{DeOptions, Error, Value};
@@ -64,9 +63,9 @@ mod ffi
 	extern "Rust"
 	{
 		#[cxx_name = "ParseReceiveDamageStat"]
-		fn parse_receive_damage_stat(data: &CxxVector<u8>) -> ReceiveDamageStatResult;
+		fn parse_receive_damage_stat(data: &[u8]) -> ReceiveDamageStatResult;
 		#[cxx_name = "ParseArenaStateReceivedPlayers"]
-		fn parse_arena_state_received_players(data: &CxxVector<u8>, version: u32) -> OnArenaStateReceivedPlayerResult;
+		fn parse_arena_state_received_players(data: &[u8], version: u32) -> OnArenaStateReceivedPlayerResult;
 	}
 }
 
@@ -124,11 +123,11 @@ impl ErrorType<Vec<OnArenaStateReceivedPlayer>, Error> for OnArenaStateReceivedP
 	}
 }
 
-fn parse_receive_damage_stat(data: &CxxVector<u8>) -> ReceiveDamageStatResult
+fn parse_receive_damage_stat(data: &[u8]) -> ReceiveDamageStatResult
 {
 	type DamageStat = HashMap<(i64, i64), (i64, f32)>;
 
-	match serde_pickle::de::value_from_slice(data.as_slice(), DeOptions::default())
+	match serde_pickle::de::value_from_slice(data, DeOptions::default())
 	{
 		Ok(val) => {
 			match serde_pickle::value::from_value::<DamageStat>(val)
@@ -332,7 +331,7 @@ macro_rules! parse_arena_state
 {
 	($data_index:ident, $players:expr, $data:expr) =>
 	{
-		match serde_pickle::de::value_from_slice($data.as_slice(), DeOptions::default())
+		match serde_pickle::de::value_from_slice($data, DeOptions::default())
 		{
 			Ok(val) => {
 				match serde_pickle::value::from_value::<Vec<Player>>(val)
@@ -399,13 +398,13 @@ fn create_version(major: u8, minor: u8, patch: u8, build: u8) -> u32
 	((major as u32) << 0x18) + ((minor as u32) << 0x10) + ((patch as u32) << 0x08) + (build as u32)
 }
 
-fn parse_arena_state_received_players(data: &CxxVector<u8>, version: u32) -> OnArenaStateReceivedPlayerResult
+fn parse_arena_state_received_players(data: &[u8], version: u32) -> OnArenaStateReceivedPlayerResult
 {
 	let mut out_players: Vec<OnArenaStateReceivedPlayer> = vec![];
 
 	type Player = Vec<(i64, Value)>;
 
-	// let val = serde_pickle::de::value_from_slice(data.as_slice(), DeOptions::default()).unwrap();
+	// let val = serde_pickle::de::value_from_slice(data, DeOptions::default()).unwrap();
 	// let players = serde_pickle::value::from_value::<Vec<Player>>(val).unwrap();
 	// for player in players
 	// {
@@ -1,20 +1,245 @@
 // Copyright 2022 <github.com/razaqq>
 
+#include "Core/Json.hpp"
 #include "Core/Log.hpp"
 #include "Core/Result.hpp"
 #include "Core/StandardPaths.hpp"
+#include "Core/String.hpp"
 
 #include "ReplayParser/ReplayParser.hpp"
 
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+
+namespace fs = std::filesystem;
 
 using namespace PotatoAlert::Core;
 using namespace PotatoAlert::ReplayParser;
 using PotatoAlert::ReplayParser::ReplayResult;
 
+namespace {
+
+static constexpr std::string_view BatchUsage =
+R"(Usage: StandaloneReplayParser --batch [options] <path>...
+
+Analyzes every replay in parallel and writes one JSON object per line with the file name, hash and summary of each replay.
+A path is either a replay, a directory that is searched recursively for replays or a file name pattern with * and ?.
+Throughput of each stage is printed to stderr at the end, per thread and in MB of inflated replay data,
+except for decrypt which is in MB of encrypted data.
+
+Options:
+    --game-files <dir>   directory with the game scripts of each version (default: AppData/PotatoAlert/ReplayVersions)
+    --output <file>      file to write the summaries to (default: stdout)
+    --threads <count>    number of replays analyzed at once (default: number of cores)
+)";
+
+static bool CollectReplays(const fs::path& path, std::vector<fs::path>& replays)
+{
+	std::error_code ec;
+	if (fs::is_directory(path, ec))
+	{
+		for (const fs::directory_entry& entry : fs::recursive_directory_iterator(path, ec))
+		{
+			if (entry.is_regular_file() && entry.path().extension() == ".wowsreplay")
+			{
+				replays.emplace_back(entry.path());
+			}
+		}
+		return !ec;
+	}
+
+	if (fs::is_regular_file(path, ec))
+	{
+		replays.emplace_back(path);
+		return true;
+	}
+
+	const std::string pattern = path.filename().string();
+	if (pattern.find_first_of("*?") == std::string::npos)
+	{
+		return false;
+	}
+
+	const fs::path directory = path.has_parent_path() ? path.parent_path() : fs::path(".");
+	for (const fs::directory_entry& entry : fs::directory_iterator(directory, ec))
+	{
+		if (entry.is_regular_file() && String::MatchesGlob(entry.path().filename().string(), pattern))
+		{
+			replays.emplace_back(entry.path());
+		}
+	}
+	return !ec;
+}
+
+static double MegaBytesPerSecond(uint64_t bytes, StreamStats::Clock::duration duration)
+{
+	const double seconds = std::chrono::duration<double>(duration).count();
+	return seconds > 0.0 ? static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds : 0.0;
+}
+
+static int RunBatch(std::span<char*> args)
+{
+	fs::path gameFilePath = AppDataPath("PotatoAlert") / "ReplayVersions";
+	std::optional<fs::path> outputPath;
+	size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<fs::path> replays;
+
+	for (size_t i = 0; i < args.size(); i++)
+	{
+		const std::string_view arg = args[i];
+		const bool hasValue = i + 1 < args.size();
+		if (arg == "--game-files" && hasValue)
+		{
+			gameFilePath = args[++i];
+		}
+		else if (arg == "--output" && hasValue)
+		{
+			outputPath = args[++i];
+		}
+		else if (arg == "--threads" && hasValue)
+		{
+			threadCount = static_cast<size_t>(std::max(1, std::atoi(args[++i])));
+		}
+		else if (arg.starts_with("--"))
+		{
+			fmt::print(stderr, "Unknown option '{}'\n\n{}", arg, BatchUsage);
+			return 1;
+		}
+		else if (!CollectReplays(fs::path(arg), replays))
+		{
+			fmt::print(stderr, "Failed to find replays at '{}'\n", arg);
+			return 1;
+		}
+	}
+
+	if (replays.empty())
+	{
+		fmt::print(stderr, "{}", BatchUsage);
+		return 1;
+	}
+
+	std::ofstream outputFile;
+	if (outputPath)
+	{
+		outputFile.open(outputPath.value(), std::ios::out | std::ios::trunc);
+		if (!outputFile)
+		{
+			fmt::print(stderr, "Failed to open output file '{}'\n", outputPath.value().string());
+			return 1;
+		}
+	}
+	std::ostream& output = outputPath ? outputFile : std::cout;
+
+	// stdout only gets summaries, everything that is logged still ends up in the log file
+	for (const spdlog::sink_ptr& sink : Log::GetLogger()->sinks())
+	{
+		if (std::dynamic_pointer_cast<spdlog::sinks::stdout_color_sink_mt>(sink))
+		{
+			sink->set_level(spdlog::level::off);
+		}
+	}
+
+	threadCount = std::min(threadCount, replays.size());
+	std::atomic<size_t> next = 0;
+	std::atomic<size_t> failed = 0;
+	std::mutex outputMutex;
+	std::vector<StreamStats> stats(threadCount);
+
+	const auto start = StreamStats::Clock::now();
+	std::vector<std::thread> workers;
+	for (size_t t = 0; t < threadCount; t++)
+	{
+		workers.emplace_back([&, t]()
+		{
+			StreamBuffers buffers;
+			buffers.Stats.emplace();
+
+			for (size_t i = next++; i < replays.size(); i = next++)
+			{
+				ReplayResult<ReplaySummary> summary = AnalyzeReplay(replays[i], gameFilePath, buffers);
+				if (!summary)
+				{
+					failed++;
+					std::unique_lock lock(outputMutex);
+					fmt::print(stderr, "Failed to analyze '{}': {}\n", replays[i].string(), summary.error());
+					continue;
+				}
+
+				rapidjson::StringBuffer buffer;
+				rapidjson::Writer writer(buffer);
+				writer.StartObject();
+				writer.Key("replay");
+				writer.String(replays[i].filename().string().c_str());
+				writer.Key("hash");
+				writer.String(summary->Hash.c_str());
+				writer.Key("summary");
+				if (!ToJson(writer, summary.value()))
+				{
+					failed++;
+					std::unique_lock lock(outputMutex);
+					fmt::print(stderr, "Failed to write summary of '{}'\n", replays[i].string());
+					continue;
+				}
+				writer.EndObject();
+
+				std::unique_lock lock(outputMutex);
+				output << buffer.GetString() << '\n';
+			}
+
+			stats[t] = buffers.Stats.value();
+		});
+	}
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+	const double seconds = std::chrono::duration<double>(StreamStats::Clock::now() - start).count();
+	output.flush();
+
+	StreamStats total;
+	for (const StreamStats& s : stats)
+	{
+		total += s;
+	}
+
+	fmt::print(stderr, "analyzed {} of {} replays in {:.2f}s on {} threads: {:.1f} replays/s\n",
+		replays.size() - failed, replays.size(), seconds, threadCount, seconds > 0.0 ? static_cast<double>(replays.size()) / seconds : 0.0);
+	fmt::print(stderr, "  decrypt:      {:8.1f} MB/s\n", MegaBytesPerSecond(total.EncryptedBytes, total.Decrypt));
+	fmt::print(stderr, "  inflate:      {:8.1f} MB/s\n", MegaBytesPerSecond(total.InflatedBytes, total.Inflate));
+	fmt::print(stderr, "  packet parse: {:8.1f} MB/s\n", MegaBytesPerSecond(total.InflatedBytes, total.Parse));
+	fmt::print(stderr, "  analyze:      {:8.1f} MB/s\n", MegaBytesPerSecond(total.InflatedBytes, total.Visit));
+
+	return failed == 0 ? 0 : 1;
+}
+
+}  // namespace
+
 int main(int argc, char* argv[])
 {
 	Log::Init(AppDataPath("PotatoAlert") / "StandaloneReplayParser.log");
 
+	if (argc >= 2 && std::string_view(argv[1]) == "--batch")
+	{
+		return RunBatch(std::span(argv + 2, static_cast<size_t>(argc - 2)));
+	}
+
 	auto section = [](std::string_view title = "")
 	{
 		LOG_INFO("{:-^21}", title);
@@ -29,7 +254,7 @@ int main(int argc, char* argv[])
 
 	if (argc != 2)
 	{
-		LOG_ERROR("Arg 1 needs to be a replay file");
+		LOG_ERROR("Arg 1 needs to be a replay file, or --batch to analyze many replays");
 		return err();
 	}
 
@@ -0,0 +1,46 @@
+// Copyright 2024 <github.com/razaqq>
+#pragma once
+
+#include "ReplayParser/PacketParser.hpp"
+#include "ReplayParser/Packets.hpp"
+#include "ReplayParser/ReplayParser.hpp"
+#include "ReplayParser/Result.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+
+namespace PotatoAlert::ReplayParser {
+
+// Builds a ReplaySummary one packet at a time, so the packets never have to be stored.
+class Analyzer
+{
+public:
+	// bump whenever the summary of the same replay changes, this invalidates every cached summary
+	static constexpr uint32_t SummaryVersion = 1;
+
+	// the packets, methods and properties the analyzer needs, everything else can be skipped while parsing
+	static const PacketInterest& Interest();
+
+	ReplayResult<void> OnPacket(const Replay& replay, const PacketType& packet);
+
+	// Has to be called once after the last packet, when the final entity state of the replay is known.
+	ReplayResult<ReplaySummary> Finish(const Replay& replay);
+
+private:
+	std::optional<int8_t> m_winningTeam = std::nullopt;
+	std::optional<int8_t> m_playerTeam = std::nullopt;
+	int32_t m_playerEntityId = 0;
+	// int64_t m_playerAvatarId = 0;
+	int64_t m_playerShipId = 0;
+	int64_t m_playerId = 0;
+	std::unordered_map<DamageType, float> m_damageDealt;
+	std::unordered_map<DamageType, float> m_damagePotential;
+	std::unordered_map<DamageType, float> m_damageSpotting;
+	float m_damageTaken = 0.0f;
+	std::unordered_map<RibbonType, uint32_t> m_ribbons;
+	std::unordered_map<AchievementType, uint32_t> m_achievements;
+};
+
+}  // namespace PotatoAlert::ReplayParser
@@ -3,10 +3,13 @@
 
 #include "Core/String.hpp"
 
+#include "ReplayParser/TypeProgram.hpp"
 #include "ReplayParser/Types.hpp"
 
+#include <cstdint>
 #include <filesystem>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -61,18 +64,29 @@ inline PropertyFlag ParseFlag(const std::string& str)
 	return PropertyFlag::Unknown;
 }
 
+// Method and property names are interned into process wide ids when the specs are loaded,
+// so the hot paths can compare them as integers instead of strings. The default value is never assigned to a name.
+enum class NameId : uint32_t {};
+
+// Returns the id of a name, assigning a new one if it was not seen before. Thread safe.
+NameId InternName(std::string_view name);
+
 struct Property
 {
 	std::string Name;
+	NameId Id;
 	ArgType Type;
 	PropertyFlag Flag;
+	TypeProgram Program = {};  // compiled from Type once the spec is complete
 };
 
 struct Method
 {
 	std::string Name;
+	NameId Id;
 	size_t VarLengthHeaderSize;
 	std::vector<ArgType> Args = {};
+	TypeProgram Program = {};  // compiled from Args once the spec is complete
 
 	[[nodiscard]] size_t SortSize() const
 	{
@@ -99,8 +113,10 @@ struct DefFile
 	std::vector<std::string> Implements = {};
 };
 
-DefFile ParseDef(const fs::path& file, const AliasType& aliases);
+class ScriptSource;
+
+DefFile ParseDef(const ScriptSource& source, std::string_view file, const AliasType& aliases);
 DefFile MergeDefs(const std::vector<DefFile>& defs);
-void ParseInterfaces(const fs::path& root, const AliasType& aliases, const DefFile& def, std::vector<DefFile>& out);
+void ParseInterfaces(const ScriptSource& source, std::string_view root, const AliasType& aliases, const DefFile& def, std::vector<DefFile>& out);
 
 }  // namespace PotatoAlert::ReplayParser
@@ -2,12 +2,16 @@
 #pragma once
 
 #include "Core/Version.hpp"
+#include "Core/Xml.hpp"
 
 #include "ReplayParser/Entity.hpp"
 
 #include <filesystem>
 #include <functional>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 
@@ -26,6 +30,35 @@ struct EntitySpec
 	std::vector<std::reference_wrapper<const Property>> BaseProperties;
 };
 
+// Reads the xml files of the game scripts, paths are relative to the scripts directory, e.g. "entity_defs/alias.xml".
+class ScriptSource
+{
+public:
+	virtual ~ScriptSource() = default;
+	virtual Core::XmlResult<void> LoadXml(tinyxml2::XMLDocument& doc, std::string_view path) const = 0;
+};
+
+// Reads the scripts from a directory on disk.
+class ScriptDirectory : public ScriptSource
+{
+public:
+	explicit ScriptDirectory(fs::path root) : m_root(std::move(root)) {}
+	Core::XmlResult<void> LoadXml(tinyxml2::XMLDocument& doc, std::string_view path) const override;
+
+private:
+	fs::path m_root;
+};
+
 std::vector<EntitySpec> ParseScripts(Core::Version version, const fs::path& gameFilePath);
+std::vector<EntitySpec> ParseScripts(const ScriptSource& source);
+
+// Stores specs that were parsed without unpacking the scripts, GetEntitySpecs loads them as long as
+// there are no scripts for this version on disk.
+void StoreEntitySpecs(const fs::path& versionDir, const std::vector<EntitySpec>& specs);
+
+// Returns the specs for a game version, they are parsed at most once per process and shared between all callers.
+// Parsed specs get compiled into a binary file next to the scripts, which is loaded instead of the xml files on later runs.
+// Returns nullptr if the scripts for this version could not be found or parsed.
+std::shared_ptr<const std::vector<EntitySpec>> GetEntitySpecs(Core::Version version, const fs::path& gameFilePath);
 
 }  // namespace PotatoAlert::ReplayParser
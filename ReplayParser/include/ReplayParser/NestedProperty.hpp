@@ -5,6 +5,7 @@
 #include "ReplayParser/Types.hpp"
 #include "ReplayParser/Result.hpp"
 
+#include <memory_resource>
 #include <string>
 #include <variant>
 #include <vector>
@@ -28,7 +29,7 @@ struct UpdateActionSetRange
 {
 	size_t Start;
 	size_t Stop;
-	std::vector<ArgValue> Values;
+	ArgArray Values;
 };
 
 struct UpdateActionRemoveRange
@@ -55,6 +56,6 @@ struct PropertyNesting
 	UpdateAction Action;
 };
 
-ReplayResult<PropertyNesting> GetNestedPropertyPath(bool isSlice, const ArgType& argType, ArgValue* argValue, BitReader& bitReader);
+ReplayResult<PropertyNesting> GetNestedPropertyPath(bool isSlice, const ArgType& argType, ArgValue* argValue, BitReader& bitReader, std::pmr::memory_resource* memory);
 
 }  // namespace PotatoAlert::ReplayParser
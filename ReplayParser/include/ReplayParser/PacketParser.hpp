@@ -6,8 +6,13 @@
 #include "ReplayParser/PacketCallback.hpp"
 #include "ReplayParser/Result.hpp"
 
+#include <memory>
+#include <memory_resource>
+#include <optional>
 #include <span>
+#include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <variant>
 #include <vector>
 
@@ -23,13 +28,43 @@ struct Entity
 	std::unordered_map<std::string, ArgValue> ClientPropertiesInternalValues;
 };
 
+// Declares which packets a consumer is interested in, everything else is skipped by its length prefix without decoding it.
+// Entities are always created and the properties of interest are tracked on them, no matter which packets are of interest.
+struct PacketInterest
+{
+	std::unordered_set<PacketBaseType> Packets;
+
+	// only these methods are decoded for EntityMethod packets, all if empty
+	std::unordered_set<NameId> Methods;
+
+	// only these properties are decoded and tracked per entity type name, all if empty
+	std::unordered_map<std::string, std::unordered_set<NameId>> Properties;
+};
+
 struct PacketParser
 {
-	std::vector<EntitySpec> Specs;
+	std::shared_ptr<const std::vector<EntitySpec>> Specs;
 	std::unordered_map<uint32_t, Entity> Entities;
+
+	// all parsed values allocate from here, has to outlive the entities and every packet
+	std::pmr::memory_resource* Memory = std::pmr::get_default_resource();
 	PacketCallbacks Callbacks;
+
+	std::optional<PacketInterest> Interest;
+
+	// lookup tables for Interest, indexed like the members of the EntitySpec of the same index
+	struct SpecInterest
+	{
+		std::vector<bool> ClientMethods;
+		std::vector<bool> ClientProperties;
+		std::vector<bool> ClientPropertiesInternal;
+	};
+	std::vector<SpecInterest> SpecInterests;
 };
 
+// Restricts the parser to the given interest, Specs have to be set before.
+void SetPacketInterest(PacketParser& parser, PacketInterest interest);
+
 ReplayResult<PacketType> ParsePacket(std::span<const Byte>& data, PacketParser& parser, Core::Version version);
 
 }  // namespace PotatoAlert::ReplayParser
@@ -10,6 +10,7 @@
 #include "ReplayParser/Types.hpp"
 
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -183,7 +184,8 @@ struct EntityMethodPacket : Packet
 {
 	TypeEntityId EntityId;
 	TypeMethodId MethodId;
-	std::string MethodName;
+	NameId MethodNameId;
+	std::string_view MethodName;  // points into the shared specs
 	std::vector<ArgValue> Values;
 };
 
@@ -199,7 +201,8 @@ struct EntityPropertyPacket : Packet
 {
 	TypeEntityId EntityId;
 	TypeMethodId MethodId;
-	std::string PropertyName;
+	NameId PropertyNameId;
+	std::string_view PropertyName;  // points into the shared specs
 	ArgValue Value;
 };
 
@@ -229,7 +232,8 @@ struct Entity;  // forward declare for PacketParser.hpp
 struct NestedPropertyUpdatePacket : Packet
 {
 	TypeEntityId EntityId;
-	std::string PropertyName;
+	NameId PropertyNameId;
+	std::string_view PropertyName;  // points into the shared specs
 	int PropertyIndex;
 	PropertyNesting Nesting;
 	Entity* EntityPtr;
@@ -6,6 +6,9 @@
 #include "Core/String.hpp"
 #include "Core/Version.hpp"
 
+#include "ReplayParser/Result.hpp"
+
+#include <filesystem>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -65,8 +68,15 @@ struct ReplayMeta
 	// only in version >= 12.3
 	std::string EventType;
 	std::string GameType;
+
+	// Reads only the header and meta of a replay with a few small reads, the packets are neither mapped nor decrypted.
+	static ReplayResult<ReplayMeta> ReadFromFile(const std::filesystem::path& filePath);
 };
 
+// Reads the raw meta json of a replay like ReplayMeta::ReadFromFile, without parsing it.
+// Its SHA256 hash is the hash of the ReplaySummary, which identifies the match of the replay.
+ReplayResult<std::string> ReadMetaString(const std::filesystem::path& filePath);
+
 static Version ParseClientVersion(std::string_view str)
 {
 	const std::vector v = Split(str, ",");
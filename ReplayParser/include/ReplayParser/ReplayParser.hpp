@@ -1,17 +1,27 @@
 // Copyright 2021 <github.com/razaqq>
 #pragma once
 
+#include "Core/Bytes.hpp"
 #include "Core/Json.hpp"
 #include "Core/Version.hpp"
+#include "Core/Zlib.hpp"
 
 #include "ReplayParser/Packets.hpp"
 #include "ReplayParser/PacketParser.hpp"
 #include "ReplayParser/ReplayMeta.hpp"
 #include "ReplayParser/Result.hpp"
 
+#include <array>
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <optional>
 #include <span>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 
@@ -311,18 +321,92 @@ static inline Core::JsonResult<void> ToJson(rapidjson::Writer<rapidjson::StringB
 	return {};
 }
 
+// the blowfish key the packet stream of every replay is encrypted with
+inline constexpr std::array<Core::Byte, 16> ReplayKey = { 0x29, 0xB7, 0xC9, 0x09, 0x38, 0x3F, 0x84, 0x88, 0xFA, 0x98, 0xEC, 0x4E, 0x13, 0x19, 0x79, 0xFB };
+
+// The sections of a replay file, pointing into the data they were read from.
+struct ReplayLayout
+{
+	std::span<const Core::Byte> Meta;  // the meta json
+	std::span<const Core::Byte> Stream;  // the encrypted and compressed packets, a multiple of the blowfish block size
+	uint32_t DecompressedSize;
+};
+
+// Validates the header of the replay file and splits it into its sections.
+ReplayResult<ReplayLayout> ReadLayout(std::span<const Core::Byte> data);
+
+// Bytes processed by and time spent in each stage of streaming, summed over every replay streamed with the same buffers.
+struct StreamStats
+{
+	using Clock = std::chrono::steady_clock;
+
+	size_t Replays = 0;
+	uint64_t EncryptedBytes = 0;
+	uint64_t InflatedBytes = 0;
+	Clock::duration Decrypt = {};
+	Clock::duration Inflate = {};
+	Clock::duration Parse = {};
+	Clock::duration Visit = {};  // AnalyzeReplay includes the time to finish the analysis
+
+	StreamStats& operator+=(const StreamStats& other)
+	{
+		Replays += other.Replays;
+		EncryptedBytes += other.EncryptedBytes;
+		InflatedBytes += other.InflatedBytes;
+		Decrypt += other.Decrypt;
+		Inflate += other.Inflate;
+		Parse += other.Parse;
+		Visit += other.Visit;
+		return *this;
+	}
+};
+
+// The decode buffers and packet memory of a streamed replay, kept alive between replays so a worker that streams
+// many of them does not allocate them again for every replay.
+// Only one replay can be streamed with it at a time and it has to outlive every replay that was streamed with it.
+struct StreamBuffers
+{
+	Core::Zlib::Inflater Inflater;
+	std::vector<Core::Byte> Decrypted;
+	std::vector<Core::Byte> Inflated;
+	std::pmr::unsynchronized_pool_resource Memory;
+	std::optional<StreamStats> Stats;  // only collected if set
+	// decrypts larger streams as a whole on all cores, which grows Decrypted to the size of the stream,
+	// only worth it when a single replay is waited for and not when many are analyzed at once anyway
+	bool ParallelDecrypt = false;
+};
+
 class Replay
 {
+	// declared first, so it is destroyed after every packet and entity that allocated from it
+	ArgArena m_arena;
+
 public:
 	std::string MetaString;
 	ReplayMeta Meta;
 	std::vector<PacketType> Packets;
-	std::vector<EntitySpec> Specs;
+	std::shared_ptr<const std::vector<EntitySpec>> Specs;
+
+	using PacketVisitor = std::function<ReplayResult<void>(const Replay& replay, const PacketType& packet)>;
 
 	static ReplayResult<Replay> FromFile(std::string_view filePath, std::string_view gameFilePath);
 	static ReplayResult<Replay> FromFile(const std::filesystem::path& filePath, const std::filesystem::path& gameFilePath);
+
+	// Parses the replay like FromFile, but hands every packet to the visitor as soon as it is parsed instead of storing it in Packets.
+	// Packets outside of the interest are skipped without decoding them and passed as UnknownPacket.
+	static ReplayResult<Replay> Stream(const std::filesystem::path& filePath, const std::filesystem::path& gameFilePath, const PacketVisitor& visitor,
+		std::optional<PacketInterest> interest = std::nullopt);
+	// Same as above, but decodes into the given buffers and allocates packets and entities from their memory.
+	static ReplayResult<Replay> Stream(const std::filesystem::path& filePath, const std::filesystem::path& gameFilePath, StreamBuffers& buffers,
+		const PacketVisitor& visitor, std::optional<PacketInterest> interest = std::nullopt);
+
 	[[nodiscard]] ReplayResult<ReplaySummary> Analyze() const;
 
+	[[nodiscard]] const std::unordered_map<uint32_t, Entity>& Entities() const
+	{
+		return m_packetParser.Entities;
+	}
+
 	template<typename P>
 	void AddPacketCallback(std::function<void(const P&)> callback)
 	{
@@ -331,9 +415,13 @@ public:
 
 private:
 	PacketParser m_packetParser;
+
+	static ReplayResult<Replay> Parse(const std::filesystem::path& filePath, const std::filesystem::path& gameFilePath, const PacketVisitor* visitor,
+		std::optional<PacketInterest> interest, StreamBuffers* buffers);
 };
 
 ReplayResult<ReplaySummary> AnalyzeReplay(const std::filesystem::path& file, const std::filesystem::path& gameFilePath);
+ReplayResult<ReplaySummary> AnalyzeReplay(const std::filesystem::path& file, const std::filesystem::path& gameFilePath, StreamBuffers& buffers);
 bool HasGameScripts(Version gameVersion, const fs::path& gameFilePath);
 
 }  // namespace PotatoAlert::ReplayParser
@@ -0,0 +1,65 @@
+// Copyright 2024 <github.com/razaqq>
+#pragma once
+
+#include "ReplayParser/ReplayParser.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+
+namespace PotatoAlert::ReplayParser {
+
+// Remembers the summary of every analyzed replay file on disk, so unchanged replays are never decoded again.
+// An entry is keyed by the size and last write time of the file and the hash of its meta, which is also ReplaySummary::Hash.
+// The whole cache is dropped when it was written by another Analyzer::SummaryVersion, entries of deleted replays when it is saved.
+// All methods are thread safe.
+class SummaryCache
+{
+public:
+	explicit SummaryCache(std::filesystem::path path);
+
+	SummaryCache(const SummaryCache&) = delete;
+	SummaryCache(SummaryCache&&) = delete;
+	SummaryCache& operator=(const SummaryCache&) = delete;
+	SummaryCache& operator=(SummaryCache&&) = delete;
+	~SummaryCache() = default;
+
+	// only costs a stat of the file, hits if the file was not touched since it was analyzed
+	[[nodiscard]] std::optional<ReplaySummary> Find(const std::filesystem::path& file) const;
+	// also hits for a copied or moved replay with the same meta hash and size
+	[[nodiscard]] std::optional<ReplaySummary> Find(const std::filesystem::path& file, std::string_view hash) const;
+
+	void Insert(const std::filesystem::path& file, const ReplaySummary& summary);
+
+	[[nodiscard]] size_t Size() const;
+
+	// writes the cache if anything was inserted since it was loaded or last saved, without the replays that no longer exist
+	// the lookups and inserts only wait while the entries are copied, not while they are checked and written
+	void Save();
+
+private:
+	struct Entry
+	{
+		uint64_t Size;
+		int64_t Time;
+		ReplaySummary Summary;
+	};
+
+	void Load();
+	void RebuildHashes();
+
+	std::filesystem::path m_path;
+	mutable std::mutex m_mutex;
+	std::mutex m_saveMutex;  // only one save writes the file at a time
+	std::unordered_map<std::string, Entry> m_entries;  // by the generic path of the replay
+	std::unordered_map<std::string, std::string> m_hashes;  // summary hash to the path of its entry
+	uint64_t m_insertCount = 0;  // tells a save whether anything was inserted while it wrote the file
+	bool m_dirty = false;
+};
+
+}  // namespace PotatoAlert::ReplayParser
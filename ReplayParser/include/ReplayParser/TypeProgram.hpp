@@ -0,0 +1,64 @@
+// Copyright 2024 <github.com/razaqq>
+#pragma once
+
+#include "ReplayParser/Types.hpp"
+
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <vector>
+
+
+namespace PotatoAlert::ReplayParser {
+
+enum class TypeOp : uint8_t
+{
+	Primitive,
+	Array,
+	FixedDict,
+	UserType,
+	Tuple,
+	Unknown,
+};
+
+// One node of an ArgType, the instructions of its children directly follow it.
+struct TypeInstruction
+{
+	TypeOp Op = TypeOp::Unknown;
+	BasicType Primitive = BasicType::Blob;
+	bool AllowNone = false;  // FixedDict
+	bool FixedCount = false;  // Array, otherwise the count is read from the data
+	bool TakesByte = false;  // UserType, every user type but blobs is prefixed by one byte
+	uint8_t Count = 0;  // elements of an Array with FixedCount
+	uint32_t End = 0;  // index of the instruction after all children
+	size_t Size = Infinity;  // encoded size of the whole value, Infinity if variable
+	const FixedDictType* Dict = nullptr;  // points into the shared specs
+};
+
+// A flat list of instructions for one or more values, compiled once per EntitySpec from the ArgType trees.
+// Decoding it gives exactly the same result as ParseValue on the types it was compiled from, including when data runs out.
+struct TypeProgram
+{
+	std::vector<TypeInstruction> Instructions;
+	size_t Size = 0;  // encoded size of all values, Infinity if any of them is variable
+
+	[[nodiscard]] bool IsFixedSize() const
+	{
+		return Size != Infinity;
+	}
+};
+
+// The types have to outlive the program, as FixedDict values point to their type.
+TypeProgram CompileType(const ArgType& type);
+TypeProgram CompileTypes(std::span<const ArgType> types);
+
+// decodes the first value of the program, nothing if data ran out before its end
+std::optional<ArgValue> DecodeValue(const TypeProgram& program, std::span<const Byte>& data, std::pmr::memory_resource* memory);
+// decodes all values of the program, false if data ran out before the end of the last one
+bool DecodeValues(const TypeProgram& program, std::span<const Byte>& data, std::pmr::memory_resource* memory, std::vector<ArgValue>& values);
+// advances data past the first value of the program without decoding it, in O(1) if it has a fixed size
+// false if data ran out before its end
+bool SkipValue(const TypeProgram& program, std::span<const Byte>& data);
+
+}  // namespace PotatoAlert::ReplayParser
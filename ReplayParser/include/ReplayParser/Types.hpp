@@ -7,9 +7,11 @@
 
 #include <any>
 #include <memory>
+#include <memory_resource>
 #include <optional>
 #include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <variant>
 #include <vector>
@@ -100,15 +102,72 @@ struct UserType;
 typedef std::variant<PrimitiveType, ArrayType, FixedDictType, TupleType, UserType, UnknownType> ArgType;
 
 struct ArgValue;
+
+// all containers of an ArgValue allocate from the ArgArena of the replay they were parsed from
+using ArgString = std::pmr::string;
+using ArgBlob = std::pmr::vector<Byte>;
+using ArgArray = std::pmr::vector<ArgValue>;
+
+// A FIXED_DICT value, stored flat in the order of the properties of its type.
+// A dict without values is the None value of a FixedDictType that allows none.
+struct ArgDict
+{
+	const FixedDictType* Type = nullptr;  // points into the shared specs
+	ArgArray Values;
+
+	[[nodiscard]] const ArgValue* Find(std::string_view name) const;
+	[[nodiscard]] ArgValue* Find(std::string_view name);
+
+	[[nodiscard]] bool contains(std::string_view name) const
+	{
+		return Find(name) != nullptr;
+	}
+
+	[[nodiscard]] const ArgValue& at(std::string_view name) const;
+};
+
 using ValueVariant = std::variant<
 		uint8_t, uint16_t, uint32_t, uint64_t, int8_t, int16_t, int32_t, int64_t,
-		float, double, Vec2, Vec3, std::string, std::unordered_map<std::string, ArgValue>,
-		std::vector<ArgValue>, std::vector<Byte>>;
+		float, double, Vec2, Vec3, ArgString, ArgDict, ArgArray, ArgBlob>;
 struct ArgValue : ValueVariant
 {
 	using ValueVariant::ValueVariant;
 };
 
+// Owns the memory of all values parsed from one replay, it is released in one go when the arena is destroyed.
+// Move assignment swaps the memory, so values still allocated from the old memory stay valid until the moved-from arena dies.
+class ArgArena
+{
+public:
+	ArgArena() : m_memory(std::make_unique<std::pmr::monotonic_buffer_resource>()) {}
+
+	// recycles the memory of destroyed values, for replays that do not keep their packets
+	static ArgArena Pooled()
+	{
+		return ArgArena(std::make_unique<std::pmr::unsynchronized_pool_resource>());
+	}
+
+	ArgArena(ArgArena&& other) noexcept = default;
+	ArgArena& operator=(ArgArena&& other) noexcept
+	{
+		std::swap(m_memory, other.m_memory);
+		return *this;
+	}
+
+	ArgArena(const ArgArena&) = delete;
+	ArgArena& operator=(const ArgArena&) = delete;
+
+	[[nodiscard]] std::pmr::memory_resource* Get() const
+	{
+		return m_memory.get();
+	}
+
+private:
+	explicit ArgArena(std::unique_ptr<std::pmr::memory_resource> memory) : m_memory(std::move(memory)) {}
+
+	std::unique_ptr<std::pmr::memory_resource> m_memory;
+};
+
 struct PrimitiveType
 {
 	BasicType Type;
@@ -149,8 +208,13 @@ typedef std::unordered_map<std::string, ArgType> AliasType;
 
 ArgType ParseType(XMLElement* elem, const AliasType& aliases);
 size_t TypeSize(const ArgType& type);
-ArgValue ParseValue(std::span<const Byte>& data, const ArgType& type);
-ArgValue GetDefaultValue(const ArgType& type);
+// A value fails to parse if data runs out before its end, which leaves data somewhere inside of it.
+// Types that are not parsed (tuples, unknown or missing types) take no bytes and give an empty value.
+std::optional<ArgValue> ParsePrimitive(BasicType type, std::span<const Byte>& data, std::pmr::memory_resource* memory);
+std::optional<ArgValue> ParseValue(std::span<const Byte>& data, const ArgType& type, std::pmr::memory_resource* memory);
+ArgValue GetDefaultValue(const ArgType& type, std::pmr::memory_resource* memory);
+// deep copies a value, allocating all of its containers from memory
+ArgValue CopyValue(const ArgValue& value, std::pmr::memory_resource* memory);
 
 #ifndef NDEBUG
 std::string PrintType(const ArgType& type);
@@ -5,6 +5,7 @@
 #include "Core/Sha256.hpp"
 
 #include "ReplayAnalyzerRust.hpp"
+#include "ReplayParser/Analyzer.hpp"
 #include "ReplayParser/GameFiles.hpp"
 #include "ReplayParser/ReplayParser.hpp"
 #include "ReplayParser/Result.hpp"
@@ -21,6 +22,7 @@
 
 
 using PotatoAlert::Core::Byte;
+using PotatoAlert::ReplayParser::Analyzer;
 using PotatoAlert::ReplayParser::Replay;
 using PotatoAlert::ReplayParser::ReplayResult;
 using namespace PotatoAlert::ReplayParser;
@@ -62,285 +64,322 @@ enum class Consumable : int8_t
 	ReserveBattery           = 13,
 };
 
-ReplayResult<ReplaySummary> Replay::Analyze() const
+namespace {
+
+// the names the analyzer looks at, interned once so packets are matched by id
+struct Names
 {
-	PA_PROFILE_FUNCTION();
+	NameId OnArenaStateReceived = InternName("onArenaStateReceived");
+	NameId OnBattleEnd = InternName("onBattleEnd");
+	NameId ReceiveDamageStat = InternName("receiveDamageStat");
+	NameId ReceiveDamagesOnShip = InternName("receiveDamagesOnShip");
+	NameId OnRibbon = InternName("onRibbon");
+	NameId OnAchievementEarned = InternName("onAchievementEarned");
+	NameId TeamId = InternName("teamId");
+	NameId PrivateVehicleState = InternName("privateVehicleState");
+	NameId BattleResult = InternName("battleResult");
+};
+
+const Names& GetNames()
+{
+	static const Names names;
+	return names;
+}
 
-	struct
+}
+
+const PacketInterest& Analyzer::Interest()
+{
+	const Names& names = GetNames();
+
+	[[clang::no_destroy]] static const PacketInterest interest
 	{
-		std::optional<int8_t> winningTeam = std::nullopt;
-		std::optional<int8_t> playerTeam = std::nullopt;
-		int32_t PlayerEntityId;
-		// int64_t PlayerAvatarId;
-		int64_t PlayerShipId;
-		int64_t PlayerId;
-		std::unordered_map<DamageType, float> DamageDealt;
-		std::unordered_map<DamageType, float> DamagePotential;
-		std::unordered_map<DamageType, float> DamageSpotting;
-		float DamageTaken = 0.0f;
-		std::unordered_map<RibbonType, uint32_t> Ribbons;
-		std::unordered_map<AchievementType, uint32_t> Achievements;
-	} replayData;
-
-	for (const PacketType& pak : Packets)
+		.Packets =
+		{
+			PacketBaseType::BasePlayerCreate,
+			PacketBaseType::CellPlayerCreate,
+			PacketBaseType::EntityMethod,
+		},
+		.Methods =
+		{
+			names.OnArenaStateReceived,
+			names.OnBattleEnd,
+			names.ReceiveDamageStat,
+			names.ReceiveDamagesOnShip,
+			names.OnRibbon,
+			names.OnAchievementEarned,
+		},
+		.Properties =
+		{
+			{ "Avatar", { names.TeamId, names.PrivateVehicleState } },
+			{ "BattleLogic", { names.BattleResult } },
+		},
+	};
+	return interest;
+}
+
+ReplayResult<void> Analyzer::OnPacket(const Replay& replay, const PacketType& pak)
+{
+	return std::visit([this, &replay]<typename Type>(Type&& packet) -> ReplayResult<void>
 	{
-		const ReplayResult<void> packetResult = std::visit([&replayData, this]<typename Type>(Type&& packet) -> ReplayResult<void>
+		using T = std::decay_t<Type>;
+
+		if constexpr (std::is_same_v<T, BasePlayerCreatePacket>)
 		{
-			using T = std::decay_t<Type>;
+			m_playerEntityId = packet.EntityId;
 
-			if constexpr (std::is_same_v<T, BasePlayerCreatePacket>)
-			{
-				replayData.PlayerEntityId = packet.EntityId;
+			return {};
+		}
 
-				return {};
-			}
+		if constexpr (std::is_same_v<T, EntityMethodPacket>)
+		{
+			const Names& names = GetNames();
 
-			if constexpr (std::is_same_v<T, EntityMethodPacket>)
+			if (packet.MethodNameId == names.OnArenaStateReceived)
 			{
-				if (packet.MethodName == "onArenaStateReceived")
+				bool found = false;
+				PA_TRYV(VariantGet<ArgBlob>(packet, 3, [this, &found, &replay](const ArgBlob& data) -> ReplayResult<void>
 				{
-					bool found = false;
-					PA_TRYV(VariantGet<std::vector<Byte>>(packet, 3, [&replayData, &found, this](const std::vector<Byte>& data) -> ReplayResult<void>
-					{
-						OnArenaStateReceivedPlayerResult result = ParseArenaStateReceivedPlayers(data, Meta.ClientVersionFromExe.GetRaw());
+					OnArenaStateReceivedPlayerResult result = ParseArenaStateReceivedPlayers({ data.data(), data.size() }, replay.Meta.ClientVersionFromExe.GetRaw());
 
-						if (result.IsError)
-						{
-							return PA_REPLAY_ERROR("{}", result.Error.c_str());
-						}
+					if (result.IsError)
+					{
+						return PA_REPLAY_ERROR("{}", result.Error.c_str());
+					}
 
-						for (const auto& player : result.Value)
+					for (const auto& player : result.Value)
+					{
+						if (player.EntityId == m_playerEntityId)
 						{
-							if (player.EntityId == replayData.PlayerEntityId)
-							{
-								found = true;
-								// replayData.PlayerAvatarId = player.avatarid;
-								replayData.PlayerId = player.Id;
-								replayData.PlayerShipId = player.ShipId;
-							}
+							found = true;
+							// m_playerAvatarId = player.avatarid;
+							m_playerId = player.Id;
+							m_playerShipId = player.ShipId;
 						}
-
-						return {};
-					}));
-
-					if (!found)
-					{
-						return PA_REPLAY_ERROR("onArenaStateReceived did not include the player id {} itself", replayData.PlayerEntityId);
 					}
 
 					return {};
-				}
+				}));
 
-				if (packet.MethodName == "onBattleEnd")
+				if (!found)
 				{
-					if (Meta.ClientVersionFromExe < Version(12, 5, 0))
-					{
-						// second arg uint8_t winReason
-						return VariantGet<int8_t>(packet, 0, [&replayData](int8_t team) -> ReplayResult<void>
-						{
-							replayData.winningTeam = team;
-
-							return {};
-						});
-					}
+					return PA_REPLAY_ERROR("onArenaStateReceived did not include the player id {} itself", m_playerEntityId);
 				}
 
-				if (packet.MethodName == "receiveDamageStat")
-				{
-					if (packet.Values.size() != 1)
-					{
-						return PA_REPLAY_ERROR("receiveDamageStat Values were not size 1");
-					}
+				return {};
+			}
 
-					return VariantGet<std::vector<Byte>>(packet, 0, [&replayData, &packet](const std::vector<Byte>& data) -> ReplayResult<void>
+			if (packet.MethodNameId == names.OnBattleEnd)
+			{
+				if (replay.Meta.ClientVersionFromExe < Version(12, 5, 0))
+				{
+					// second arg uint8_t winReason
+					return VariantGet<int8_t>(packet, 0, [this](int8_t team) -> ReplayResult<void>
 					{
-						ReceiveDamageStatResult result = ParseReceiveDamageStat(data);
-
-						if (result.IsError)
-						{
-							return PA_REPLAY_ERROR("Failed to parse damage stat: {}", result.Error.c_str());
-						}
-
-						for (const ReceiveDamageStat& stat : result.Value)
-						{
-							const DamageType dmgType = static_cast<DamageType>(stat.DamageType);
-							switch (static_cast<DamageFlag>(stat.DamageFlag))
-							{
-								case DamageFlag::EnemyDamage:
-								{
-									replayData.DamageDealt[dmgType] = stat.Damage;
-									break;
-								}
-								case DamageFlag::PotentialDamage:
-								{
-									replayData.DamagePotential[dmgType] = stat.Damage;
-									break;
-								}
-								case DamageFlag::SpottingDamage:
-								{
-									replayData.DamageSpotting[dmgType] = stat.Damage;
-									break;
-								}
-								default:
-									break;
-							}
-						}
+						m_winningTeam = team;
 
 						return {};
 					});
 				}
+			}
+
+			if (packet.MethodNameId == names.ReceiveDamageStat)
+			{
+				if (packet.Values.size() != 1)
+				{
+					return PA_REPLAY_ERROR("receiveDamageStat Values were not size 1");
+				}
 
-				if (packet.MethodName == "receiveDamagesOnShip")
+				return VariantGet<ArgBlob>(packet, 0, [this, &packet](const ArgBlob& data) -> ReplayResult<void>
 				{
-					if (packet.EntityId != replayData.PlayerShipId)
+					ReceiveDamageStatResult result = ParseReceiveDamageStat({ data.data(), data.size() });
+
+					if (result.IsError)
 					{
-						return {};  // just ignore this packet if the ids dont match
+						return PA_REPLAY_ERROR("Failed to parse damage stat: {}", result.Error.c_str());
 					}
 
-					return VariantGet<std::vector<ArgValue>>(packet, 0, [&replayData, &packet](const std::vector<ArgValue>& vec) -> ReplayResult<void>
+					for (const ReceiveDamageStat& stat : result.Value)
 					{
-						for (const ArgValue& elem : vec)
+						const DamageType dmgType = static_cast<DamageType>(stat.DamageType);
+						switch (static_cast<DamageFlag>(stat.DamageFlag))
 						{
-							VariantGet<std::unordered_map<std::string, ArgValue>>(elem, [&replayData, &packet](const std::unordered_map<std::string, ArgValue>& dict) -> ReplayResult<void>
+							case DamageFlag::EnemyDamage:
 							{
-								// other field is 'vehicleID' int32_t of the aggressor
-								if (dict.contains("damage"))
-								{
-									VariantGet<float>(dict.at("damage"), [&replayData](float damage) -> ReplayResult<void>
-									{
-										replayData.DamageTaken += damage;
-										return {};
-									});
-								}
-								return {};
-							});
+								m_damageDealt[dmgType] = stat.Damage;
+								break;
+							}
+							case DamageFlag::PotentialDamage:
+							{
+								m_damagePotential[dmgType] = stat.Damage;
+								break;
+							}
+							case DamageFlag::SpottingDamage:
+							{
+								m_damageSpotting[dmgType] = stat.Damage;
+								break;
+							}
+							default:
+								break;
 						}
-
-						return {};
-					});
+					}
 
 					return {};
+				});
+			}
+
+			if (packet.MethodNameId == names.ReceiveDamagesOnShip)
+			{
+				if (packet.EntityId != m_playerShipId)
+				{
+					return {};  // just ignore this packet if the ids dont match
 				}
 
-				// until 12.0.0, since then its an EntityProperty
-				if (Meta.ClientVersionFromExe < Version(12, 0, 0))
+				return VariantGet<ArgArray>(packet, 0, [this, &packet](const ArgArray& vec) -> ReplayResult<void>
 				{
-					if (packet.MethodName == "onRibbon")
+					for (const ArgValue& elem : vec)
 					{
-						return VariantGet<int8_t>(packet, 0, [&replayData](int8_t value) -> ReplayResult<void>
+						VariantGet<ArgDict>(elem, [this, &packet](const ArgDict& dict) -> ReplayResult<void>
 						{
-							const RibbonType ribbon = static_cast<RibbonType>(value);
-							if (replayData.Ribbons.contains(ribbon))
+							// other field is 'vehicleID' int32_t of the aggressor
+							if (dict.contains("damage"))
 							{
-								replayData.Ribbons[ribbon] += 1;
-							}
-							else
-							{
-								replayData.Ribbons[ribbon] = 1;
+								VariantGet<float>(dict.at("damage"), [this](float damage) -> ReplayResult<void>
+								{
+									m_damageTaken += damage;
+									return {};
+								});
 							}
-
 							return {};
 						});
 					}
-				}
 
-				if (packet.MethodName == "onAchievementEarned")
+					return {};
+				});
+
+				return {};
+			}
+
+			// until 12.0.0, since then its an EntityProperty
+			if (replay.Meta.ClientVersionFromExe < Version(12, 0, 0))
+			{
+				if (packet.MethodNameId == names.OnRibbon)
 				{
-					bool discard = true;
-					PA_TRYV(VariantGet<int32_t>(packet, 0, [&replayData, &discard, this](int32_t id) -> ReplayResult<void>
+					return VariantGet<int8_t>(packet, 0, [this](int8_t value) -> ReplayResult<void>
 					{
-						// since version 0.11.4 this is a different id
-						if (Meta.ClientVersionFromExe >= Version(0, 11, 4))
+						const RibbonType ribbon = static_cast<RibbonType>(value);
+						if (m_ribbons.contains(ribbon))
 						{
-							if (id == replayData.PlayerId)
-							{
-								discard = false;
-							}
+							m_ribbons[ribbon] += 1;
 						}
 						else
 						{
-							if (id == replayData.PlayerEntityId)
-							{
-								discard = false;
-							}
+							m_ribbons[ribbon] = 1;
 						}
+
 						return {};
-					}));
-					PA_TRYV(VariantGet<uint32_t>(packet, 1, [&replayData, discard](uint32_t value) -> ReplayResult<void>
+					});
+				}
+			}
+
+			if (packet.MethodNameId == names.OnAchievementEarned)
+			{
+				bool discard = true;
+				PA_TRYV(VariantGet<int32_t>(packet, 0, [this, &discard, &replay](int32_t id) -> ReplayResult<void>
+				{
+					// since version 0.11.4 this is a different id
+					if (replay.Meta.ClientVersionFromExe >= Version(0, 11, 4))
 					{
-						if (discard)
-							return {};
-						const AchievementType achievement = static_cast<AchievementType>(value);
-						if (replayData.Achievements.contains(achievement))
+						if (id == m_playerId)
 						{
-							replayData.Achievements[achievement] += 1;
+							discard = false;
 						}
-						else
+					}
+					else
+					{
+						if (id == m_playerEntityId)
 						{
-							replayData.Achievements[achievement] = 1;
+							discard = false;
 						}
+					}
+					return {};
+				}));
+				PA_TRYV(VariantGet<uint32_t>(packet, 1, [this, discard](uint32_t value) -> ReplayResult<void>
+				{
+					if (discard)
 						return {};
-					}));
-
+					const AchievementType achievement = static_cast<AchievementType>(value);
+					if (m_achievements.contains(achievement))
+					{
+						m_achievements[achievement] += 1;
+					}
+					else
+					{
+						m_achievements[achievement] = 1;
+					}
 					return {};
-				}
+				}));
+
+				return {};
 			}
+		}
 
-			if constexpr (std::is_same_v<T, CellPlayerCreatePacket>)
+		if constexpr (std::is_same_v<T, CellPlayerCreatePacket>)
+		{
+			if (packet.Values.contains("teamId"))
 			{
-				if (packet.Values.contains("teamId"))
+				VariantGet<int8_t>(packet.Values.at("teamId"), [this](int8_t team) -> ReplayResult<void>
 				{
-					VariantGet<int8_t>(packet.Values.at("teamId"), [&replayData](int8_t team) -> ReplayResult<void>
-					{
-						replayData.playerTeam = team;
-						return {};
-					});
-				}
-
-				return {};
+					m_playerTeam = team;
+					return {};
+				});
 			}
 
 			return {};
-		}, pak);
-		PA_TRYV(packetResult);
-	}
+		}
+
+		return {};
+	}, pak);
+}
 
-	auto damageDealtValues = std::views::values(replayData.DamageDealt);
+ReplayResult<ReplaySummary> Analyzer::Finish(const Replay& replay)
+{
+	auto damageDealtValues = std::views::values(m_damageDealt);
 	float damageDealt = std::accumulate(damageDealtValues.begin(), damageDealtValues.end(), 0.0f);
 
-	auto dmgPotentialValues = std::views::values(replayData.DamagePotential);
+	auto dmgPotentialValues = std::views::values(m_damagePotential);
 	float damagePotential = std::accumulate(dmgPotentialValues.begin(), dmgPotentialValues.end(), 0.0f);
 
-	auto dmgSpottingValues = std::views::values(replayData.DamageSpotting);
+	auto dmgSpottingValues = std::views::values(m_damageSpotting);
 	float damageSpotting = std::accumulate(dmgSpottingValues.begin(), dmgSpottingValues.end(), 0.0f);
 
 	MatchOutcome outcome;
 
 	// since 12.0.0
-	if (Meta.ClientVersionFromExe >= Version(12, 0, 0))
+	if (replay.Meta.ClientVersionFromExe >= Version(12, 0, 0))
 	{
-		if (!m_packetParser.Entities.contains(replayData.PlayerEntityId))
+		if (!replay.Entities().contains(m_playerEntityId))
 		{
 			return PA_REPLAY_ERROR("PacketParser has no entity for PlayerEntityId");
 		}
-		const Entity& playerEntity = m_packetParser.Entities.at(replayData.PlayerEntityId);
+		const Entity& playerEntity = replay.Entities().at(m_playerEntityId);
 		if (!playerEntity.ClientPropertiesValues.contains("privateVehicleState"))
 		{
 			return PA_REPLAY_ERROR("Player entity is missing ClientProperty 'privateVehicleState'");
 		}
 		const ArgValue& privateVehicleState = playerEntity.ClientPropertiesValues.at("privateVehicleState");
 
-		PA_TRYV(VariantGet<std::unordered_map<std::string, ArgValue>>(privateVehicleState, [&replayData](auto& state) -> ReplayResult<void>
+		PA_TRYV(VariantGet<ArgDict>(privateVehicleState, [this](auto& state) -> ReplayResult<void>
 		{
 			if (!state.contains("ribbons"))
 			{
 				return PA_REPLAY_ERROR("privateVehicleState is missing key 'ribbons'");
 			}
-			return VariantGet<std::vector<ArgValue>>(state.at("ribbons"), [&replayData](auto& ribbons) -> ReplayResult<void>
+			return VariantGet<ArgArray>(state.at("ribbons"), [this](auto& ribbons) -> ReplayResult<void>
 			{
 				for (const ArgValue& ribbonValue : ribbons)
 				{
-					PA_TRYV(VariantGet<std::unordered_map<std::string, ArgValue>>(ribbonValue, [&replayData](auto& ribbon) -> ReplayResult<void>
+					PA_TRYV(VariantGet<ArgDict>(ribbonValue, [this](auto& ribbon) -> ReplayResult<void>
 					{
 						if (!ribbon.contains("count"))
 						{
@@ -363,7 +402,7 @@ ReplayResult<ReplaySummary> Replay::Analyze() const
 							ribbonType = static_cast<RibbonType>(ribbonId);
 							return {};
 						}));
-						replayData.Ribbons.emplace(ribbonType, ribbonCount);
+						m_ribbons.emplace(ribbonType, ribbonCount);
 						return {};
 					}));
 				}
@@ -372,14 +411,14 @@ ReplayResult<ReplaySummary> Replay::Analyze() const
 		}));
 	}
 
-	if (Meta.ClientVersionFromExe >= Version(12, 5, 0))
+	if (replay.Meta.ClientVersionFromExe >= Version(12, 5, 0))
 	{
-		const auto battleLogic = std::ranges::find_if(m_packetParser.Entities | std::views::values, [](const Entity& entity)
+		const auto battleLogic = std::ranges::find_if(replay.Entities() | std::views::values, [](const Entity& entity)
 		{
 			return entity.Spec.get().Name == "BattleLogic";
 		});
 
-		if (battleLogic == std::end(m_packetParser.Entities | std::views::values))
+		if (battleLogic == std::end(replay.Entities() | std::views::values))
 		{
 			return PA_REPLAY_ERROR("No entity with spec BattleLogic");
 		}
@@ -389,13 +428,13 @@ ReplayResult<ReplaySummary> Replay::Analyze() const
 			return PA_REPLAY_ERROR("Entity BattleLogic is missing 'battleResult'");
 		}
 
-		PA_TRYV(VariantGet<std::unordered_map<std::string, ArgValue>>((*battleLogic).ClientPropertiesValues.at("battleResult"), [&replayData](const auto& map) -> ReplayResult<void>
+		PA_TRYV(VariantGet<ArgDict>((*battleLogic).ClientPropertiesValues.at("battleResult"), [this](const auto& map) -> ReplayResult<void>
 		{
 			if (map.contains("winnerTeamId"))
 			{
-				PA_TRYV(VariantGet<int8_t>(map.at("winnerTeamId"), [&replayData](int8_t winnerTeamId) -> ReplayResult<void>
+				PA_TRYV(VariantGet<int8_t>(map.at("winnerTeamId"), [this](int8_t winnerTeamId) -> ReplayResult<void>
 				{
-					replayData.winningTeam = winnerTeamId;
+					m_winningTeam = winnerTeamId;
 					return {};
 				}));
 
@@ -406,16 +445,16 @@ ReplayResult<ReplaySummary> Replay::Analyze() const
 		}));
 	}
 
-	if (!replayData.playerTeam || !replayData.winningTeam || (replayData.winningTeam && replayData.winningTeam == -2))
+	if (!m_playerTeam || !m_winningTeam || (m_winningTeam && m_winningTeam == -2))
 	{
-		LOG_TRACE("Failed to determine match outcome, PT {} WT {}", replayData.playerTeam.has_value(), replayData.winningTeam.has_value());
+		LOG_TRACE("Failed to determine match outcome, PT {} WT {}", m_playerTeam.has_value(), m_winningTeam.has_value());
 		outcome = MatchOutcome::Unknown;
 	}
-	else if (replayData.playerTeam.value() == replayData.winningTeam.value())
+	else if (m_playerTeam.value() == m_winningTeam.value())
 	{
 		outcome = MatchOutcome::Win;
 	}
-	else if (replayData.winningTeam.value() == -1)
+	else if (m_winningTeam.value() == -1)
 	{
 		outcome = MatchOutcome::Draw;
 	}
@@ -425,7 +464,7 @@ ReplayResult<ReplaySummary> Replay::Analyze() const
 	}
 
 	std::string hash;
-	if (!Core::Sha256(MetaString, hash))
+	if (!Core::Sha256(replay.MetaString, hash))
 	{
 		return PA_REPLAY_ERROR("Failed to get SHA256 hash of replay meta");
 	}
@@ -435,10 +474,22 @@ ReplayResult<ReplaySummary> Replay::Analyze() const
 		.Hash = hash,
 		.Outcome = outcome,
 		.DamageDealt = damageDealt,
-		.DamageTaken = replayData.DamageTaken,
+		.DamageTaken = m_damageTaken,
 		.DamageSpotting = damageSpotting,
 		.DamagePotential = damagePotential,
-		.Achievements = replayData.Achievements,
-		.Ribbons = replayData.Ribbons,
+		.Achievements = m_achievements,
+		.Ribbons = m_ribbons,
 	};
 }
+
+ReplayResult<ReplaySummary> Replay::Analyze() const
+{
+	PA_PROFILE_FUNCTION();
+
+	Analyzer analyzer;
+	for (const PacketType& packet : Packets)
+	{
+		PA_TRYV(analyzer.OnPacket(*this, packet));
+	}
+	return analyzer.Finish(*this);
+}
@@ -7,11 +7,15 @@
 #include "Core/Xml.hpp"
 
 #include "ReplayParser/Entity.hpp"
+#include "ReplayParser/GameFiles.hpp"
 #include "ReplayParser/Types.hpp"
 
 #include <filesystem>
+#include <mutex>
 #include <ranges>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 
@@ -19,6 +23,35 @@ namespace rp = PotatoAlert::ReplayParser;
 using namespace PotatoAlert::ReplayParser;
 using namespace PotatoAlert;
 
+namespace {
+
+struct StringHash
+{
+	using is_transparent = void;
+
+	size_t operator()(std::string_view str) const
+	{
+		return std::hash<std::string_view>{}(str);
+	}
+};
+
+}
+
+NameId rp::InternName(std::string_view name)
+{
+	[[clang::no_destroy]] static std::mutex mutex;
+	[[clang::no_destroy]] static std::unordered_map<std::string, NameId, StringHash, std::equal_to<>> names;
+
+	std::scoped_lock lock(mutex);
+	if (const auto it = names.find(name); it != names.end())
+	{
+		return it->second;
+	}
+	const NameId id = static_cast<NameId>(names.size() + 1);
+	names.emplace(name, id);
+	return id;
+}
+
 static std::vector<Method> ParseMethodList(XMLElement* elem, const AliasType& aliases)
 {
 	std::vector<Method> methods;
@@ -49,7 +82,7 @@ static std::vector<Method> ParseMethodList(XMLElement* elem, const AliasType& al
 				varLengthHeaderSize = argElem->IntText(1);
 			}
 		}
-		methods.emplace_back(Method{ methodElem->Name(), varLengthHeaderSize, args });
+		methods.emplace_back(Method{ methodElem->Name(), InternName(methodElem->Name()), varLengthHeaderSize, args });
 	}
 
 	return methods;
@@ -65,7 +98,7 @@ static std::vector<Property> ParseProperties(XMLElement* elem, const AliasType&
 		XMLElement* typeElem = propElem->FirstChildElement("Type");
 		if (flagElem && typeElem)
 		{
-			properties.emplace_back(Property{ propElem->Name(), ParseType(typeElem, aliases), ParseFlag(flagElem->GetText()) });
+			properties.emplace_back(Property{ propElem->Name(), InternName(propElem->Name()), ParseType(typeElem, aliases), ParseFlag(flagElem->GetText()) });
 		}
 	}
 
@@ -84,15 +117,15 @@ static std::vector<std::string> ParseImplements(XMLElement* elem)
 	return implements;
 }
 
-DefFile rp::ParseDef(const fs::path& file, const AliasType& aliases)
+DefFile rp::ParseDef(const ScriptSource& source, std::string_view file, const AliasType& aliases)
 {
 	DefFile defFile;
 
 	XMLDocument doc;
-	Core::XmlResult<void> res = Core::LoadXml(doc, file);
+	Core::XmlResult<void> res = source.LoadXml(doc, file);
 	if (!res)
 	{
-		LOG_ERROR(STR("Failed to open entity definition file ({}): {}."), file, StringWrap(res.error()));
+		LOG_ERROR("Failed to open entity definition file ({}): {}.", file, res.error());
 		return defFile;
 	}
 
@@ -155,11 +188,11 @@ DefFile rp::MergeDefs(const std::vector<DefFile>& defs)
 	return defFile;
 }
 
-void rp::ParseInterfaces(const fs::path& root, const AliasType& aliases, const DefFile& def, std::vector<DefFile>& out)
+void rp::ParseInterfaces(const ScriptSource& source, std::string_view root, const AliasType& aliases, const DefFile& def, std::vector<DefFile>& out)
 {
 	for (const std::string& imp : def.Implements)
 	{
-		out.emplace_back(ParseDef(root / fmt::format("{}.def", imp), aliases));
-		ParseInterfaces(root, aliases, out.back(), out);
+		out.emplace_back(ParseDef(source, fmt::format("{}/{}.def", root, imp), aliases));
+		ParseInterfaces(source, root, aliases, out.back(), out);
 	}
 }
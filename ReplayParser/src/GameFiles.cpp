@@ -1,5 +1,6 @@
 // Copyright 2021 <github.com/razaqq>
 
+#include "Core/Bytes.hpp"
 #include "Core/Directory.hpp"
 #include "Core/File.hpp"
 #include "Core/Format.hpp"
@@ -10,28 +11,363 @@
 #include "ReplayParser/Entity.hpp"
 #include "ReplayParser/GameFiles.hpp"
 
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <ranges>
+#include <span>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 
 namespace rp = PotatoAlert::ReplayParser;
+using PotatoAlert::Core::Byte;
 using PotatoAlert::Core::File;
-using PotatoAlert::Core::LoadXml;
+using PotatoAlert::Core::ReadString;
+using PotatoAlert::Core::TakeInto;
 using PotatoAlert::Core::Version;
+using PotatoAlert::Core::Write;
+using PotatoAlert::Core::WriteString;
 using PotatoAlert::Core::XmlResult;
 using namespace PotatoAlert::ReplayParser;
 using namespace tinyxml2;
 
-static std::optional<std::unordered_map<std::string, ArgType>> ParseAliases(const fs::path& path)
+namespace {
+
+static constexpr uint32_t CompiledSpecsMagic = 0x50534150;  // "PASP"
+static constexpr uint32_t CompiledSpecsVersion = 1;
+static constexpr size_t MaxTypeDepth = 64;
+// the key of specs that were stored without any scripts on disk to take the time from
+static constexpr int64_t StoredSpecsTime = 0;
+
+static void WriteType(std::vector<Byte>& out, const ArgType& type);
+
+static void WriteSubType(std::vector<Byte>& out, const std::shared_ptr<ArgType>& type)
+{
+	Write<uint8_t>(out, type != nullptr);
+	if (type)
+		WriteType(out, *type);
+}
+
+static void WriteType(std::vector<Byte>& out, const ArgType& type)
+{
+	Write<uint8_t>(out, static_cast<uint8_t>(type.index()));
+	std::visit([&out](auto&& arg)
+	{
+		using T = std::decay_t<decltype(arg)>;
+
+		if constexpr (std::is_same_v<T, PrimitiveType>)
+		{
+			Write<uint8_t>(out, static_cast<uint8_t>(arg.Type));
+		}
+		else if constexpr (std::is_same_v<T, ArrayType>)
+		{
+			WriteSubType(out, arg.SubType);
+			Write<uint8_t>(out, arg.Size.has_value());
+			Write<uint64_t>(out, arg.Size.value_or(0));
+		}
+		else if constexpr (std::is_same_v<T, FixedDictType>)
+		{
+			Write<uint8_t>(out, arg.AllowNone);
+			Write<uint32_t>(out, static_cast<uint32_t>(arg.Properties.size()));
+			for (const FixedDictProperty& prop : arg.Properties)
+			{
+				WriteString(out, prop.Name);
+				WriteSubType(out, prop.Type);
+			}
+		}
+		else if constexpr (std::is_same_v<T, TupleType>)
+		{
+			WriteSubType(out, arg.SubType);
+			Write<uint64_t>(out, arg.Size);
+		}
+		else if constexpr (std::is_same_v<T, UserType>)
+		{
+			WriteSubType(out, arg.Type);
+		}
+	}, type);
+}
+
+static void WriteMethods(std::vector<Byte>& out, const std::vector<Method>& methods)
+{
+	Write<uint32_t>(out, static_cast<uint32_t>(methods.size()));
+	for (const Method& method : methods)
+	{
+		WriteString(out, method.Name);
+		Write<uint64_t>(out, method.VarLengthHeaderSize);
+		Write<uint32_t>(out, static_cast<uint32_t>(method.Args.size()));
+		for (const ArgType& arg : method.Args)
+		{
+			WriteType(out, arg);
+		}
+	}
+}
+
+static void WritePropertyRefs(std::vector<Byte>& out, const EntitySpec& spec, const std::vector<std::reference_wrapper<const Property>>& refs)
+{
+	Write<uint32_t>(out, static_cast<uint32_t>(refs.size()));
+	for (const Property& prop : refs)
+	{
+		Write<uint32_t>(out, static_cast<uint32_t>(&prop - spec.AllProperties.data()));
+	}
+}
+
+static std::vector<Byte> CompileSpecs(const std::vector<EntitySpec>& specs, int64_t scriptsTime)
+{
+	std::vector<Byte> out;
+	Write<uint32_t>(out, CompiledSpecsMagic);
+	Write<uint32_t>(out, CompiledSpecsVersion);
+	Write<int64_t>(out, scriptsTime);
+	Write<uint32_t>(out, static_cast<uint32_t>(specs.size()));
+
+	for (const EntitySpec& spec : specs)
+	{
+		WriteString(out, spec.Name);
+		WriteMethods(out, spec.BaseMethods);
+		WriteMethods(out, spec.CellMethods);
+		WriteMethods(out, spec.ClientMethods);
+
+		Write<uint32_t>(out, static_cast<uint32_t>(spec.AllProperties.size()));
+		for (const Property& prop : spec.AllProperties)
+		{
+			WriteString(out, prop.Name);
+			WriteType(out, prop.Type);
+			Write<uint32_t>(out, static_cast<uint32_t>(prop.Flag));
+		}
+
+		WritePropertyRefs(out, spec, spec.ClientProperties);
+		WritePropertyRefs(out, spec, spec.ClientPropertiesInternal);
+		WritePropertyRefs(out, spec, spec.CellProperties);
+		WritePropertyRefs(out, spec, spec.BaseProperties);
+	}
+
+	return out;
+}
+
+static bool ReadType(std::span<const Byte>& data, ArgType& type, size_t depth);
+
+static bool ReadSubType(std::span<const Byte>& data, std::shared_ptr<ArgType>& type, size_t depth)
+{
+	uint8_t hasType;
+	if (!TakeInto(data, hasType))
+		return false;
+
+	if (!hasType)
+		return true;
+
+	type = std::make_shared<ArgType>(UnknownType{});
+	return ReadType(data, *type, depth + 1);
+}
+
+static bool ReadType(std::span<const Byte>& data, ArgType& type, size_t depth)
+{
+	uint8_t index;
+	if (depth > MaxTypeDepth || !TakeInto(data, index))
+		return false;
+
+	switch (index)
+	{
+		case 0:
+		{
+			uint8_t basicType;
+			if (!TakeInto(data, basicType) || basicType > static_cast<uint8_t>(BasicType::Blob))
+				return false;
+			type = PrimitiveType{ static_cast<BasicType>(basicType) };
+			return true;
+		}
+		case 1:
+		{
+			ArrayType arr;
+			uint8_t hasSize;
+			uint64_t size;
+			if (!ReadSubType(data, arr.SubType, depth) || !TakeInto(data, hasSize) || !TakeInto(data, size))
+				return false;
+			if (hasSize)
+				arr.Size = size;
+			type = std::move(arr);
+			return true;
+		}
+		case 2:
+		{
+			FixedDictType dict;
+			uint8_t allowNone;
+			uint32_t count;
+			if (!TakeInto(data, allowNone) || !TakeInto(data, count))
+				return false;
+			dict.AllowNone = allowNone != 0;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				FixedDictProperty& prop = dict.Properties.emplace_back();
+				if (!ReadString(data, prop.Name) || !ReadSubType(data, prop.Type, depth))
+					return false;
+			}
+			type = std::move(dict);
+			return true;
+		}
+		case 3:
+		{
+			TupleType tuple;
+			uint64_t size;
+			if (!ReadSubType(data, tuple.SubType, depth) || !TakeInto(data, size))
+				return false;
+			tuple.Size = size;
+			type = std::move(tuple);
+			return true;
+		}
+		case 4:
+		{
+			UserType user;
+			if (!ReadSubType(data, user.Type, depth))
+				return false;
+			type = std::move(user);
+			return true;
+		}
+		case 5:
+			type = UnknownType{};
+			return true;
+		default:
+			return false;
+	}
+}
+
+static bool ReadMethods(std::span<const Byte>& data, std::vector<Method>& methods)
+{
+	uint32_t count;
+	if (!TakeInto(data, count))
+		return false;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		Method& method = methods.emplace_back();
+		uint64_t headerSize;
+		uint32_t argCount;
+		if (!ReadString(data, method.Name) || !TakeInto(data, headerSize) || !TakeInto(data, argCount))
+			return false;
+		method.Id = InternName(method.Name);
+		method.VarLengthHeaderSize = headerSize;
+
+		for (uint32_t j = 0; j < argCount; j++)
+		{
+			if (!ReadType(data, method.Args.emplace_back(UnknownType{}), 0))
+				return false;
+		}
+	}
+	return true;
+}
+
+static bool ReadPropertyRefs(std::span<const Byte>& data, const EntitySpec& spec, std::vector<std::reference_wrapper<const Property>>& refs)
+{
+	uint32_t count;
+	if (!TakeInto(data, count))
+		return false;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t index;
+		if (!TakeInto(data, index) || index >= spec.AllProperties.size())
+			return false;
+		refs.emplace_back(spec.AllProperties[index]);
+	}
+	return true;
+}
+
+// The programs point into the types, so this has to run once the methods and properties are in their final place.
+static void CompileTypePrograms(std::vector<EntitySpec>& specs)
+{
+	for (EntitySpec& spec : specs)
+	{
+		for (Method& method : spec.ClientMethods)
+		{
+			method.Program = CompileTypes(method.Args);
+		}
+		for (Property& property : spec.AllProperties)
+		{
+			property.Program = CompileType(property.Type);
+		}
+	}
+}
+
+static std::optional<std::vector<EntitySpec>> LoadCompiledSpecs(const fs::path& path, int64_t scriptsTime)
+{
+	std::vector<Byte> bytes;
+	if (const File file = File::Open(path, File::Flags::Open | File::Flags::Read))
+	{
+		if (!file.ReadAll(bytes))
+			return {};
+	}
+	else
+	{
+		return {};
+	}
+
+	std::span<const Byte> data = bytes;
+	uint32_t magic, formatVersion, count;
+	int64_t time;
+	if (!TakeInto(data, magic) || !TakeInto(data, formatVersion) || !TakeInto(data, time) || !TakeInto(data, count))
+		return {};
+
+	if (magic != CompiledSpecsMagic || formatVersion != CompiledSpecsVersion || time != scriptsTime)
+		return {};
+
+	std::vector<EntitySpec> specs;
+	specs.reserve(count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		EntitySpec& spec = specs.emplace_back();
+		if (!ReadString(data, spec.Name) || !ReadMethods(data, spec.BaseMethods) || !ReadMethods(data, spec.CellMethods) || !ReadMethods(data, spec.ClientMethods))
+			return {};
+
+		uint32_t propertyCount;
+		if (!TakeInto(data, propertyCount))
+			return {};
+
+		// the property refs point into this, so it must not reallocate after they are created
+		spec.AllProperties.reserve(propertyCount);
+		for (uint32_t j = 0; j < propertyCount; j++)
+		{
+			Property& prop = spec.AllProperties.emplace_back(Property{ "", NameId{}, UnknownType{}, PropertyFlag::Unknown });
+			uint32_t flag;
+			if (!ReadString(data, prop.Name) || !ReadType(data, prop.Type, 0) || !TakeInto(data, flag))
+				return {};
+			prop.Id = InternName(prop.Name);
+			prop.Flag = static_cast<PropertyFlag>(flag);
+		}
+
+		if (!ReadPropertyRefs(data, spec, spec.ClientProperties) || !ReadPropertyRefs(data, spec, spec.ClientPropertiesInternal) ||
+			!ReadPropertyRefs(data, spec, spec.CellProperties) || !ReadPropertyRefs(data, spec, spec.BaseProperties))
+			return {};
+	}
+
+	if (!data.empty())
+		return {};
+
+	CompileTypePrograms(specs);
+	return specs;
+}
+
+static void WriteCompiledSpecs(const fs::path& path, const std::vector<EntitySpec>& specs, int64_t scriptsTime)
+{
+	const std::vector<Byte> data = CompileSpecs(specs, scriptsTime);
+
+	if (!File::WriteAtomic(path, data))
+	{
+		LOG_WARN(STR("Failed to write compiled game scripts {} - {}"), path, StringWrap(File::LastError()));
+	}
+}
+
+}  // namespace
+
+static std::optional<std::unordered_map<std::string, ArgType>> ParseAliases(const ScriptSource& source)
 {
 	XMLDocument doc;
-	XmlResult<void> res = LoadXml(doc, path);
+	XmlResult<void> res = source.LoadXml(doc, "entity_defs/alias.xml");
 	if (!res)
 	{
-		LOG_ERROR(STR("Failed to open alias.xml ({}): {}."), path, StringWrap(res.error()));
+		LOG_ERROR("Failed to open alias.xml: {}.", res.error());
 		return {};
 	}
 
@@ -63,7 +399,12 @@ std::vector<EntitySpec> rp::ParseScripts(Version version, const fs::path& gameFi
 		return {};
 	}
 
-	auto aliasResult = ParseAliases(versionDir / "entity_defs" / "alias.xml");
+	return ParseScripts(ScriptDirectory(versionDir));
+}
+
+std::vector<EntitySpec> rp::ParseScripts(const ScriptSource& source)
+{
+	auto aliasResult = ParseAliases(source);
 	if (!aliasResult)
 	{
 		LOG_ERROR("Failed to parse aliases");
@@ -72,10 +413,9 @@ std::vector<EntitySpec> rp::ParseScripts(Version version, const fs::path& gameFi
 	AliasType aliases = aliasResult.value();
 
 	XMLDocument doc;
-	const fs::path entitiesPath(versionDir / "entities.xml");
-	if (!LoadXml(doc, entitiesPath))
+	if (!source.LoadXml(doc, "entities.xml"))
 	{
-		LOG_ERROR(STR("Failed to open entities.xml ({}): {}."), entitiesPath, StringWrap(doc.ErrorStr()));
+		LOG_ERROR("Failed to open entities.xml: {}.", doc.ErrorStr());
 		return {};
 	}
 	
@@ -92,10 +432,10 @@ std::vector<EntitySpec> rp::ParseScripts(Version version, const fs::path& gameFi
 		for (XMLElement* entityElem = clientServerEntries->FirstChildElement(); entityElem != nullptr; entityElem = entityElem->NextSiblingElement())
 		{
 			std::string entityName = Core::String::Trim(entityElem->Name());
-			DefFile defFile = ParseDef(versionDir / "entity_defs" / fmt::format("{}.def", entityName), aliases);
+			DefFile defFile = ParseDef(source, fmt::format("entity_defs/{}.def", entityName), aliases);
 			std::vector<DefFile> interfaces;
 
-			ParseInterfaces((versionDir / "entity_defs" / "interfaces"), aliases, defFile, interfaces);
+			ParseInterfaces(source, "entity_defs/interfaces", aliases, defFile, interfaces);
 			interfaces.push_back(defFile);
 
 			DefFile merged = MergeDefs(interfaces);
@@ -140,5 +480,73 @@ std::vector<EntitySpec> rp::ParseScripts(Version version, const fs::path& gameFi
 		return {};
 	}
 
+	CompileTypePrograms(specs);
 	return specs;
 }
+
+std::shared_ptr<const std::vector<EntitySpec>> rp::GetEntitySpecs(Version version, const fs::path& gameFilePath)
+{
+	[[clang::no_destroy]] static std::mutex mutex;
+	[[clang::no_destroy]] static std::unordered_map<std::string, std::shared_ptr<const std::vector<EntitySpec>>> cache;
+
+	const fs::path versionDir = gameFilePath / version.ToString(".", true);
+	const std::string key = versionDir.string();
+
+	// the lock is held while parsing, so concurrent requests for the same version dont parse it twice
+	std::scoped_lock lock(mutex);
+	if (auto it = cache.find(key); it != cache.end())
+	{
+		return it->second;
+	}
+
+	const fs::path compiledPath = versionDir / "scripts.bin";
+
+	std::error_code ec;
+	const fs::file_time_type scriptsTime = fs::last_write_time(versionDir / "scripts" / "entities.xml", ec);
+	if (ec)
+	{
+		// the scripts might have been parsed straight from the game files and never unpacked
+		if (std::optional<std::vector<EntitySpec>> specs = LoadCompiledSpecs(compiledPath, StoredSpecsTime))
+		{
+			auto shared = std::make_shared<const std::vector<EntitySpec>>(std::move(*specs));
+			cache.emplace(key, shared);
+			return shared;
+		}
+
+		LOG_ERROR("Game scripts for version {} not found.", version.ToString(".", true));
+		return nullptr;
+	}
+	const int64_t time = scriptsTime.time_since_epoch().count();
+
+	std::optional<std::vector<EntitySpec>> specs = LoadCompiledSpecs(compiledPath, time);
+	if (!specs)
+	{
+		specs = ParseScripts(version, gameFilePath);
+		if (specs->empty())
+		{
+			return nullptr;
+		}
+		WriteCompiledSpecs(compiledPath, *specs, time);
+	}
+
+	auto shared = std::make_shared<const std::vector<EntitySpec>>(std::move(*specs));
+	cache.emplace(key, shared);
+	return shared;
+}
+
+void rp::StoreEntitySpecs(const fs::path& versionDir, const std::vector<EntitySpec>& specs)
+{
+	std::error_code ec;
+	fs::create_directories(versionDir, ec);
+	if (ec)
+	{
+		LOG_WARN(STR("Failed to create directory {} - {}"), versionDir, StringWrap(ec.message()));
+		return;
+	}
+	WriteCompiledSpecs(versionDir / "scripts.bin", specs, StoredSpecsTime);
+}
+
+XmlResult<void> ScriptDirectory::LoadXml(XMLDocument& doc, std::string_view path) const
+{
+	return Core::LoadXml(doc, m_root / path);
+}
@@ -9,12 +9,17 @@
 #include "ReplayParser/Types.hpp"
 #include "ReplayParser/Variant.hpp"
 
+#include <memory_resource>
+#include <optional>
 #include <type_traits>
 #include <span>
+#include <utility>
 
 
 namespace rp = PotatoAlert::ReplayParser;
 using PotatoAlert::ReplayParser::ArrayType;
+using PotatoAlert::ReplayParser::ArgArray;
+using PotatoAlert::ReplayParser::ArgDict;
 using PotatoAlert::ReplayParser::ArgType;
 using PotatoAlert::ReplayParser::ArgValue;
 using PotatoAlert::ReplayParser::BitReader;
@@ -30,9 +35,9 @@ using PotatoAlert::ReplayParser::ReplayResult;
 
 namespace {
 
-ReplayResult<PropertyNesting> GetNestedUpdateCommand(bool isSlice, const ArgType& argType, ArgValue* argValue, BitReader& bitReader)
+ReplayResult<PropertyNesting> GetNestedUpdateCommand(bool isSlice, const ArgType& argType, ArgValue* argValue, BitReader& bitReader, std::pmr::memory_resource* memory)
 {
-	return std::visit([isSlice, &bitReader, &argValue](auto&& arg) -> ReplayResult<PropertyNesting>
+	return std::visit([isSlice, &bitReader, &argValue, memory](auto&& arg) -> ReplayResult<PropertyNesting>
 	{
 		using T = std::decay_t<decltype(arg)>;
 
@@ -47,18 +52,30 @@ ReplayResult<PropertyNesting> GetNestedUpdateCommand(bool isSlice, const ArgType
 			std::span<const Byte> remaining = bitReader.GetAll();
 
 			const FixedDictProperty prop = arg.Properties[entryIndex];
-			const ArgValue propValue = ParseValue(remaining, *prop.Type);
+			std::optional<ArgValue> parsedValue = ParseValue(remaining, *prop.Type, memory);
+			if (!parsedValue)
+				return PA_REPLAY_ERROR("Failed to parse value of nested FixedDict property '{}', not enough data", prop.Name);
+			ArgValue propValue = std::move(parsedValue.value());
 
 			// we can safely use std::get here
-			std::unordered_map<std::string, ArgValue>& value = std::get<std::unordered_map<std::string, ArgValue>>(*argValue);
-			value.insert_or_assign(prop.Name, propValue);
+			ArgDict& value = std::get<ArgDict>(*argValue);
+			if (value.Values.empty())
+			{
+				// setting a key of a none dict
+				value.Type = &arg;
+				for (const FixedDictProperty& property : arg.Properties)
+				{
+					value.Values.emplace_back(GetDefaultValue(*property.Type, memory));
+				}
+			}
+			value.Values[entryIndex] = CopyValue(propValue, memory);
 
-			return PropertyNesting{ {}, UpdateActionSetKey{ prop.Name, propValue } };
+			return PropertyNesting{ {}, UpdateActionSetKey{ prop.Name, std::move(propValue) } };
 		}
 		else if constexpr (std::is_same_v<T, ArrayType>)
 		{
 			// we can safely use std::get here
-			std::vector<ArgValue>& value = std::get<std::vector<ArgValue>>(*argValue);
+			ArgArray& value = std::get<ArgArray>(*argValue);
 
 			if (isSlice)
 			{
@@ -75,7 +92,7 @@ ReplayResult<PropertyNesting> GetNestedUpdateCommand(bool isSlice, const ArgType
 
 				std::span<const Byte> remaining = bitReader.GetAll();
 
-				auto SliceInsert = []<typename T>(size_t idx1, size_t idx2, std::vector<T>& target, const std::vector<T>& source)
+				auto SliceInsert = [memory](size_t idx1, size_t idx2, ArgArray& target, const ArgArray& source)
 				{
 					if (idx1 != idx2)
 					{
@@ -84,25 +101,28 @@ ReplayResult<PropertyNesting> GetNestedUpdateCommand(bool isSlice, const ArgType
 
 					for (size_t i = 0; i < source.size(); i++)
 					{
-						target.insert(target.begin() + std::min(idx1 + i, target.size()), source[i]);
+						target.insert(target.begin() + std::min(idx1 + i, target.size()), CopyValue(source[i], memory));
 					}
 				};
 
 				if (remaining.empty())
 				{
-					const std::vector<ArgValue> a{};
+					const ArgArray a(memory);
 					SliceInsert(idx1, idx2, value, a);
 					return PropertyNesting{ {}, UpdateActionRemoveRange{ idx1, idx2 } };
 				}
 
-				std::vector<ArgValue> newValues;
+				ArgArray newValues(memory);
 				while (!remaining.empty())
 				{
-					newValues.emplace_back(ParseValue(remaining, *arg.SubType));
+					std::optional<ArgValue> value = ParseValue(remaining, *arg.SubType, memory);
+					if (!value)
+						return PA_REPLAY_ERROR("Failed to parse element of nested ArrayType, not enough data");
+					newValues.emplace_back(std::move(value.value()));
 				}
 
 				SliceInsert(idx1, idx2, value, newValues);
-				return PropertyNesting{ {}, UpdateActionSetRange{ idx1, idx2, newValues } };
+				return PropertyNesting{ {}, UpdateActionSetRange{ idx1, idx2, std::move(newValues) } };
 			}
 			else
 			{
@@ -118,16 +138,19 @@ ReplayResult<PropertyNesting> GetNestedUpdateCommand(bool isSlice, const ArgType
 				if (remaining.empty())
 					return PA_REPLAY_ERROR("FixedDict ArrayType has no data remaining");
 
-				std::vector<ArgValue> newValues;
+				ArgArray newValues(memory);
 				while (!remaining.empty())
 				{
-					newValues.emplace_back(ParseValue(remaining, *arg.SubType));
+					std::optional<ArgValue> value = ParseValue(remaining, *arg.SubType, memory);
+					if (!value)
+						return PA_REPLAY_ERROR("Failed to parse element of nested ArrayType, not enough data");
+					newValues.emplace_back(std::move(value.value()));
 				}
 				newValues.erase(newValues.begin());
 
-				value[index] = newValues;
+				value[index] = std::move(newValues);
 
-				return PropertyNesting{ {}, UpdateActionSetElement{ index, value[index] } };
+				return PropertyNesting{ {}, UpdateActionSetElement{ index, CopyValue(value[index], memory) } };
 			}
 		}
 		else
@@ -140,14 +163,14 @@ ReplayResult<PropertyNesting> GetNestedUpdateCommand(bool isSlice, const ArgType
 }  // namespace
 
 
-ReplayResult<PropertyNesting> rp::GetNestedPropertyPath(bool isSlice, const ArgType& argType, ArgValue* argValue, BitReader& bitReader)
+ReplayResult<PropertyNesting> rp::GetNestedPropertyPath(bool isSlice, const ArgType& argType, ArgValue* argValue, BitReader& bitReader, std::pmr::memory_resource* memory)
 {
 	if (bitReader.Get(1) == 0)
 	{
-		return GetNestedUpdateCommand(isSlice, argType, argValue, bitReader);
+		return GetNestedUpdateCommand(isSlice, argType, argValue, bitReader, memory);
 	}
 
-	return std::visit([isSlice, &bitReader, &argValue](auto&& arg) -> ReplayResult<PropertyNesting>
+	return std::visit([isSlice, &bitReader, &argValue, memory](auto&& arg) -> ReplayResult<PropertyNesting>
 	{
 		using T = std::decay_t<decltype(arg)>;
 
@@ -158,11 +181,11 @@ ReplayResult<PropertyNesting> rp::GetNestedPropertyPath(bool isSlice, const ArgT
 
 			const ArgValue* newArgValue;
 
-			ReplayResult<void> setRes = VariantGet<std::unordered_map<std::string, ArgValue>>(*argValue, [&prop, &newArgValue, &arg](const auto& value) -> ReplayResult<void>
+			ReplayResult<void> setRes = VariantGet<ArgDict>(*argValue, [&prop, &newArgValue, propIndex](const ArgDict& value) -> ReplayResult<void>
 			{
-				if (value.contains(prop.Name))
+				if (static_cast<size_t>(propIndex) < value.Values.size())
 				{
-					newArgValue = &value.at(prop.Name);
+					newArgValue = &value.Values[propIndex];
 					return {};
 				}
 				return PA_REPLAY_ERROR("Nested Property Path does not contain property named ''", prop.Name);
@@ -173,19 +196,19 @@ ReplayResult<PropertyNesting> rp::GetNestedPropertyPath(bool isSlice, const ArgT
 
 			const ArgType newType = *arg.Properties[propIndex].Type;
 
-			PA_TRY(nesting, GetNestedPropertyPath(isSlice, *arg.Properties[propIndex].Type, argValue, bitReader));
+			PA_TRY(nesting, GetNestedPropertyPath(isSlice, *arg.Properties[propIndex].Type, argValue, bitReader, memory));
 			nesting.Levels.insert(nesting.Levels.begin(), PropertyNestLevel{ prop.Name });
 			return nesting;
 		}
 		else if constexpr (std::is_same_v<T, ArrayType>)
 		{
-			// this always has to be std::vector<ArgValue>
-			std::vector<ArgValue>& arr = std::get<std::vector<ArgValue>>(*argValue);
+			// this always has to be ArgArray
+			ArgArray& arr = std::get<ArgArray>(*argValue);
 			const size_t propIndex = bitReader.Get(BitReader::BitsRequired(static_cast<int>(arr.size())));
 
 			if (propIndex == arr.size())
 			{
-				arr.push_back(GetDefaultValue(*arg.SubType));
+				arr.push_back(GetDefaultValue(*arg.SubType, memory));
 			}
 			else if (propIndex > arr.size())
 			{
@@ -193,7 +216,7 @@ ReplayResult<PropertyNesting> rp::GetNestedPropertyPath(bool isSlice, const ArgT
 				return PropertyNesting{};  // TODO: handle this properly
 			}
 
-			PA_TRY(nesting, GetNestedPropertyPath(isSlice, *arg.SubType, &arr[propIndex], bitReader));
+			PA_TRY(nesting, GetNestedPropertyPath(isSlice, *arg.SubType, &arr[propIndex], bitReader, memory));
 			nesting.Levels.insert(nesting.Levels.begin(), PropertyNestLevel{ propIndex });
 			return nesting;
 		}
@@ -8,8 +8,11 @@
 #include "ReplayParser/PacketParser.hpp"
 #include "ReplayParser/Packets.hpp"
 #include "ReplayParser/Result.hpp"
+#include "ReplayParser/TypeProgram.hpp"
 
+#include <array>
 #include <cstdint>
+#include <functional>
 #include <optional>
 #include <span>
 #include <unordered_map>
@@ -70,7 +73,55 @@ static constexpr bool IsPacket(PacketBaseType type, uint32_t id, Version version
 	return false;
 }
 
-static ReplayResult<EntityMethodPacket> ParseEntityMethodPacket(std::span<const Byte>& data, PacketParser& parser, float clock)
+// packets of these types dont change the entity state, so they can be skipped entirely if nobody is interested in them
+static constexpr std::array StatelessPacketTypes =
+{
+	PacketBaseType::EntityMethod,
+	PacketBaseType::EntityControl,
+	PacketBaseType::EntityEnter,
+	PacketBaseType::EntityLeave,
+	PacketBaseType::PlayerPosition,
+	PacketBaseType::PlayerOrientation,
+	PacketBaseType::Version,
+	PacketBaseType::PlayerEntity,
+	PacketBaseType::Camera,
+	PacketBaseType::CameraMode,
+	PacketBaseType::Map,
+	PacketBaseType::CameraFreeLook,
+	PacketBaseType::CruiseState,
+	PacketBaseType::Result,
+};
+
+static constexpr std::optional<PacketBaseType> GetStatelessPacketType(uint32_t id, Version version)
+{
+	for (PacketBaseType type : StatelessPacketTypes)
+	{
+		if (IsPacket(type, id, version))
+			return type;
+	}
+	return {};
+}
+
+static bool IsInterested(const PacketParser& parser, PacketBaseType type)
+{
+	return !parser.Interest || parser.Interest->Packets.contains(type);
+}
+
+static bool IsInterested(const PacketParser& parser, int specId, const std::vector<bool> PacketParser::SpecInterest::* member, size_t index)
+{
+	return parser.SpecInterests.empty() || (parser.SpecInterests[specId].*member)[index];
+}
+
+// returned in place of packets nobody is interested in
+static UnknownPacket SkipPacket(PacketBaseType type, float clock)
+{
+	UnknownPacket packet;
+	packet.Type = type;
+	packet.Clock = clock;
+	return packet;
+}
+
+static ReplayResult<PacketType> ParseEntityMethodPacket(std::span<const Byte>& data, PacketParser& parser, float clock)
 {
 	EntityMethodPacket packet;
 	packet.Type = PacketBaseType::EntityMethod;
@@ -102,37 +153,41 @@ static ReplayResult<EntityMethodPacket> ParseEntityMethodPacket(std::span<const
 	const uint16_t entityType = parser.Entities.at(packet.EntityId).Type;
 
 	const int specId = entityType - 1;
-	if (specId < 0 || specId >= parser.Specs.size())
+	if (specId < 0 || specId >= parser.Specs->size())
 	{
 		return PA_REPLAY_ERROR("Missing EntitySpec {} for EntityMethodPacket", specId);
 	}
-	const EntitySpec& spec = parser.Specs[specId];
+	const EntitySpec& spec = (*parser.Specs)[specId];
 
 	if (packet.MethodId >= spec.ClientMethods.size())
 	{
 		return PA_REPLAY_ERROR("Invalid methodId {} for EntityMethodPacket", packet.MethodId);
 	}
+	if (!IsInterested(parser, specId, &PacketParser::SpecInterest::ClientMethods, packet.MethodId))
+	{
+		return SkipPacket(packet.Type, clock);
+	}
+
 	const Method& method = spec.ClientMethods[packet.MethodId];
+	packet.MethodNameId = method.Id;
 	packet.MethodName = method.Name;
 
+	if (method.Program.IsFixedSize() && data.size() < method.Program.Size)
+	{
+		return PA_REPLAY_ERROR("Payload of EntityMethodPacket '{}' is smaller than its fixed size: {} < {}", method.Name, data.size(), method.Program.Size);
+	}
+
 	packet.Values.reserve(method.Args.size());
-	for (const ArgType& argType : method.Args)
+	if (!DecodeValues(method.Program, data, parser.Memory, packet.Values))
 	{
-		if (std::optional<ArgValue> value = ParseValue(data, argType))
-		{
-			packet.Values.emplace_back(value.value());
-		}
-		else
-		{
-			return PA_REPLAY_ERROR("Failed to parse value for EntityMethodPacket");
-		}
+		return PA_REPLAY_ERROR("Failed to parse values for EntityMethodPacket '{}', not enough data", method.Name);
 	}
 
 	parser.Callbacks.Invoke(packet);
 	return packet;
 }
 
-static ReplayResult<EntityCreatePacket> ParseEntityCreatePacket(std::span<const Byte>& data, PacketParser& parser, float clock)
+static ReplayResult<PacketType> ParseEntityCreatePacket(std::span<const Byte>& data, PacketParser& parser, float clock)
 {
 	EntityCreatePacket packet;
 	packet.Type = PacketBaseType::EntityCreate;
@@ -178,11 +233,11 @@ static ReplayResult<EntityCreatePacket> ParseEntityCreatePacket(std::span<const
 	}
 
 	const int specId = packet.EntityType - 1;
-	if (specId < 0 || specId >= parser.Specs.size())
+	if (specId < 0 || specId >= parser.Specs->size())
 	{
 		return PA_REPLAY_ERROR("Missing EntitySpec {} for EntityCreatePacket", specId);
 	}
-	const EntitySpec& spec = parser.Specs[specId];
+	const EntitySpec& spec = (*parser.Specs)[specId];
 
 	packet.Values.reserve(propertyCount);
 
@@ -198,12 +253,19 @@ static ReplayResult<EntityCreatePacket> ParseEntityCreatePacket(std::span<const
 		}
 		if (propertyId < spec.ClientProperties.size())
 		{
-			const auto& [name, type, flag] = spec.ClientProperties[propertyId].get();
+			const auto& [name, id, type, flag, program] = spec.ClientProperties[propertyId].get();
 
-			if (std::optional<ArgValue> value = ParseValue(data, type))
+			if (!IsInterested(parser, specId, &PacketParser::SpecInterest::ClientProperties, propertyId))
+			{
+				if (!SkipValue(program, data))
+				{
+					return PA_REPLAY_ERROR("Failed to skip value for EntityCreatePacket, not enough data");
+				}
+			}
+			else if (std::optional<ArgValue> value = DecodeValue(program, data, parser.Memory))
 			{
-				packet.Values[name] = value.value();
-				clientPropertyValues.insert_or_assign(name, value.value());
+				packet.Values.insert_or_assign(name, CopyValue(value.value(), parser.Memory));
+				clientPropertyValues.insert_or_assign(name, std::move(value.value()));
 			}
 			else
 			{
@@ -216,13 +278,18 @@ static ReplayResult<EntityCreatePacket> ParseEntityCreatePacket(std::span<const
 		}
 	}
 
-	parser.Entities.insert_or_assign(packet.EntityId, Entity{ packet.EntityType, spec, {}, clientPropertyValues });
+	parser.Entities.insert_or_assign(packet.EntityId, Entity{ packet.EntityType, spec, {}, std::move(clientPropertyValues) });
+
+	if (!IsInterested(parser, packet.Type))
+	{
+		return SkipPacket(packet.Type, clock);
+	}
 
 	parser.Callbacks.Invoke(packet);
 	return packet;
 }
 
-static ReplayResult<EntityPropertyPacket> ParseEntityPropertyPacket(std::span<const Byte>& data, PacketParser& parser, float clock)
+static ReplayResult<PacketType> ParseEntityPropertyPacket(std::span<const Byte>& data, PacketParser& parser, float clock)
 {
 	EntityPropertyPacket packet;
 	packet.Clock = clock;
@@ -254,17 +321,23 @@ static ReplayResult<EntityPropertyPacket> ParseEntityPropertyPacket(std::span<co
 	const uint16_t entityType = parser.Entities.at(packet.EntityId).Type;
 
 	const int specId = entityType - 1;
-	if (specId < 0 || specId >= parser.Specs.size())
+	if (specId < 0 || specId >= parser.Specs->size())
 	{
 		return PA_REPLAY_ERROR("Missing EntitySpec {} for EntityPropertyPacket", specId);
 	}
-	const EntitySpec& spec = parser.Specs[specId];
+	const EntitySpec& spec = (*parser.Specs)[specId];
 
 	if (packet.MethodId >= spec.ClientProperties.size())
 	{
 		return PA_REPLAY_ERROR("Invalid methodId {} for EntityPropertyPacket", packet.MethodId);
 	}
+	if (!IsInterested(parser, specId, &PacketParser::SpecInterest::ClientProperties, packet.MethodId))
+	{
+		return SkipPacket(packet.Type, clock);
+	}
+
 	const Property& property = spec.ClientProperties[packet.MethodId];
+	packet.PropertyNameId = property.Id;
 	packet.PropertyName = property.Name;
 
 	if (!parser.Entities.contains(packet.EntityId))
@@ -273,21 +346,26 @@ static ReplayResult<EntityPropertyPacket> ParseEntityPropertyPacket(std::span<co
 	}
 	Entity& entity = parser.Entities.at(packet.EntityId);
 
-	if (std::optional<ArgValue> value = ParseValue(data, property.Type))
+	if (std::optional<ArgValue> value = DecodeValue(property.Program, data, parser.Memory))
 	{
-		packet.Value = value.value();
-		entity.ClientPropertiesValues.insert_or_assign(property.Name, value.value());
+		packet.Value = CopyValue(value.value(), parser.Memory);
+		entity.ClientPropertiesValues.insert_or_assign(property.Name, std::move(value.value()));
 	}
 	else
 	{
 		return PA_REPLAY_ERROR("Failed to parse value for EntityPropertyPacket");
 	}
 
+	if (!IsInterested(parser, packet.Type))
+	{
+		return SkipPacket(packet.Type, clock);
+	}
+
 	parser.Callbacks.Invoke(packet);
 	return packet;
 }
 
-static ReplayResult<BasePlayerCreatePacket> ParseBasePlayerCreatePacket(std::span<const Byte>& data, PacketParser& parser, float clock)
+static ReplayResult<PacketType> ParseBasePlayerCreatePacket(std::span<const Byte>& data, PacketParser& parser, float clock)
 {
 	BasePlayerCreatePacket packet;
 	packet.Clock = clock;
@@ -304,11 +382,11 @@ static ReplayResult<BasePlayerCreatePacket> ParseBasePlayerCreatePacket(std::spa
 		return err();
 
 	const int specId = packet.EntityType - 1;
-	if (specId < 0 || specId >= parser.Specs.size())
+	if (specId < 0 || specId >= parser.Specs->size())
 	{
 		return PA_REPLAY_ERROR("Missing EntitySpec {} for BasePlayerCreatePacket", specId);
 	}
-	const EntitySpec& spec = parser.Specs[specId];
+	const EntitySpec& spec = (*parser.Specs)[specId];
 
 	const size_t propertyCount = spec.BaseProperties.size();
 	std::unordered_map<std::string, ArgValue> basePropertyValues;
@@ -316,19 +394,24 @@ static ReplayResult<BasePlayerCreatePacket> ParseBasePlayerCreatePacket(std::spa
 
 	for (uint8_t i = 0; i < propertyCount; i++)
 	{
-		const auto& [name, type, flag] = spec.BaseProperties[i].get();
+		const auto& [name, id, type, flag, program] = spec.BaseProperties[i].get();
 
-		if (std::optional<ArgValue> value = ParseValue(data, type))
+		if (std::optional<ArgValue> value = DecodeValue(program, data, parser.Memory))
 		{
-			basePropertyValues.emplace(name, value.value());
+			basePropertyValues.emplace(name, std::move(value.value()));
 		}
 		else
 		{
-			return PA_REPLAY_ERROR("Failed to parse value for EntityCreatePacket");
+			return PA_REPLAY_ERROR("Failed to parse value of property '{}' for BasePlayerCreatePacket, not enough data", name);
 		}
 	}
 
-	parser.Entities.emplace(packet.EntityId, Entity{ packet.EntityType, spec, basePropertyValues, {} });  // TODO: parse the state
+	parser.Entities.emplace(packet.EntityId, Entity{ packet.EntityType, spec, std::move(basePropertyValues), {} });  // TODO: parse the state
+
+	if (!IsInterested(parser, packet.Type))
+	{
+		return SkipPacket(packet.Type, clock);
+	}
 
 	std::span<const Byte> state = Take(data, data.size());
 	packet.Data = { state.begin(), state.end() };
@@ -337,7 +420,7 @@ static ReplayResult<BasePlayerCreatePacket> ParseBasePlayerCreatePacket(std::spa
 	return packet;
 }
 
-static ReplayResult<CellPlayerCreatePacket> ParseCellPlayerCreatePacket(std::span<const Byte>& data, PacketParser& parser, float clock)
+static ReplayResult<PacketType> ParseCellPlayerCreatePacket(std::span<const Byte>& data, PacketParser& parser, float clock)
 {
 	CellPlayerCreatePacket packet;
 	packet.Type = PacketBaseType::CellPlayerCreate;
@@ -376,11 +459,11 @@ static ReplayResult<CellPlayerCreatePacket> ParseCellPlayerCreatePacket(std::spa
 	const uint16_t entityType = parser.Entities.at(packet.EntityId).Type;
 
 	const int specId = entityType - 1;
-	if (specId < 0 || specId >= parser.Specs.size())
+	if (specId < 0 || specId >= parser.Specs->size())
 	{
 		return PA_REPLAY_ERROR("Missing EntitySpec {} for CellPlayerCreatePacket", specId);
 	}
-	const EntitySpec& spec = parser.Specs[specId];
+	const EntitySpec& spec = (*parser.Specs)[specId];
 
 	if (!parser.Entities.contains(packet.EntityId))
 	{
@@ -389,12 +472,21 @@ static ReplayResult<CellPlayerCreatePacket> ParseCellPlayerCreatePacket(std::spa
 	}
 
 	packet.Values.reserve(spec.ClientPropertiesInternal.size());
-	for (auto property : spec.ClientPropertiesInternal)
+	for (size_t i = 0; i < spec.ClientPropertiesInternal.size(); i++)
 	{
-		if (std::optional<ArgValue> value = ParseValue(data, property.get().Type))
+		const std::reference_wrapper<const Property> property = spec.ClientPropertiesInternal[i];
+
+		if (!IsInterested(parser, specId, &PacketParser::SpecInterest::ClientPropertiesInternal, i))
+		{
+			if (!SkipValue(property.get().Program, data))
+			{
+				return PA_REPLAY_ERROR("Failed to skip value for CellPlayerCreatePacket, not enough data");
+			}
+		}
+		else if (std::optional<ArgValue> value = DecodeValue(property.get().Program, data, parser.Memory))
 		{
-			packet.Values[property.get().Name] = value.value();
-			parser.Entities.at(packet.EntityId).ClientPropertiesValues.emplace(property.get().Name, value.value());
+			packet.Values.insert_or_assign(property.get().Name, CopyValue(value.value(), parser.Memory));
+			parser.Entities.at(packet.EntityId).ClientPropertiesValues.emplace(property.get().Name, std::move(value.value()));
 		}
 		else
 		{
@@ -410,6 +502,11 @@ static ReplayResult<CellPlayerCreatePacket> ParseCellPlayerCreatePacket(std::spa
 		LOG_WARN("CellPlayerCreatePacket had {} bytes remaining after parsing", data.size());
 	}
 
+	if (!IsInterested(parser, packet.Type))
+	{
+		return SkipPacket(packet.Type, clock);
+	}
+
 	parser.Callbacks.Invoke(packet);
 	return packet;
 }
@@ -486,7 +583,7 @@ static ReplayResult<EntityLeavePacket> ParseEntityLeavePacket(std::span<const By
 	return packet;
 }
 
-static ReplayResult<NestedPropertyUpdatePacket> ParseNestedPropertyUpdatePacket(std::span<const Byte>& data, PacketParser& parser, float clock)
+static ReplayResult<PacketType> ParseNestedPropertyUpdatePacket(std::span<const Byte>& data, PacketParser& parser, float clock)
 {
 	NestedPropertyUpdatePacket packet;
 	packet.Type = PacketBaseType::NestedPropertyUpdate;
@@ -535,9 +632,15 @@ static ReplayResult<NestedPropertyUpdatePacket> ParseNestedPropertyUpdatePacket(
 		return PA_REPLAY_ERROR("Property index out of range ({}) for spec in NestedPropertyUpdatePacket", propIndex);
 	}
 
+	if (!IsInterested(parser, packet.EntityPtr->Type - 1, &PacketParser::SpecInterest::ClientProperties, propIndex))
+	{
+		return SkipPacket(packet.Type, clock);
+	}
+
 	const Property& prop = spec.ClientProperties[propIndex].get();
 
 	packet.PropertyIndex = propIndex;
+	packet.PropertyNameId = prop.Id;
 	packet.PropertyName = prop.Name;
 
 	if (!packet.EntityPtr->ClientPropertiesValues.contains(prop.Name))
@@ -545,14 +648,19 @@ static ReplayResult<NestedPropertyUpdatePacket> ParseNestedPropertyUpdatePacket(
 		return PA_REPLAY_ERROR("Entity is missing property value for '{}' in NestedPropertyUpdatePacket", prop.Name);
 	}
 
-	PA_TRY(nesting, GetNestedPropertyPath(isSlice, prop.Type, &packet.EntityPtr->ClientPropertiesValues[prop.Name], bitReader));
-	packet.Nesting = nesting;
+	PA_TRY(nesting, GetNestedPropertyPath(isSlice, prop.Type, &packet.EntityPtr->ClientPropertiesValues[prop.Name], bitReader, parser.Memory));
+	packet.Nesting = std::move(nesting);
 
 	if (!data.empty())
 	{
 		LOG_WARN("NestedPropertyUpdatePacket had {} bytes remaining after parsing", data.size());
 	}
 
+	if (!IsInterested(parser, packet.Type))
+	{
+		return SkipPacket(packet.Type, clock);
+	}
+
 	parser.Callbacks.Invoke(packet);
 	return packet;
 }
@@ -878,6 +986,15 @@ ReplayResult<PacketType> PotatoAlert::ReplayParser::ParsePacket(std::span<const
 
 	std::span<const Byte> raw = Take(data, size);
 
+	if (parser.Interest)
+	{
+		if (const std::optional<PacketBaseType> baseType = GetStatelessPacketType(type, version))
+		{
+			if (!parser.Interest->Packets.contains(baseType.value()))
+				return SkipPacket(baseType.value(), clock);
+		}
+	}
+
 	if (IsPacket(PacketBaseType::EntityCreate, type, version))
 		return ParseEntityCreatePacket(raw, parser, clock);
 	if (IsPacket(PacketBaseType::BasePlayerCreate, type, version))
@@ -1017,3 +1134,38 @@ ReplayResult<PacketType> PotatoAlert::ReplayParser::ParsePacket(std::span<const
 
 	return UnknownPacket{};
 }
+
+void PotatoAlert::ReplayParser::SetPacketInterest(PacketParser& parser, PacketInterest interest)
+{
+	parser.SpecInterests.clear();
+
+	if (parser.Specs)
+	{
+		for (const EntitySpec& spec : *parser.Specs)
+		{
+			const auto properties = interest.Properties.find(spec.Name);
+			auto isInterested = [&interest, &properties](const Property& property) -> bool
+			{
+				if (interest.Properties.empty())
+					return true;
+				return properties != interest.Properties.end() && properties->second.contains(property.Id);
+			};
+
+			PacketParser::SpecInterest& specInterest = parser.SpecInterests.emplace_back();
+			for (const Method& method : spec.ClientMethods)
+			{
+				specInterest.ClientMethods.push_back(interest.Methods.empty() || interest.Methods.contains(method.Id));
+			}
+			for (const Property& property : spec.ClientProperties)
+			{
+				specInterest.ClientProperties.push_back(isInterested(property));
+			}
+			for (const Property& property : spec.ClientPropertiesInternal)
+			{
+				specInterest.ClientPropertiesInternal.push_back(isInterested(property));
+			}
+		}
+	}
+
+	parser.Interest = std::move(interest);
+}
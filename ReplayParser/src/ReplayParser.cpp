@@ -2,22 +2,33 @@
 
 #include "Core/Blowfish.hpp"
 #include "Core/Bytes.hpp"
+#include "Core/Defer.hpp"
 #include "Core/File.hpp"
 #include "Core/FileMapping.hpp"
 #include "Core/Instrumentor.hpp"
 #include "Core/Json.hpp"
+#include "Core/ThreadPool.hpp"
 #include "Core/Zlib.hpp"
 
+#include "ReplayParser/Analyzer.hpp"
 #include "ReplayParser/GameFiles.hpp"
 #include "ReplayParser/PacketParser.hpp"
 #include "ReplayParser/Packets.hpp"
 #include "ReplayParser/ReplayParser.hpp"
 #include "ReplayParser/Result.hpp"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
+#include <future>
+#include <optional>
 #include <ranges>
 #include <span>
 #include <string>
+#include <thread>
 #include <vector>
 
 
@@ -55,35 +66,84 @@ auto operator<=>(span<T, E> lhs, R const& rhs)
 
 }  // namespace std
 
+namespace {
 
-ReplayResult<Replay> Replay::FromFile(std::string_view filePath, std::string_view gameFilePath)
+// size of the encrypted chunks that are decrypted and inflated at once, must be a multiple of the blowfish block size
+static constexpr size_t DecodeChunkSize = 64 * 1024;
+static constexpr size_t PacketHeaderSize = 3 * sizeof(uint32_t);
+// the signature, blocksCount and metaSize in front of the meta json
+static constexpr size_t ReplayHeaderSize = 3 * sizeof(uint32_t);
+// streams at least this large are decrypted up front on all cores instead of chunk by chunk, if the buffers ask for it
+// decrypting takes about 5 ms per MiB on one core, while dispatching the segments costs well below 0.1 ms
+// and the whole stream buffer about 0.5 ms per MiB, so from here on two cores already come out ahead
+static constexpr size_t ParallelDecryptSize = 256 * 1024;
+
+// separate from the pools replays are analyzed on, so waiting for the segments can never block the workers running them
+static ThreadPool& DecryptPool()
 {
-	return FromFile(filePath, gameFilePath);
+	static ThreadPool pool;
+	return pool;
 }
 
-ReplayResult<Replay> Replay::FromFile(const fs::path& filePath, const fs::path& gameFilePath)
+// Every decrypted block is xored with the previous plaintext block, so a plaintext block is the xor of all decrypted blocks up to it.
+// The segments are first decrypted in parallel as if they started the stream, then the last plaintext block
+// before each segment, the xor of the last blocks of all previous segments, is xored into every block of it.
+static void DecryptParallel(const Blowfish& blowfish, std::span<const Byte> src, std::span<Byte> dst)
 {
-	PA_PROFILE_FUNCTION();
+	ThreadPool& pool = DecryptPool();
 
-	File file = File::Open(filePath, File::Flags::Open | File::Flags::Read | File::Flags::ShareRead | File::Flags::ShareWrite);
-	if (!file)
+	const size_t blocks = src.size() / Blowfish::BlockSize();
+	const size_t segmentCount = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, std::max<size_t>(blocks, 1));
+	const size_t segmentSize = (blocks + segmentCount - 1) / segmentCount * Blowfish::BlockSize();
+
+	std::vector<std::array<Byte, 8>> last(segmentCount);
+	std::vector<std::future<void>> futures;
+	futures.reserve(segmentCount);
+	for (size_t i = 0; i < segmentCount && i * segmentSize < src.size(); i++)
 	{
-		return PA_REPLAY_ERROR("Failed to open replay file: {}", file.LastError());
+		const size_t offset = i * segmentSize;
+		const size_t size = std::min(segmentSize, src.size() - offset);
+		futures.emplace_back(pool.Enqueue([&blowfish, &last, i, segment = src.subspan(offset, size), out = dst.subspan(offset, size)]()
+		{
+			blowfish.DecryptCbcLike(segment, out, last[i]);
+		}));
 	}
-
-	const uint64_t fileSize = file.Size();
-
-	FileMapping fileMapping = FileMapping::Open(file, FileMapping::Flags::Read, fileSize);
-	if (!fileMapping)
+	for (std::future<void>& future : futures)
 	{
-		return PA_REPLAY_ERROR("Failed to map replay file: {}", fileMapping.LastError());
+		future.get();
 	}
 
-	void* mapping = fileMapping.Map(FileMapping::Flags::Read, 0, fileSize);
-	std::span<const Byte> data{ static_cast<const Byte*>(mapping), fileSize };
+	const size_t segments = futures.size();
+	futures.clear();
 
-	Replay replay;
+	uint64_t seed = 0;
+	for (size_t i = 1; i < segments; i++)
+	{
+		uint64_t previous;
+		std::memcpy(&previous, last[i - 1].data(), sizeof(previous));
+		seed ^= previous;
+
+		const size_t offset = i * segmentSize;
+		futures.emplace_back(pool.Enqueue([seed, out = dst.subspan(offset, std::min(segmentSize, src.size() - offset))]()
+		{
+			for (size_t position = 0; position < out.size(); position += Blowfish::BlockSize())
+			{
+				uint64_t block;
+				std::memcpy(&block, out.data() + position, sizeof(block));
+				block ^= seed;
+				std::memcpy(out.data() + position, &block, sizeof(block));
+			}
+		}));
+	}
+	for (std::future<void>& future : futures)
+	{
+		future.get();
+	}
+}
 
+// Validates the signature and reads the header in front of the meta json.
+static ReplayResult<void> ReadHeader(std::span<const Byte>& data, uint32_t& blocksCount, uint32_t& metaSize)
+{
 	if (data.size() < 8)
 	{
 		return PA_REPLAY_ERROR("Replay has invalid length {} < 8.", data.size());
@@ -95,125 +155,374 @@ ReplayResult<Replay> Replay::FromFile(const fs::path& filePath, const fs::path&
 		return PA_REPLAY_ERROR("Replay has invalid file signature.");
 	}
 
-	uint32_t blocksCount;
 	if (!TakeInto(data, blocksCount))
 	{
 		return PA_REPLAY_ERROR("Replay is missing blocksCount.");
 	}
 
-	uint32_t metaSize;
 	if (!TakeInto(data, metaSize))
 	{
 		return PA_REPLAY_ERROR("Replay is missing metaSize.");
 	}
 
+	return {};
+}
+
+// Adds the time since the previous lap to a stage, a single clock read separates two consecutive stages.
+class LapTimer
+{
+public:
+	explicit LapTimer(bool enabled) : m_enabled(enabled)
+	{
+		if (m_enabled)
+			m_last = StreamStats::Clock::now();
+	}
+
+	void Lap(StreamStats::Clock::duration& stage)
+	{
+		if (m_enabled)
+		{
+			const StreamStats::Clock::time_point now = StreamStats::Clock::now();
+			stage += now - m_last;
+			m_last = now;
+		}
+	}
+
+private:
+	bool m_enabled;
+	StreamStats::Clock::time_point m_last;
+};
+
+// Decrypts and inflates the replay stream chunk by chunk and hands every packet to the sink as soon as it is complete.
+// Decoding stops at the first error returned by the sink.
+// Only the current chunk and the packet spanning the chunk boundary are held in memory,
+// unless parallel decrypting is enabled, which decrypts large streams as a whole on the decrypt pool first.
+// The inflater is reset and the buffers only grow, so they can be reused for the next replay.
+template<typename Sink>
+static ReplayResult<void> DecodePackets(std::span<const Byte> data, uint32_t decompressedSize, PacketParser& parser, Version version,
+	Zlib::Inflater& inflater, std::vector<Byte>& decrypted, std::vector<Byte>& buffer, bool parallelDecrypt, StreamStats* stats, Sink&& sink)
+{
+	const Blowfish blowfish(ReplayKey);
+	std::array<Byte, 8> prev = {};
+
+	if (!inflater.Reset())
+	{
+		return PA_REPLAY_ERROR("Failed to initialize zlib inflater.");
+	}
+
+	if (decrypted.size() < DecodeChunkSize)
+	{
+		decrypted.resize(DecodeChunkSize);
+	}
+	std::span<const Byte> in;
+
+	// inflated data, packets are parsed from [begin, end) and incomplete packets wait there for the next chunk
+	if (buffer.size() < 2 * DecodeChunkSize)
+	{
+		buffer.resize(2 * DecodeChunkSize);
+	}
+	size_t begin = 0;
+	size_t end = 0;
+	size_t inflatedSize = 0;
+	const size_t encryptedSize = data.size();
+
+	StreamStats ignored;
+	StreamStats& stages = stats ? *stats : ignored;
+	LapTimer timer(stats != nullptr);
+
+	if (parallelDecrypt && data.size() >= ParallelDecryptSize && std::thread::hardware_concurrency() > 1)
+	{
+		if (decrypted.size() < data.size())
+		{
+			decrypted.resize(data.size());
+		}
+		DecryptParallel(blowfish, data, std::span{ decrypted.data(), data.size() });
+		in = std::span{ decrypted.data(), data.size() };
+		data = {};
+		timer.Lap(stages.Decrypt);
+	}
+
+	Zlib::Inflater::Status status = Zlib::Inflater::Status::Ok;
+	while (status != Zlib::Inflater::Status::StreamEnd)
+	{
+		if (in.empty() && !data.empty())
+		{
+			const std::span<const Byte> encrypted = Take(data, std::min(data.size(), DecodeChunkSize));
+			blowfish.DecryptCbcLike(encrypted, std::span{ decrypted.data(), encrypted.size() }, prev);
+			in = std::span{ decrypted.data(), encrypted.size() };
+			timer.Lap(stages.Decrypt);
+		}
+
+		if (buffer.size() - end < DecodeChunkSize)
+		{
+			std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+			end -= begin;
+			begin = 0;
+			if (buffer.size() - end < DecodeChunkSize)
+			{
+				buffer.resize(buffer.size() * 2);
+			}
+		}
+
+		const size_t inSize = in.size();
+		std::span<Byte> out{ buffer.data() + end, buffer.size() - end };
+		status = inflater.Inflate(in, out);
+		if (status == Zlib::Inflater::Status::Error)
+		{
+			return PA_REPLAY_ERROR("Failed to inflate decrypted replay data with zlib.");
+		}
+
+		const size_t produced = buffer.size() - end - out.size();
+		if (produced == 0 && in.size() == inSize && data.empty())
+		{
+			return PA_REPLAY_ERROR("Replay data ended before the end of the zlib stream.");
+		}
+		end += produced;
+		inflatedSize += produced;
+		timer.Lap(stages.Inflate);
+
+		while (end - begin >= PacketHeaderSize)
+		{
+			uint32_t packetSize;
+			std::memcpy(&packetSize, buffer.data() + begin, sizeof(packetSize));
+			if (end - begin < PacketHeaderSize + packetSize)
+			{
+				break;
+			}
+
+			std::span<const Byte> packetData{ buffer.data() + begin, PacketHeaderSize + packetSize };
+			PA_TRY(packet, ParsePacket(packetData, parser, version));
+			timer.Lap(stages.Parse);
+			PA_TRYV(sink(std::move(packet)));
+			timer.Lap(stages.Visit);
+			begin += PacketHeaderSize + packetSize;
+		}
+	}
+
+	if (inflatedSize != decompressedSize)
+	{
+		return PA_REPLAY_ERROR("Replay decompressed data != decompressedSize");
+	}
+
+	if (begin != end)
+	{
+		return PA_REPLAY_ERROR("Replay data ended inside of a packet.");
+	}
+
+	stages.Replays++;
+	stages.EncryptedBytes += encryptedSize;
+	stages.InflatedBytes += inflatedSize;
+
+	return {};
+}
+
+}  // namespace
+
+
+ReplayResult<ReplayLayout> rp::ReadLayout(std::span<const Byte> data)
+{
+	uint32_t blocksCount;
+	uint32_t metaSize;
+	PA_TRYV(ReadHeader(data, blocksCount, metaSize));
+
+	// the last block is the packet stream
+	if (blocksCount == 0)
+	{
+		return PA_REPLAY_ERROR("Replay has no blocks.");
+	}
+
 	if (data.size() < metaSize)
 	{
 		return PA_REPLAY_ERROR("Replay is missing meta info.");
 	}
-	replay.MetaString.resize(metaSize);
-	std::memcpy(replay.MetaString.data(), Take(data, metaSize).data(), metaSize);
 
-	PA_TRY_OR_ELSE(js, Core::ParseJson(replay.MetaString),
-	{
-		return PA_REPLAY_ERROR("Failed to parse replay meta as JSON: {}", error);
-	});
-	FromJson(js, replay.Meta);
+	ReplayLayout layout;
+	layout.Meta = Take(data, metaSize);
 
-	for (size_t i = 0; i < blocksCount - 1; i++)
+	for (uint32_t i = 1; i < blocksCount; i++)
 	{
 		uint32_t blockSize;
-		if (!TakeInto(data, blockSize))
+		if (!TakeInto(data, blockSize) || data.size() < blockSize)
 		{
 			return PA_REPLAY_ERROR("Replay is missing blockSize.");
 		}
-		if (blockSize > 0)
-			Take(data, blockSize);
+		Take(data, blockSize);
 	}
-	
-	uint32_t decompressedSize;
-	if (!TakeInto(data, decompressedSize))
+
+	if (!TakeInto(data, layout.DecompressedSize))
 	{
 		return PA_REPLAY_ERROR("Replay is missing decompressedSize.");
 	}
 
+	// the stream size does not always match the rest of the file, which is used instead
 	uint32_t streamSize;
 	if (!TakeInto(data, streamSize))
 	{
 		return PA_REPLAY_ERROR("Replay is missing streamSize.");
 	}
 
-	if (data.size() != streamSize)
+	if (data.size() % Blowfish::BlockSize() != 0)
 	{
-		//return PA_REPLAY_ERROR("Replay data != streamSize");
+		return PA_REPLAY_ERROR("Replay data is not a multiple of blowfish block size.");
 	}
+	layout.Stream = data;
 
-	if (data.size() % Blowfish::BlockSize() != 0)
+	return layout;
+}
+
+ReplayResult<std::string> rp::ReadMetaString(const fs::path& filePath)
+{
+	File file = File::Open(filePath, File::Flags::Open | File::Flags::Read | File::Flags::ShareRead | File::Flags::ShareWrite);
+	if (!file)
 	{
-		return PA_REPLAY_ERROR("Replay data is not a multiple of blowfish block size.");
+		return PA_REPLAY_ERROR("Failed to open replay file: {}", file.LastError());
+	}
+
+	const uint64_t fileSize = file.Size();
+
+	std::vector<Byte> header;
+	if (!file.Read(header, std::min<uint64_t>(fileSize, ReplayHeaderSize)))
+	{
+		return PA_REPLAY_ERROR("Failed to read replay header: {}", file.LastError());
+	}
+
+	std::span<const Byte> data = header;
+	uint32_t blocksCount;
+	uint32_t metaSize;
+	PA_TRYV(ReadHeader(data, blocksCount, metaSize));
+
+	if (fileSize - ReplayHeaderSize < metaSize)
+	{
+		return PA_REPLAY_ERROR("Replay is missing meta info.");
 	}
 
-	std::vector<Byte> decrypted{};
-	decrypted.resize(data.size(), Byte{ 0 });
+	std::string metaString;
+	if (!file.ReadAllString(metaString, metaSize, false))
+	{
+		return PA_REPLAY_ERROR("Failed to read replay meta: {}", file.LastError());
+	}
+	return metaString;
+}
 
-	constexpr std::array<Byte, 16> key = { 0x29, 0xB7, 0xC9, 0x09, 0x38, 0x3F, 0x84, 0x88, 0xFA, 0x98, 0xEC, 0x4E, 0x13, 0x19, 0x79, 0xFB };
-	const Blowfish blowfish(key);
+ReplayResult<ReplayMeta> ReplayMeta::ReadFromFile(const fs::path& filePath)
+{
+	PA_TRY(metaString, ReadMetaString(filePath));
 
-	Byte prev[8] = { Byte{ 0 } };
-	for (size_t i = 0; i < data.size() / Blowfish::BlockSize(); i++)
+	PA_TRY_OR_ELSE(js, Core::ParseJson(metaString),
 	{
-		const size_t offset = i * Blowfish::BlockSize();
+		return PA_REPLAY_ERROR("Failed to parse replay meta as JSON: {}", error);
+	});
 
-		uint32_t block[2];
-		std::memcpy(block, data.data() + offset, sizeof(block));
+	ReplayMeta meta;
+	PA_TRYV_OR_ELSE(FromJson(js, meta),
+	{
+		return PA_REPLAY_ERROR("Failed to read replay meta from JSON: {}", error);
+	});
+	return meta;
+}
 
-		Blowfish::ReverseByteOrder(block[0]);
-		Blowfish::ReverseByteOrder(block[1]);
-		blowfish.DecryptBlock(&block[0], &block[1]);
-		Blowfish::ReverseByteOrder(block[0]);
-		Blowfish::ReverseByteOrder(block[1]);
+ReplayResult<Replay> Replay::FromFile(std::string_view filePath, std::string_view gameFilePath)
+{
+	return Parse(fs::path(filePath), fs::path(gameFilePath), nullptr, std::nullopt, nullptr);
+}
 
-		std::memcpy(decrypted.data() + offset, block, sizeof(block));
+ReplayResult<Replay> Replay::FromFile(const fs::path& filePath, const fs::path& gameFilePath)
+{
+	return Parse(filePath, gameFilePath, nullptr, std::nullopt, nullptr);
+}
 
-		for (size_t j = 0; j < Blowfish::BlockSize(); j++)
-		{
-			decrypted[offset + j] = decrypted[offset + j] ^ prev[j];
-			prev[j] = decrypted[offset + j];
-		}
+ReplayResult<Replay> Replay::Stream(const fs::path& filePath, const fs::path& gameFilePath, const PacketVisitor& visitor, std::optional<PacketInterest> interest)
+{
+	return Parse(filePath, gameFilePath, &visitor, std::move(interest), nullptr);
+}
+
+ReplayResult<Replay> Replay::Stream(const fs::path& filePath, const fs::path& gameFilePath, StreamBuffers& buffers, const PacketVisitor& visitor,
+	std::optional<PacketInterest> interest)
+{
+	return Parse(filePath, gameFilePath, &visitor, std::move(interest), &buffers);
+}
+
+ReplayResult<Replay> Replay::Parse(const fs::path& filePath, const fs::path& gameFilePath, const PacketVisitor* visitor, std::optional<PacketInterest> interest,
+	StreamBuffers* buffers)
+{
+	PA_PROFILE_FUNCTION();
+
+	File file = File::Open(filePath, File::Flags::Open | File::Flags::Read | File::Flags::ShareRead | File::Flags::ShareWrite);
+	if (!file)
+	{
+		return PA_REPLAY_ERROR("Failed to open replay file: {}", file.LastError());
 	}
 
-	fileMapping.Close();
-	file.Close();
+	const uint64_t fileSize = file.Size();
 
-	const std::vector<Byte> decompressed = Zlib::Inflate(decrypted);
-	if (decompressed.empty())
+	FileMapping fileMapping = FileMapping::Open(file, FileMapping::Flags::Read, fileSize);
+	if (!fileMapping)
 	{
-		return PA_REPLAY_ERROR("Failed to inflate decrypted replay data with zlib.");
+		return PA_REPLAY_ERROR("Failed to map replay file: {}", fileMapping.LastError());
 	}
 
-	if (decompressed.size() != decompressedSize)
+	void* mapping = fileMapping.Map(FileMapping::Flags::Read, 0, fileSize);
+	if (!mapping)
 	{
-		return PA_REPLAY_ERROR("Replay decompressed data != decompressedSize");
+		return PA_REPLAY_ERROR("Failed to map view of replay file: {}", FileMapping::LastError());
 	}
+	auto unmap = MakeDefer([&fileMapping, mapping, fileSize]()
+	{
+		fileMapping.Unmap(mapping, fileSize);
+	});
+	std::span<const Byte> data{ static_cast<const Byte*>(mapping), fileSize };
 
-	// free memory of decrypted data
-	decrypted.clear();
-	decrypted.shrink_to_fit();
+	Replay replay;
 
-	replay.Specs = ParseScripts(replay.Meta.ClientVersionFromExe, gameFilePath);
+	PA_TRY(layout, ReadLayout(data));
+	replay.MetaString.assign(reinterpret_cast<const char*>(layout.Meta.data()), layout.Meta.size());
 
-	if (replay.Specs.empty())
+	PA_TRY_OR_ELSE(js, Core::ParseJson(replay.MetaString),
+	{
+		return PA_REPLAY_ERROR("Failed to parse replay meta as JSON: {}", error);
+	});
+	FromJson(js, replay.Meta);
+
+	replay.Specs = GetEntitySpecs(replay.Meta.ClientVersionFromExe, gameFilePath);
+
+	if (!replay.Specs || replay.Specs->empty())
 	{
 		return PA_REPLAY_ERROR("Empty entity specs");
 	}
 
+	// packets that are only visited are destroyed right away, so their memory is reused instead of piling up
+	if (visitor && !buffers)
+	{
+		replay.m_arena = ArgArena::Pooled();
+	}
 	replay.m_packetParser.Specs = replay.Specs;
+	replay.m_packetParser.Memory = buffers ? &buffers->Memory : replay.m_arena.Get();
+	if (interest)
+	{
+		SetPacketInterest(replay.m_packetParser, std::move(interest.value()));
+	}
 
-	std::span out{ decompressed };
-	do {
-		PA_TRY(packet, ParsePacket(out, replay.m_packetParser, replay.Meta.ClientVersionFromExe));
+	std::optional<Zlib::Inflater> inflater;
+	std::vector<Byte> decrypted;
+	std::vector<Byte> inflated;
+
+	const ReplayResult<void> decoded = DecodePackets(layout.Stream, layout.DecompressedSize, replay.m_packetParser, replay.Meta.ClientVersionFromExe,
+		buffers ? buffers->Inflater : inflater.emplace(),
+		buffers ? buffers->Decrypted : decrypted,
+		buffers ? buffers->Inflated : inflated,
+		buffers && buffers->ParallelDecrypt,
+		buffers && buffers->Stats ? &buffers->Stats.value() : nullptr,
+		[&replay, visitor](PacketType&& packet) -> ReplayResult<void>
+	{
+		if (visitor)
+		{
+			return (*visitor)(replay, packet);
+		}
 		replay.Packets.emplace_back(std::move(packet));
-	} while (!out.empty());
+		return {};
+	});
+
+	PA_TRYV(decoded);
 
 	// sort the packets by game time
 	// std::ranges::sort(replay.Packets, [](const PacketType& a, const PacketType& b)
@@ -228,12 +537,28 @@ ReplayResult<Replay> Replay::FromFile(const fs::path& filePath, const fs::path&
 
 ReplayResult<ReplaySummary> rp::AnalyzeReplay(const fs::path& file, const fs::path& gameFilePath)
 {
-	PA_TRY(replay, Replay::FromFile(file, gameFilePath));
-	PA_TRY(summary, replay.Analyze());
+	StreamBuffers buffers;
+	return AnalyzeReplay(file, gameFilePath, buffers);
+}
+
+ReplayResult<ReplaySummary> rp::AnalyzeReplay(const fs::path& file, const fs::path& gameFilePath, StreamBuffers& buffers)
+{
+	Analyzer analyzer;
+	PA_TRY(replay, Replay::Stream(file, gameFilePath, buffers, [&analyzer](const Replay& replay, const PacketType& packet) -> ReplayResult<void>
+	{
+		return analyzer.OnPacket(replay, packet);
+	}, Analyzer::Interest()));
+
+	LapTimer timer(buffers.Stats.has_value());
+	ReplayResult<ReplaySummary> summary = analyzer.Finish(replay);
+	if (buffers.Stats)
+	{
+		timer.Lap(buffers.Stats->Visit);
+	}
 	return summary;
 }
 
 bool rp::HasGameScripts(Version gameVersion, const fs::path& gameFilePath)
 {
-	return !ParseScripts(gameVersion, gameFilePath).empty();
+	return GetEntitySpecs(gameVersion, gameFilePath) != nullptr;
 }
@@ -0,0 +1,297 @@
+// Copyright 2024 <github.com/razaqq>
+
+#include "Core/Bytes.hpp"
+#include "Core/File.hpp"
+#include "Core/Log.hpp"
+
+#include "ReplayParser/Analyzer.hpp"
+#include "ReplayParser/SummaryCache.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+namespace fs = std::filesystem;
+
+using PotatoAlert::Core::Byte;
+using PotatoAlert::Core::File;
+using PotatoAlert::Core::ReadString;
+using PotatoAlert::Core::TakeInto;
+using PotatoAlert::Core::Write;
+using PotatoAlert::Core::WriteString;
+using PotatoAlert::ReplayParser::AchievementType;
+using PotatoAlert::ReplayParser::Analyzer;
+using PotatoAlert::ReplayParser::MatchOutcome;
+using PotatoAlert::ReplayParser::ReplaySummary;
+using PotatoAlert::ReplayParser::RibbonType;
+using PotatoAlert::ReplayParser::SummaryCache;
+
+namespace {
+
+static constexpr uint32_t SummaryCacheMagic = 0x53524150;  // "PARS"
+static constexpr uint32_t SummaryCacheVersion = 1;
+
+static void WriteSummary(std::vector<Byte>& out, const ReplaySummary& summary)
+{
+	WriteString(out, summary.Hash);
+	Write<int32_t>(out, static_cast<int32_t>(summary.Outcome));
+	Write<float>(out, summary.DamageDealt);
+	Write<float>(out, summary.DamageTaken);
+	Write<float>(out, summary.DamageSpotting);
+	Write<float>(out, summary.DamagePotential);
+
+	Write<uint32_t>(out, static_cast<uint32_t>(summary.Achievements.size()));
+	for (const auto& [type, count] : summary.Achievements)
+	{
+		Write<uint32_t>(out, static_cast<uint32_t>(type));
+		Write<uint32_t>(out, count);
+	}
+
+	Write<uint32_t>(out, static_cast<uint32_t>(summary.Ribbons.size()));
+	for (const auto& [type, count] : summary.Ribbons)
+	{
+		Write<int8_t>(out, static_cast<int8_t>(type));
+		Write<uint32_t>(out, count);
+	}
+}
+
+static bool ReadSummary(std::span<const Byte>& data, ReplaySummary& summary)
+{
+	int32_t outcome;
+	if (!ReadString(data, summary.Hash) || !TakeInto(data, outcome) || !TakeInto(data, summary.DamageDealt) || !TakeInto(data, summary.DamageTaken) ||
+		!TakeInto(data, summary.DamageSpotting) || !TakeInto(data, summary.DamagePotential))
+		return false;
+	summary.Outcome = static_cast<MatchOutcome>(outcome);
+
+	uint32_t achievementCount;
+	if (!TakeInto(data, achievementCount))
+		return false;
+	for (uint32_t i = 0; i < achievementCount; i++)
+	{
+		uint32_t type, count;
+		if (!TakeInto(data, type) || !TakeInto(data, count))
+			return false;
+		summary.Achievements.emplace(static_cast<AchievementType>(type), count);
+	}
+
+	uint32_t ribbonCount;
+	if (!TakeInto(data, ribbonCount))
+		return false;
+	for (uint32_t i = 0; i < ribbonCount; i++)
+	{
+		int8_t type;
+		uint32_t count;
+		if (!TakeInto(data, type) || !TakeInto(data, count))
+			return false;
+		summary.Ribbons.emplace(static_cast<RibbonType>(type), count);
+	}
+
+	return true;
+}
+
+// the size and last write time of the file, or nothing if it does not exist
+static std::optional<std::pair<uint64_t, int64_t>> Stat(const fs::path& file)
+{
+	std::error_code ec;
+	const uint64_t size = fs::file_size(file, ec);
+	if (ec)
+		return {};
+	const fs::file_time_type time = fs::last_write_time(file, ec);
+	if (ec)
+		return {};
+	return std::make_pair(size, static_cast<int64_t>(time.time_since_epoch().count()));
+}
+
+}  // namespace
+
+SummaryCache::SummaryCache(fs::path path) : m_path(std::move(path))
+{
+	Load();
+}
+
+std::optional<ReplaySummary> SummaryCache::Find(const fs::path& file) const
+{
+	const std::optional<std::pair<uint64_t, int64_t>> stat = Stat(file);
+	if (!stat)
+		return {};
+
+	std::unique_lock lock(m_mutex);
+	if (auto entry = m_entries.find(file.generic_string()); entry != m_entries.end())
+	{
+		if (entry->second.Size == stat->first && entry->second.Time == stat->second)
+			return entry->second.Summary;
+	}
+	return {};
+}
+
+std::optional<ReplaySummary> SummaryCache::Find(const fs::path& file, std::string_view hash) const
+{
+	const std::optional<std::pair<uint64_t, int64_t>> stat = Stat(file);
+	if (!stat)
+		return {};
+
+	std::unique_lock lock(m_mutex);
+	if (auto entry = m_entries.find(file.generic_string()); entry != m_entries.end())
+	{
+		if (entry->second.Size == stat->first && entry->second.Time == stat->second)
+			return entry->second.Summary;
+	}
+
+	if (auto path = m_hashes.find(std::string(hash)); path != m_hashes.end())
+	{
+		const Entry& entry = m_entries.at(path->second);
+		if (entry.Size == stat->first)
+			return entry.Summary;
+	}
+	return {};
+}
+
+void SummaryCache::Insert(const fs::path& file, const ReplaySummary& summary)
+{
+	const std::optional<std::pair<uint64_t, int64_t>> stat = Stat(file);
+	if (!stat)
+		return;
+
+	std::string path = file.generic_string();
+
+	std::unique_lock lock(m_mutex);
+	if (auto entry = m_entries.find(path); entry != m_entries.end())
+	{
+		// the replay was overwritten by another match
+		if (auto previous = m_hashes.find(entry->second.Summary.Hash); previous != m_hashes.end() && previous->second == path)
+		{
+			m_hashes.erase(previous);
+		}
+	}
+	m_hashes.insert_or_assign(summary.Hash, path);
+	m_entries.insert_or_assign(std::move(path), Entry{ stat->first, stat->second, summary });
+	m_insertCount++;
+	m_dirty = true;
+}
+
+size_t SummaryCache::Size() const
+{
+	std::unique_lock lock(m_mutex);
+	return m_entries.size();
+}
+
+void SummaryCache::Load()
+{
+	std::vector<Byte> bytes;
+	if (const File file = File::Open(m_path, File::Flags::Open | File::Flags::Read))
+	{
+		if (!file.ReadAll(bytes))
+			return;
+	}
+	else
+	{
+		return;
+	}
+
+	std::span<const Byte> data = bytes;
+	uint32_t magic, formatVersion, summaryVersion, count;
+	if (!TakeInto(data, magic) || !TakeInto(data, formatVersion) || !TakeInto(data, summaryVersion) || !TakeInto(data, count))
+		return;
+
+	if (magic != SummaryCacheMagic || formatVersion != SummaryCacheVersion || summaryVersion != Analyzer::SummaryVersion)
+		return;
+
+	std::unordered_map<std::string, Entry> entries;
+	entries.reserve(count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		std::string path;
+		Entry entry;
+		if (!ReadString(data, path) || !TakeInto(data, entry.Size) || !TakeInto(data, entry.Time) || !ReadSummary(data, entry.Summary))
+			return;
+		entries.insert_or_assign(std::move(path), std::move(entry));
+	}
+
+	if (!data.empty())
+		return;
+
+	std::unique_lock lock(m_mutex);
+	m_entries = std::move(entries);
+	RebuildHashes();
+}
+
+void SummaryCache::RebuildHashes()
+{
+	m_hashes.clear();
+	for (const auto& [path, entry] : m_entries)
+	{
+		m_hashes.insert_or_assign(entry.Summary.Hash, path);
+	}
+}
+
+void SummaryCache::Save()
+{
+	std::unique_lock saveLock(m_saveMutex);
+
+	std::unordered_map<std::string, Entry> entries;
+	uint64_t insertCount;
+	{
+		std::unique_lock lock(m_mutex);
+		if (!m_dirty)
+			return;
+		entries = m_entries;
+		insertCount = m_insertCount;
+	}
+
+	// replays that were deleted since they were analyzed are dropped, so the cache does not grow forever
+	std::vector<std::string> removed;
+	std::erase_if(entries, [&removed](const auto& entry)
+	{
+		std::error_code ec;
+		if (!fs::exists(fs::path(entry.first), ec) && !ec)
+		{
+			removed.emplace_back(entry.first);
+			return true;
+		}
+		return false;
+	});
+
+	std::vector<Byte> data;
+	Write<uint32_t>(data, SummaryCacheMagic);
+	Write<uint32_t>(data, SummaryCacheVersion);
+	Write<uint32_t>(data, Analyzer::SummaryVersion);
+	Write<uint32_t>(data, static_cast<uint32_t>(entries.size()));
+	for (const auto& [path, entry] : entries)
+	{
+		WriteString(data, path);
+		Write<uint64_t>(data, entry.Size);
+		Write<int64_t>(data, entry.Time);
+		WriteSummary(data, entry.Summary);
+	}
+
+	if (!File::WriteAtomic(m_path, data))
+	{
+		LOG_WARN(STR("Failed to write replay summary cache {} - {}"), m_path, StringWrap(File::LastError()));
+		return;
+	}
+
+	std::unique_lock lock(m_mutex);
+	// an insert in the meantime is not in the file, so the cache stays dirty and the next save drops the deleted replays
+	if (m_insertCount != insertCount)
+		return;
+
+	for (const std::string& path : removed)
+	{
+		m_entries.erase(path);
+	}
+	// the hashes must not point to dropped entries, but to a copy of the replay if there still is one
+	if (!removed.empty())
+	{
+		RebuildHashes();
+	}
+	m_dirty = false;
+}
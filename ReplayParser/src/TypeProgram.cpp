@@ -0,0 +1,364 @@
+// Copyright 2024 <github.com/razaqq>
+
+#include "Core/Bytes.hpp"
+#include "Core/Log.hpp"
+
+#include "ReplayParser/TypeProgram.hpp"
+#include "ReplayParser/Types.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+
+namespace rp = PotatoAlert::ReplayParser;
+using namespace PotatoAlert::ReplayParser;
+using PotatoAlert::Core::Byte;
+using PotatoAlert::Core::Take;
+using PotatoAlert::Core::TakeInto;
+
+namespace {
+
+static size_t AddSize(size_t a, size_t b)
+{
+	if (a == Infinity || b == Infinity)
+		return Infinity;
+	return a + b;
+}
+
+static void Compile(const ArgType* type, std::vector<TypeInstruction>& instructions)
+{
+	const size_t index = instructions.size();
+	instructions.emplace_back();
+
+	// a missing sub type takes no bytes, just like in ParseValue
+	if (type == nullptr)
+	{
+		instructions[index].Size = 0;
+		instructions[index].End = static_cast<uint32_t>(instructions.size());
+		return;
+	}
+
+	std::visit([index, &instructions](auto&& t)
+	{
+		using T = std::decay_t<decltype(t)>;
+		if constexpr (std::is_same_v<T, PrimitiveType>)
+		{
+			instructions[index].Op = TypeOp::Primitive;
+			instructions[index].Primitive = t.Type;
+			instructions[index].Size = PrimitiveSize(t.Type);
+		}
+		else if constexpr (std::is_same_v<T, ArrayType>)
+		{
+			Compile(t.SubType.get(), instructions);
+			const size_t elementSize = instructions[index + 1].Size;
+
+			TypeInstruction& instruction = instructions[index];
+			instruction.Op = TypeOp::Array;
+			if (t.Size)
+			{
+				// the count is decoded as uint8_t, just like the length prefix of arrays without a fixed size
+				instruction.FixedCount = true;
+				instruction.Count = static_cast<uint8_t>(t.Size.value());
+				instruction.Size = instruction.Count == 0 ? 0 : (elementSize == Infinity ? Infinity : elementSize * instruction.Count);
+			}
+		}
+		else if constexpr (std::is_same_v<T, FixedDictType>)
+		{
+			size_t size = 0;
+			for (const FixedDictProperty& property : t.Properties)
+			{
+				const size_t child = instructions.size();
+				Compile(property.Type.get(), instructions);
+				size = AddSize(size, instructions[child].Size);
+			}
+
+			TypeInstruction& instruction = instructions[index];
+			instruction.Op = TypeOp::FixedDict;
+			instruction.AllowNone = t.AllowNone;
+			instruction.Dict = &t;
+			instruction.Size = t.AllowNone ? Infinity : size;
+		}
+		else if constexpr (std::is_same_v<T, UserType>)
+		{
+			Compile(t.Type.get(), instructions);
+			const TypeInstruction& child = instructions[index + 1];
+			const bool takesByte = !(child.Op == TypeOp::Primitive && child.Primitive == BasicType::Blob);
+			const size_t size = AddSize(child.Size, takesByte ? 1 : 0);
+
+			TypeInstruction& instruction = instructions[index];
+			instruction.Op = TypeOp::UserType;
+			instruction.TakesByte = takesByte;
+			instruction.Size = size;
+		}
+		else if constexpr (std::is_same_v<T, TupleType>)
+		{
+			// tuples are not parsed, so they take no bytes
+			instructions[index].Op = TypeOp::Tuple;
+			instructions[index].Size = 0;
+		}
+		else if constexpr (std::is_same_v<T, UnknownType>)
+		{
+			instructions[index].Size = 0;
+		}
+	}, *type);
+
+	instructions[index].End = static_cast<uint32_t>(instructions.size());
+}
+
+static bool SkipVariablePrimitive(std::span<const Byte>& data)
+{
+	uint8_t size;
+	if (!TakeInto(data, size))
+	{
+		return false;
+	}
+
+	size_t length = size;
+	if (size == std::numeric_limits<uint8_t>::max())
+	{
+		uint16_t longSize;
+		if (!TakeInto(data, longSize))
+		{
+			return false;
+		}
+		bool unknown;
+		if (!TakeInto(data, unknown))
+		{
+			return false;
+		}
+		length = longSize;
+	}
+
+	if (data.size() < length)
+	{
+		return false;
+	}
+	Take(data, length);
+	return true;
+}
+
+static std::optional<ArgValue> Decode(const TypeProgram& program, size_t index, std::span<const Byte>& data, std::pmr::memory_resource* memory)
+{
+	const TypeInstruction& instruction = program.Instructions[index];
+	switch (instruction.Op)
+	{
+		case TypeOp::Primitive:
+		{
+			return ParsePrimitive(instruction.Primitive, data, memory);
+		}
+		case TypeOp::Array:
+		{
+			uint8_t size = instruction.Count;
+			if (!instruction.FixedCount && !TakeInto(data, size))
+			{
+				return std::nullopt;
+			}
+
+			ArgArray values(memory);
+			values.reserve(size);
+			for (size_t i = 0; i < size; i++)
+			{
+				std::optional<ArgValue> value = Decode(program, index + 1, data, memory);
+				if (!value)
+				{
+					return std::nullopt;
+				}
+				values.emplace_back(std::move(value.value()));
+			}
+			return values;
+		}
+		case TypeOp::FixedDict:
+		{
+			ArgDict dict{ instruction.Dict, ArgArray(memory) };
+			if (instruction.AllowNone)
+			{
+				uint8_t flag;
+				if (!TakeInto(data, flag))
+				{
+					return std::nullopt;
+				}
+
+				if (flag == 0)
+				{
+					return dict;
+				}
+				if (flag != 1)
+				{
+					return std::nullopt;  // Unknown fixed dict flag
+				}
+			}
+
+			dict.Values.reserve(instruction.Dict->Properties.size());
+			for (size_t child = index + 1; child < instruction.End; child = program.Instructions[child].End)
+			{
+				std::optional<ArgValue> value = Decode(program, child, data, memory);
+				if (!value)
+				{
+					return std::nullopt;
+				}
+				dict.Values.emplace_back(std::move(value.value()));
+			}
+			return dict;
+		}
+		case TypeOp::UserType:
+		{
+			if (instruction.TakesByte)
+			{
+				if (data.empty())
+				{
+					return std::nullopt;
+				}
+				Take(data, 1);
+			}
+			return Decode(program, index + 1, data, memory);
+		}
+		case TypeOp::Tuple:
+		{
+			// TODO: parse this
+			LOG_ERROR("TupleType encountered in DecodeValue");
+			return ArgValue{};
+		}
+		case TypeOp::Unknown:
+			break;
+	}
+	return ArgValue{};
+}
+
+static bool Skip(const TypeProgram& program, size_t index, std::span<const Byte>& data)
+{
+	const TypeInstruction& instruction = program.Instructions[index];
+	if (instruction.Size != Infinity)
+	{
+		if (data.size() < instruction.Size)
+		{
+			return false;
+		}
+		Take(data, instruction.Size);
+		return true;
+	}
+
+	// every value of a variable size takes at least one byte
+	if (data.empty())
+	{
+		return false;
+	}
+
+	switch (instruction.Op)
+	{
+		case TypeOp::Primitive:
+		{
+			return SkipVariablePrimitive(data);
+		}
+		case TypeOp::Array:
+		{
+			uint8_t size = instruction.Count;
+			if (!instruction.FixedCount && !TakeInto(data, size))
+			{
+				return false;
+			}
+
+			for (size_t i = 0; i < size; i++)
+			{
+				if (!Skip(program, index + 1, data))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+		case TypeOp::FixedDict:
+		{
+			if (instruction.AllowNone)
+			{
+				uint8_t flag;
+				if (!TakeInto(data, flag) || flag > 1)
+				{
+					return false;
+				}
+				if (flag == 0)
+				{
+					return true;
+				}
+			}
+
+			for (size_t child = index + 1; child < instruction.End; child = program.Instructions[child].End)
+			{
+				if (!Skip(program, child, data))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+		case TypeOp::UserType:
+		{
+			if (instruction.TakesByte)
+			{
+				if (data.empty())
+				{
+					return false;
+				}
+				Take(data, 1);
+			}
+			return Skip(program, index + 1, data);
+		}
+		case TypeOp::Tuple:
+		case TypeOp::Unknown:
+			return true;
+	}
+	return true;
+}
+
+}  // namespace
+
+TypeProgram rp::CompileType(const ArgType& type)
+{
+	return CompileTypes(std::span(&type, 1));
+}
+
+TypeProgram rp::CompileTypes(std::span<const ArgType> types)
+{
+	TypeProgram program;
+	for (const ArgType& type : types)
+	{
+		const size_t index = program.Instructions.size();
+		Compile(&type, program.Instructions);
+		program.Size = AddSize(program.Size, program.Instructions[index].Size);
+	}
+	return program;
+}
+
+std::optional<ArgValue> rp::DecodeValue(const TypeProgram& program, std::span<const Byte>& data, std::pmr::memory_resource* memory)
+{
+	if (program.Instructions.empty()) return ArgValue{};
+
+	return Decode(program, 0, data, memory);
+}
+
+bool rp::DecodeValues(const TypeProgram& program, std::span<const Byte>& data, std::pmr::memory_resource* memory, std::vector<ArgValue>& values)
+{
+	for (size_t index = 0; index < program.Instructions.size(); index = program.Instructions[index].End)
+	{
+		std::optional<ArgValue> value = Decode(program, index, data, memory);
+		if (!value)
+		{
+			return false;
+		}
+		values.emplace_back(std::move(value.value()));
+	}
+	return true;
+}
+
+bool rp::SkipValue(const TypeProgram& program, std::span<const Byte>& data)
+{
+	if (program.Instructions.empty()) return true;
+
+	return Skip(program, 0, data);
+}
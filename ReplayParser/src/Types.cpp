@@ -8,12 +8,16 @@
 
 #include "ReplayParser/Types.hpp"
 
+#include <cassert>
 #include <memory>
+#include <memory_resource>
 #include <optional>
 #include <span>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <variant>
 
 
@@ -23,7 +27,6 @@ using namespace ReplayParser;
 using Core::Byte;
 using Core::Take;
 using Core::TakeInto;
-using Core::TakeString;
 
 ArgType rp::ParseType(XMLElement* elem, const AliasType& aliases)
 {
@@ -198,9 +201,9 @@ size_t rp::TypeSize(const ArgType& type)
 	}, type);
 }
 
-static ArgValue ParsePrimitive(PrimitiveType type, std::span<const Byte>& data)
+std::optional<ArgValue> rp::ParsePrimitive(BasicType type, std::span<const Byte>& data, std::pmr::memory_resource* memory)
 {
-	switch (type.Type)
+	switch (type)
 	{
 		case BasicType::Uint8:
 		{
@@ -319,10 +322,11 @@ static ArgValue ParsePrimitive(PrimitiveType type, std::span<const Byte>& data)
 				break;
 			}
 
+			size_t stringSize = size;
 			if (size == std::numeric_limits<uint8_t>::max())
 			{
-				uint16_t stringSize;
-				if (!TakeInto(data, stringSize))
+				uint16_t longSize;
+				if (!TakeInto(data, longSize))
 				{
 					break;
 				}
@@ -331,19 +335,13 @@ static ArgValue ParsePrimitive(PrimitiveType type, std::span<const Byte>& data)
 				{
 					break;
 				}
-				std::string str;
-				if (TakeString(data, str, stringSize))
-				{
-					return str;
-				}
+				stringSize = longSize;
 			}
-			else
+
+			if (data.size() >= stringSize)
 			{
-				std::string str;
-				if (TakeString(data, str, size))
-				{
-					return str;
-				}
+				auto s = Take(data, stringSize);
+				return ArgString(reinterpret_cast<const char*>(s.data()), s.size(), memory);
 			}
 			break;
 		}
@@ -371,7 +369,7 @@ static ArgValue ParsePrimitive(PrimitiveType type, std::span<const Byte>& data)
 				if (data.size() >= blobSize)
 				{
 					auto s = Take(data, blobSize);
-					return std::vector<Byte>{ s.begin(), s.end() };
+					return ArgBlob(s.begin(), s.end(), memory);
 				}
 			}
 			else
@@ -379,15 +377,15 @@ static ArgValue ParsePrimitive(PrimitiveType type, std::span<const Byte>& data)
 				if (data.size() >= size)
 				{
 					auto s = Take(data, size);
-					return std::vector<Byte>{ s.begin(), s.end() };
+					return ArgBlob(s.begin(), s.end(), memory);
 				}
 			}
 			break;
 		}
 	}
 
-	LOG_ERROR("Failed to parse ArgValue into PrimitiveType {}, only had {} bytes ({})", ToSting(type.Type), data.size(), Core::FormatBytes(data));
-	return {};
+	// the caller reports the value it was parsing
+	return std::nullopt;
 }
 
 #ifndef NDEBUG
@@ -445,47 +443,59 @@ std::string rp::PrintType(const ArgType& type)
 }
 #endif
 
-ArgValue rp::ParseValue(std::span<const Byte>& data, const ArgType& type)
+// a missing sub type takes no bytes, just like in a TypeProgram
+static std::optional<ArgValue> ParseSubValue(std::span<const Byte>& data, const ArgType* type, std::pmr::memory_resource* memory)
 {
-	if (data.empty()) return {};
+	if (type == nullptr)
+		return ArgValue{};
+	return ParseValue(data, *type, memory);
+}
 
-	return std::visit([&data](auto&& t) -> ArgValue
+std::optional<ArgValue> rp::ParseValue(std::span<const Byte>& data, const ArgType& type, std::pmr::memory_resource* memory)
+{
+	return std::visit([&data, memory](auto&& t) -> std::optional<ArgValue>
 	{
 		using T = std::decay_t<decltype(t)>;
 		if constexpr (std::is_same_v<T, PrimitiveType>)
 		{
-			return ParsePrimitive(t, data);
+			return ParsePrimitive(t.Type, data, memory);
 		}
 		else if constexpr (std::is_same_v<T, ArrayType>)
 		{
-			std::vector<ArgValue> values;
+			ArgArray values(memory);
 			uint8_t size = 0;
 			if (!t.Size)
 			{
 				if (!TakeInto(data, size))
 				{
-					return {};
+					return std::nullopt;
 				}
 			}
 			else
 			{
 				size = t.Size.value();
 			}
+			values.reserve(size);
 			for (size_t i = 0; i < size; i++)
 			{
-				values.emplace_back(ParseValue(data, *t.SubType));
+				std::optional<ArgValue> value = ParseSubValue(data, t.SubType.get(), memory);
+				if (!value)
+				{
+					return std::nullopt;
+				}
+				values.emplace_back(std::move(value.value()));
 			}
 			return values;
 		}
 		else if constexpr (std::is_same_v<T, FixedDictType>)
 		{
- 			std::unordered_map<std::string, ArgValue> dict;
+			ArgDict dict{ &t, ArgArray(memory) };
 			if (t.AllowNone)
 			{
 				uint8_t flag;
 				if (!TakeInto(data, flag))
 				{
-					return {};
+					return std::nullopt;
 				}
 
 				if (flag == 0)
@@ -494,13 +504,19 @@ ArgValue rp::ParseValue(std::span<const Byte>& data, const ArgType& type)
 				}
 				if (flag != 1)
 				{
-					return {};  // Unknown fixed dict flag
+					return std::nullopt;  // Unknown fixed dict flag
 				}
 			}
 
+			dict.Values.reserve(t.Properties.size());
 			for (const FixedDictProperty& property : t.Properties)
 			{
-				dict.emplace(property.Name, ParseValue(data, *property.Type));
+				std::optional<ArgValue> value = ParseSubValue(data, property.Type.get(), memory);
+				if (!value)
+				{
+					return std::nullopt;
+				}
+				dict.Values.emplace_back(std::move(value.value()));
 			}
 
 			return dict;
@@ -509,27 +525,31 @@ ArgValue rp::ParseValue(std::span<const Byte>& data, const ArgType& type)
 		{
 			// TODO: parse this
 			LOG_ERROR("TupleType encountered in ParseValue");
-			return {};
+			return ArgValue{};
 		}
 		else if constexpr (std::is_same_v<T, UserType>)
 		{
-			if (const PrimitiveType* prim = std::get_if<PrimitiveType>(&*t.Type))
+			if (const PrimitiveType* prim = std::get_if<PrimitiveType>(t.Type.get()))
 			{
 				if (prim->Type == BasicType::Blob)
 				{
-					return ParseValue(data, *t.Type);
+					return ParseSubValue(data, t.Type.get(), memory);
 				}
 			}
+			if (data.empty())
+			{
+				return std::nullopt;
+			}
 			Take(data, 1);
-			return ParseValue(data, *t.Type);
+			return ParseSubValue(data, t.Type.get(), memory);
 		}
-		return {};
+		return ArgValue{};
 	}, type);
 }
 
-ArgValue rp::GetDefaultValue(const ArgType& type)
+ArgValue rp::GetDefaultValue(const ArgType& type, std::pmr::memory_resource* memory)
 {
-	return std::visit([](auto&& t) -> ArgValue
+	return std::visit([memory](auto&& t) -> ArgValue
 	{
 		using T = std::decay_t<decltype(t)>;
 		if constexpr (std::is_same_v<T, PrimitiveType>)
@@ -561,20 +581,20 @@ ArgValue rp::GetDefaultValue(const ArgType& type)
 				case BasicType::Vector3:
 					return Vec3{ 0, 0, 0 };
 				case BasicType::String:
-					return std::string("");
+					return ArgString(memory);
 				case BasicType::UnicodeString:
-					return std::string("");
+					return ArgString(memory);
 				case BasicType::Blob:
-					return std::vector<Byte>{};
+					return ArgBlob(memory);
 			}
 		}
 		else if constexpr (std::is_same_v<T, ArrayType>)
 		{
-			return std::vector<ArgValue>{};
+			return ArgArray(memory);
 		}
 		else if constexpr (std::is_same_v<T, FixedDictType>)
 		{
-			return std::unordered_map<std::string, ArgValue>{};
+			return ArgDict{ &t, ArgArray(memory) };
 		}
 		else if constexpr (std::is_same_v<T, TupleType>)
 		{
@@ -583,9 +603,74 @@ ArgValue rp::GetDefaultValue(const ArgType& type)
 		}
 		else if constexpr (std::is_same_v<T, UserType>)
 		{
-			return GetDefaultValue(*t.Type);
+			return GetDefaultValue(*t.Type, memory);
 		}
 
 		return ArgValue{};
 	}, type);
 }
+
+ArgValue rp::CopyValue(const ArgValue& value, std::pmr::memory_resource* memory)
+{
+	return std::visit([memory](auto&& v) -> ArgValue
+	{
+		using T = std::decay_t<decltype(v)>;
+		if constexpr (std::is_same_v<T, ArgString> || std::is_same_v<T, ArgBlob>)
+		{
+			return T(v, memory);
+		}
+		else if constexpr (std::is_same_v<T, ArgArray>)
+		{
+			ArgArray values(memory);
+			values.reserve(v.size());
+			for (const ArgValue& element : v)
+			{
+				values.emplace_back(CopyValue(element, memory));
+			}
+			return values;
+		}
+		else if constexpr (std::is_same_v<T, ArgDict>)
+		{
+			ArgDict dict{ v.Type, ArgArray(memory) };
+			dict.Values.reserve(v.Values.size());
+			for (const ArgValue& element : v.Values)
+			{
+				dict.Values.emplace_back(CopyValue(element, memory));
+			}
+			return dict;
+		}
+		else
+		{
+			return v;
+		}
+	}, value);
+}
+
+const ArgValue* rp::ArgDict::Find(std::string_view name) const
+{
+	if (Type == nullptr || Values.size() != Type->Properties.size())
+	{
+		return nullptr;
+	}
+
+	for (size_t i = 0; i < Values.size(); i++)
+	{
+		if (Type->Properties[i].Name == name)
+		{
+			return &Values[i];
+		}
+	}
+	return nullptr;
+}
+
+ArgValue* rp::ArgDict::Find(std::string_view name)
+{
+	return const_cast<ArgValue*>(std::as_const(*this).Find(name));
+}
+
+const ArgValue& rp::ArgDict::at(std::string_view name) const
+{
+	const ArgValue* value = Find(name);
+	assert(value != nullptr);
+	return *value;
+}
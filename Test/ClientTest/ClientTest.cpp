@@ -0,0 +1,335 @@
+// Copyright 2024 <github.com/razaqq>
+
+#include "Client/DatabaseManager.hpp"
+
+#include "Core/Log.hpp"
+#include "Core/Sqlite.hpp"
+#include "Core/StandardPaths.hpp"
+
+#include <catch2/catch_all.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+using PotatoAlert::Client::DatabaseManager;
+using PotatoAlert::Client::GetMatchTimestamp;
+using PotatoAlert::Client::Match;
+using PotatoAlert::Client::MatchFilter;
+using PotatoAlert::Client::MatchListKey;
+using PotatoAlert::ReplayParser::MatchOutcome;
+using PotatoAlert::ReplayParser::ReplaySummary;
+using PotatoAlert::Core::SQLite;
+
+namespace {
+
+static struct test_init
+{
+	test_init()
+	{
+		PotatoAlert::Core::Log::Init(PotatoAlert::Core::AppDataPath("PotatoAlert") / "ClientTest.log");
+	}
+} test_init_instance;
+
+static SQLite OpenMemoryDatabase()
+{
+	return SQLite::Open(std::string_view(":memory:"), SQLite::Flags::ReadWrite | SQLite::Flags::Create | SQLite::Flags::Memory);
+}
+
+// the matches table as it was before the Timestamp and Outcome columns were added
+static constexpr std::string_view OldMatchesTable =
+		"CREATE TABLE matches (Id INTEGER PRIMARY KEY, Hash TEXT UNIQUE, ReplayName TEXT, Date TEXT, Ship TEXT, ShipNation TEXT, "
+		"ShipClass TEXT, ShipTier INTEGER, Map TEXT, MatchGroup TEXT, StatsMode TEXT, Player TEXT, Region TEXT, Json TEXT, "
+		"ArenaInfo TEXT, Analyzed INTEGER DEFAULT FALSE, ReplaySummary TEXT)";
+
+static bool InsertOldMatch(const SQLite& db, std::string_view hash, std::string_view date)
+{
+	SQLite::Statement stmt(db, "INSERT INTO matches (Hash, Date) VALUES (:Hash, :Date)");
+	if (!stmt || !stmt.Bind(":Hash", hash) || !stmt.Bind(":Date", date))
+		return false;
+	stmt.ExecuteStep();
+	return stmt.IsDone();
+}
+
+static bool SetOldReplaySummary(const SQLite& db, std::string_view hash, std::string_view replaySummary)
+{
+	SQLite::Statement stmt(db, "UPDATE matches SET Analyzed = TRUE, ReplaySummary = :ReplaySummary WHERE Hash = :Hash");
+	if (!stmt || !stmt.Bind(":Hash", hash) || !stmt.Bind(":ReplaySummary", replaySummary))
+		return false;
+	stmt.ExecuteStep();
+	return stmt.IsDone();
+}
+
+static std::optional<MatchOutcome> GetListedOutcome(const DatabaseManager& dbm, uint32_t id)
+{
+	const auto matches = dbm.GetMatchList(MatchFilter{}, std::nullopt, 100);
+	if (!matches)
+		return {};
+	for (const Match& match : matches.value())
+	{
+		if (match.Id == id)
+			return match.ReplaySummary.Outcome;
+	}
+	return {};
+}
+
+}
+
+TEST_CASE( "ClientTest_GetMatchTimestampTest" )
+{
+	REQUIRE(GetMatchTimestamp("07.11.2020 15:53:56") == 1604764436);
+	REQUIRE(GetMatchTimestamp("01.01.1970 00:00:00") == 0);
+	REQUIRE(GetMatchTimestamp("29.02.2024 23:59:59") == 1709251199);
+
+	REQUIRE(GetMatchTimestamp("") == 0);
+	REQUIRE(GetMatchTimestamp("7.11.2020 15:53:56") == 0);
+	REQUIRE(GetMatchTimestamp("31.02.2021 10:00:00") == 0);
+	REQUIRE(GetMatchTimestamp("07.13.2020 15:53:56") == 0);
+	REQUIRE(GetMatchTimestamp("07.11.2020 25:53:56") == 0);
+	REQUIRE(GetMatchTimestamp("07.11.2020 15:60:56") == 0);
+	REQUIRE(GetMatchTimestamp("aa.bb.cccc dd:ee:ff") == 0);
+}
+
+TEST_CASE( "ClientTest_DatabaseMigrateTest" )
+{
+	static constexpr std::array<std::string_view, 10> dates =
+	{
+		"07.11.2020 15:53:56",
+		"29.02.2024 23:59:59",
+		"01.01.1970 00:00:00",
+		"",
+		"7.11.2020 15:53:56",
+		"31.02.2021 10:00:00",
+		"07.13.2020 15:53:56",
+		"07.11.2020 25:53:56",
+		"07.11.2020 15:60:56",
+		"aa.bb.cccc dd:ee:ff",
+	};
+
+	SQLite db = OpenMemoryDatabase();
+	REQUIRE(db);
+	REQUIRE(db.Execute(OldMatchesTable));
+	for (size_t i = 0; i < dates.size(); i++)
+	{
+		REQUIRE(InsertOldMatch(db, std::to_string(i), dates[i]));
+	}
+
+	const DatabaseManager dbm(db);
+	REQUIRE(dbm.MigrateTables());
+	// migrating an up to date table does nothing
+	REQUIRE(dbm.MigrateTables());
+
+	for (size_t i = 0; i < dates.size(); i++)
+	{
+		const auto match = dbm.GetMatch(std::to_string(i));
+		REQUIRE(match);
+		REQUIRE(match->has_value());
+		REQUIRE(match->value().Date == dates[i]);
+		REQUIRE(match->value().Timestamp == GetMatchTimestamp(dates[i]));
+	}
+
+	// a migration that was interrupted between two batches continues with the matches that are left
+	REQUIRE(db.Execute("UPDATE matches SET Timestamp = NULL, Outcome = NULL WHERE Hash = '0'"));
+	REQUIRE(dbm.MigrateTables());
+	const auto resumed = dbm.GetMatch("0");
+	REQUIRE(resumed);
+	REQUIRE(resumed->has_value());
+	REQUIRE(resumed->value().Timestamp == GetMatchTimestamp(dates[0]));
+	REQUIRE(GetListedOutcome(dbm, resumed->value().Id) == MatchOutcome::Unknown);
+}
+
+TEST_CASE( "ClientTest_DatabaseMigrateBatchesTest" )
+{
+	SQLite db = OpenMemoryDatabase();
+	REQUIRE(db);
+	REQUIRE(db.Execute(OldMatchesTable));
+	// more matches than fit into one batch of the migration
+	for (size_t i = 0; i < 2500; i++)
+	{
+		REQUIRE(InsertOldMatch(db, std::to_string(i), "07.11.2020 15:53:56"));
+	}
+
+	const DatabaseManager dbm(db);
+	REQUIRE(dbm.MigrateTables());
+
+	SQLite::Statement stmt(db, "SELECT COUNT(*) FROM matches WHERE Timestamp = 1604764436 AND Outcome = 3");
+	REQUIRE(stmt);
+	stmt.ExecuteStep();
+	int64_t count = 0;
+	REQUIRE(stmt.GetInt64(0, count));
+	REQUIRE(count == 2500);
+}
+
+TEST_CASE( "ClientTest_DatabaseUpdateMatchTest" )
+{
+	SQLite db = OpenMemoryDatabase();
+	REQUIRE(db);
+	const DatabaseManager dbm(db);
+	REQUIRE(dbm.CreateTables());
+	REQUIRE(dbm.MigrateTables());
+
+	Match match{};
+	match.Hash = "hash";
+	match.Date = "07.11.2020 15:53:56";
+	REQUIRE(dbm.AddMatch(match));
+	REQUIRE(match.Timestamp == GetMatchTimestamp(match.Date));
+
+	const auto added = dbm.GetMatch("hash");
+	REQUIRE(added);
+	REQUIRE(added->has_value());
+	const uint32_t id = added->value().Id;
+
+	// the timestamp follows the date, not the stale value of the caller
+	match.Date = "29.02.2024 23:59:59";
+	REQUIRE(dbm.UpdateMatch(id, match));
+	auto updated = dbm.GetMatch(id);
+	REQUIRE(updated);
+	REQUIRE(updated->has_value());
+	REQUIRE(updated->value().Timestamp == GetMatchTimestamp("29.02.2024 23:59:59"));
+
+	match.Date = "01.01.2021 00:00:00";
+	match.Timestamp = 42;
+	REQUIRE(dbm.UpdateMatch("hash", match));
+	updated = dbm.GetMatch(id);
+	REQUIRE(updated);
+	REQUIRE(updated->has_value());
+	REQUIRE(updated->value().Timestamp == GetMatchTimestamp("01.01.2021 00:00:00"));
+}
+
+TEST_CASE( "ClientTest_DatabaseMatchOutcomeTest" )
+{
+	SQLite db = OpenMemoryDatabase();
+	REQUIRE(db);
+	REQUIRE(db.Execute(OldMatchesTable));
+	for (std::string_view hash : { "win", "loss", "draw", "unknown", "none" })
+	{
+		REQUIRE(InsertOldMatch(db, hash, "07.11.2020 15:53:56"));
+	}
+	// the outcome is parsed from the json, regardless of how it is formatted
+	REQUIRE(SetOldReplaySummary(db, "win", R"({"outcome":"win","damage_dealt":1.0})"));
+	REQUIRE(SetOldReplaySummary(db, "loss", R"({"damage_dealt":1.0, "outcome": "loss"})"));
+	REQUIRE(SetOldReplaySummary(db, "draw", R"({"outcome":"draw"})"));
+	REQUIRE(SetOldReplaySummary(db, "unknown", R"({"damage_dealt":1.0})"));
+
+	const DatabaseManager dbm(db);
+	REQUIRE(dbm.MigrateTables());
+	REQUIRE(dbm.MigrateTables());
+
+	auto getId = [&dbm](std::string_view hash) -> uint32_t
+	{
+		const auto match = dbm.GetMatch(hash);
+		return match && match->has_value() ? match->value().Id : 0;
+	};
+
+	REQUIRE(GetListedOutcome(dbm, getId("win")) == MatchOutcome::Win);
+	REQUIRE(GetListedOutcome(dbm, getId("loss")) == MatchOutcome::Loss);
+	REQUIRE(GetListedOutcome(dbm, getId("draw")) == MatchOutcome::Draw);
+	REQUIRE(GetListedOutcome(dbm, getId("unknown")) == MatchOutcome::Unknown);
+	REQUIRE(GetListedOutcome(dbm, getId("none")) == MatchOutcome::Unknown);
+
+	// setting the summary updates the outcome as well
+	REQUIRE(dbm.SetMatchReplaySummary(getId("none"), ReplaySummary{ .Outcome = MatchOutcome::Loss }));
+	REQUIRE(GetListedOutcome(dbm, getId("none")) == MatchOutcome::Loss);
+	REQUIRE(dbm.SetMatchReplaySummary("win", ReplaySummary{ .Outcome = MatchOutcome::Draw }));
+	REQUIRE(GetListedOutcome(dbm, getId("win")) == MatchOutcome::Draw);
+
+	Match match{};
+	match.Hash = "added";
+	match.ReplaySummary.Outcome = MatchOutcome::Win;
+	REQUIRE(dbm.AddMatch(match));
+	REQUIRE(GetListedOutcome(dbm, getId("added")) == MatchOutcome::Win);
+	match.ReplaySummary.Outcome = MatchOutcome::Loss;
+	REQUIRE(dbm.UpdateMatch("added", match));
+	REQUIRE(GetListedOutcome(dbm, getId("added")) == MatchOutcome::Loss);
+}
+
+TEST_CASE( "ClientTest_DatabaseMatchListTest" )
+{
+	SQLite db = OpenMemoryDatabase();
+	REQUIRE(db);
+	const DatabaseManager dbm(db);
+	REQUIRE(dbm.CreateTables());
+	REQUIRE(dbm.MigrateTables());
+	REQUIRE(dbm.CreateIndexes());
+
+	// several matches share a date, so the pages have to be split by id as well
+	static constexpr std::array<std::string_view, 4> dates =
+	{
+		"07.11.2020 15:53:56",
+		"29.02.2024 23:59:59",
+		"01.01.2021 00:00:00",
+		"29.02.2024 23:59:59",
+	};
+	for (size_t i = 0; i < 23; i++)
+	{
+		Match match{};
+		match.Hash = std::to_string(i);
+		match.Date = dates[i % dates.size()];
+		match.Map = i % 2 == 0 ? "even" : "odd";
+		REQUIRE(dbm.AddMatch(match));
+	}
+
+	for (const MatchFilter& filter : { MatchFilter{}, MatchFilter{ .Maps = std::vector<std::string>{ "odd" } } })
+	{
+		const auto all = dbm.GetMatchList(filter, std::nullopt, 100);
+		REQUIRE(all);
+		REQUIRE(all->size() == dbm.GetMatchCount(filter).value());
+		for (size_t i = 1; i < all->size(); i++)
+		{
+			const Match& prev = all.value()[i - 1];
+			const Match& match = all.value()[i];
+			REQUIRE((prev.Timestamp > match.Timestamp || (prev.Timestamp == match.Timestamp && prev.Id > match.Id)));
+		}
+
+		// reading page by page after the last match of the page before gives the same matches
+		std::vector<Match> paged;
+		std::optional<MatchListKey> after;
+		while (true)
+		{
+			const auto page = dbm.GetMatchList(filter, after, 5);
+			REQUIRE(page);
+			paged.insert(paged.end(), page->begin(), page->end());
+			if (page->size() < 5)
+				break;
+			after = MatchListKey{ .Timestamp = page->back().Timestamp, .Id = page->back().Id };
+		}
+		REQUIRE(paged.size() == all->size());
+		for (size_t i = 0; i < paged.size(); i++)
+		{
+			REQUIRE(paged[i].Id == all.value()[i].Id);
+		}
+
+		// skipping pages by key lands on the same matches
+		std::optional<MatchListKey> skipped;
+		for (size_t i = 5; i <= all->size(); i += 5)
+		{
+			const auto key = dbm.GetMatchListKey(filter, skipped, 5);
+			REQUIRE(key);
+			REQUIRE(key->has_value());
+			REQUIRE(key->value().Id == all.value()[i - 1].Id);
+			skipped = key.value();
+		}
+		const auto pastEnd = dbm.GetMatchListKey(filter, skipped, 5);
+		REQUIRE(pastEnd);
+		REQUIRE(!pastEnd->has_value());
+
+		// a page read with its count skips the pages before it by key
+		const auto page = dbm.GetMatchListPage(filter, std::nullopt, 2, 5);
+		REQUIRE(page);
+		REQUIRE(page->Count == all->size());
+		REQUIRE(page->SkippedKeys.size() == 2);
+		REQUIRE(page->SkippedKeys[1].Id == all.value()[9].Id);
+		REQUIRE(page->Matches.size() == std::min<size_t>(5, all->size() - 10));
+		REQUIRE(page->Matches.front().Id == all.value()[10].Id);
+
+		const auto emptyPage = dbm.GetMatchListPage(filter, page->SkippedKeys[1], 10, 5);
+		REQUIRE(emptyPage);
+		REQUIRE(emptyPage->Count == all->size());
+		REQUIRE(emptyPage->Matches.empty());
+	}
+}
@@ -2,10 +2,12 @@
 
 #include "Core/ByteReader.hpp"
 #include "Core/Blowfish.hpp"
+#include "Core/Bytes.hpp"
 #include "Core/Directory.hpp"
 #include "Core/Semaphore.hpp"
 #include "Core/Sha1.hpp"
 #include "Core/Sha256.hpp"
+#include "Core/Sqlite.hpp"
 #include "Core/String.hpp"
 #include "Core/Version.hpp"
 #include "Core/Zlib.hpp"
@@ -106,6 +108,31 @@ TEST_CASE( "ByteReaderTest" )
 	REQUIRE_FALSE(reader.ReadTo(y));
 }
 
+TEST_CASE( "BytesTest" )
+{
+	std::vector<Byte> data;
+	Write<uint32_t>(data, 0xDEADBEEF);
+	WriteString(data, "potato");
+	Write<float>(data, 1.5f);
+	REQUIRE(data.size() == 4 + 4 + 6 + 4);
+
+	std::span<const Byte> span = data;
+	uint32_t x;
+	std::string str;
+	float f;
+	REQUIRE(TakeInto(span, x));
+	REQUIRE(ReadString(span, str));
+	REQUIRE(TakeInto(span, f));
+	REQUIRE(x == 0xDEADBEEF);
+	REQUIRE(str == "potato");
+	REQUIRE(f == 1.5f);
+	REQUIRE(span.empty());
+
+	// the size prefix claims more than is left
+	std::span<const Byte> truncated = std::span<const Byte>(data).subspan(4, 8);
+	REQUIRE_FALSE(ReadString(truncated, str));
+}
+
 TEST_CASE( "BlowFishEncryptTest" )
 {
 	auto key = FromString<Byte>("just some random key lol");
@@ -134,6 +161,45 @@ TEST_CASE( "BlowFishDecryptTest" )
 	REQUIRE(std::equal(out.begin(), out.end(), solution.begin(), solution.end()));
 }
 
+TEST_CASE( "BlowFishDecryptCbcLikeTest" )
+{
+	auto key = FromString<Byte>("just some random key lol");
+	Blowfish blowfish(key);
+
+	// the first block is not chained, as prev starts at zero
+	auto text = FromHex<Byte>(0x6b, 0x40, 0x9e, 0x78, 0xb1, 0x7b, 0x58, 0x65);
+	auto solution = FromString<Byte>("just a t");
+	std::array<Byte, 8> prev = {};
+	std::vector<Byte> out(text.size());
+	REQUIRE(blowfish.DecryptCbcLike(text, out, prev));
+	REQUIRE(std::ranges::equal(out, solution));
+	REQUIRE(std::ranges::equal(prev, solution));
+
+	// compare against DecryptBlock on enough blocks for both the interleaved and the remaining blocks, decrypted in two chunks
+	std::vector<Byte> data(13 * Blowfish::BlockSize());
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		data[i] = static_cast<Byte>(i * 151 + 7);
+	}
+
+	std::vector<Byte> expected(data.size());
+	REQUIRE(blowfish.Decrypt(data, expected));
+	for (size_t i = Blowfish::BlockSize(); i < expected.size(); i++)
+	{
+		expected[i] ^= expected[i - Blowfish::BlockSize()];
+	}
+
+	prev = {};
+	out.assign(data.size(), Byte{ 0 });
+	const size_t split = 5 * Blowfish::BlockSize();
+	REQUIRE(blowfish.DecryptCbcLike(std::span(data).first(split), std::span(out).first(split), prev));
+	REQUIRE(blowfish.DecryptCbcLike(std::span(data).subspan(split), std::span(out).subspan(split), prev));
+	REQUIRE(out == expected);
+
+	REQUIRE_FALSE(blowfish.DecryptCbcLike(std::span(data).first(3), std::span(out).first(3), prev));
+	REQUIRE_FALSE(blowfish.DecryptCbcLike(data, std::span(out).first(8), prev));
+}
+
 TEST_CASE( "MutexTest" )
 {
 	constexpr std::string_view SemName = "TEST_SEMAPHORE";
@@ -203,6 +269,63 @@ TEST_CASE( "Sha256Test" )
 	REQUIRE(hash2 == "d7a8fbb307d7809469ca9abcb0082e4f8d5651e46d3cdb762d02d0bf37c9e592");
 }
 
+TEST_CASE( "SQLiteTest" )
+{
+	SQLite db = SQLite::Open(std::string_view(":memory:"), SQLite::Flags::ReadWrite | SQLite::Flags::Create | SQLite::Flags::Memory);
+	REQUIRE(db);
+	REQUIRE(db.SetSynchronous(SQLite::Synchronous::Normal));
+	REQUIRE(db.Execute("CREATE TABLE test (Id INTEGER PRIMARY KEY, Value INTEGER)"));
+
+	auto insert = [&db](int value) -> bool
+	{
+		// the same sql every time, so the statement comes from the cache
+		SQLite::Statement stmt(db, "INSERT INTO test (Value) VALUES (:Value)");
+		if (!stmt || !stmt.Bind(":Value", value))
+			return false;
+		stmt.ExecuteStep();
+		return stmt.IsDone();
+	};
+
+	auto count = [&db]() -> int64_t
+	{
+		SQLite::Statement stmt(db, "SELECT COUNT(*) FROM test");
+		stmt.ExecuteStep();
+		int64_t rows = -1;
+		stmt.GetInt64(0, rows);
+		return rows;
+	};
+
+	{
+		SQLite::Transaction transaction(db);
+		REQUIRE(transaction);
+		for (int i = 0; i < 10; i++)
+		{
+			REQUIRE(insert(i));
+			REQUIRE(transaction.CommitBatch(4));
+		}
+		REQUIRE(transaction.Commit());
+		REQUIRE_FALSE(transaction);
+	}
+	REQUIRE(count() == 10);
+
+	{
+		SQLite::Transaction transaction(db);
+		REQUIRE(insert(10));
+		REQUIRE(count() == 11);
+	}
+	REQUIRE(count() == 10);
+
+	{
+		SQLite::Transaction transaction(db);
+		for (int i = 0; i < 5; i++)
+		{
+			REQUIRE(insert(i));
+			REQUIRE(transaction.CommitBatch(4));
+		}
+	}
+	REQUIRE(count() == 14);
+}
+
 TEST_CASE( "StringTest" )
 {
 	REQUIRE(String::Trim(" test \n\t") == "test");
@@ -261,6 +384,16 @@ TEST_CASE( "StringTest" )
 	REQUIRE_FALSE(String::StartsWith("", "textt"));
 	REQUIRE(String::StartsWith("text", ""));
 	REQUIRE(String::EndsWith("text", ""));
+
+	REQUIRE(String::MatchesGlob("20230723_181537_PWSD207-Grom_42_Neighbors.wowsreplay", "*.wowsreplay"));
+	REQUIRE(String::MatchesGlob("shipA.xml", "ship?.xml"));
+	REQUIRE(String::MatchesGlob("", "*"));
+	REQUIRE(String::MatchesGlob("abc", "a*b*c*"));
+	REQUIRE_FALSE(String::MatchesGlob("abc", "a*d"));
+	REQUIRE_FALSE(String::MatchesGlob("ship.xml", "ship?.xml"));
+	REQUIRE(String::MatchesGlob("gui/flags/ship.png", "gui/*/*.png"));
+	REQUIRE_FALSE(String::MatchesGlob("gui/flags/small/ship.png", "gui/*.png"));
+	REQUIRE_FALSE(String::MatchesGlob("gui/ship.png", "gui?ship.png"));
 }
 
 TEST_CASE( "VersionTest" )
@@ -359,4 +492,38 @@ TEST_CASE( "ZlibTest" )
 
 	REQUIRE(vec.size() == string.size());
 	CHECK(std::memcmp(vec.data(), string.data(), vec.size()) == 0);
+
+	// feed the stream in small pieces into a small output buffer
+	Zlib::Inflater inflater;
+	std::vector<Byte> streamed;
+	std::span<const Byte> in = binary;
+	Zlib::Inflater::Status status = Zlib::Inflater::Status::Ok;
+	while (status == Zlib::Inflater::Status::Ok)
+	{
+		std::span<const Byte> piece = in.subspan(0, std::min<size_t>(in.size(), 7));
+		const size_t pieceSize = piece.size();
+		std::array<Byte, 16> chunk{};
+		std::span<Byte> out = chunk;
+		status = inflater.Inflate(piece, out);
+		in = in.subspan(pieceSize - piece.size());
+		streamed.insert(streamed.end(), chunk.begin(), chunk.begin() + (chunk.size() - out.size()));
+	}
+
+	REQUIRE(status == Zlib::Inflater::Status::StreamEnd);
+	REQUIRE(streamed.size() == string.size());
+	CHECK(std::memcmp(streamed.data(), string.data(), streamed.size()) == 0);
+
+	// inflate into a buffer of exactly the known size
+	const std::vector<Byte> hinted = Zlib::Inflate(binary, true, string.size());
+	REQUIRE(hinted == vec);
+	REQUIRE(hinted.capacity() == string.size());
+
+	std::vector<Byte> buffer(string.size());
+	REQUIRE(Zlib::Inflate(binary, buffer) == string.size());
+	REQUIRE(buffer == vec);
+	REQUIRE(inflater.InflateAll(binary, buffer) == string.size());
+	REQUIRE(buffer == vec);
+
+	std::vector<Byte> tooSmall(string.size() - 1);
+	REQUIRE_FALSE(Zlib::Inflate(binary, tooSmall));
 }
@@ -5,22 +5,30 @@
 #include "Core/File.hpp"
 #include "Core/Log.hpp"
 #include "Core/StandardPaths.hpp"
+#include "Core/Zlib.hpp"
 
 #include <GameFileUnpack/GameFileUnpack.hpp>
 
 #include <catch2/catch_all.hpp>
 
+#include <algorithm>
+#include <cstdint>
 #include <filesystem>
+#include <limits>
+#include <span>
+#include <vector>
 
 #include <QDir>
 #include <QStandardPaths>
 
+#include <zlib.h>
+
 
 namespace fs = std::filesystem;
 using PotatoAlert::Core::Byte;
 using PotatoAlert::Core::File;
+namespace Zlib = PotatoAlert::Core::Zlib;
 using namespace PotatoAlert::GameFileUnpack;
-typedef DirectoryTree::TreeNode TreeNode;
 using PotatoAlert::GameFileUnpack::Unpacker;
 
 namespace {
@@ -65,25 +73,102 @@ static fs::path GetGameFilePath(std::string_view fileName)
 	return GetGameFileRootPath() / fileName;
 }
 
+// raw deflate without a header, like the files inside the pkgs
+static std::vector<Byte> Deflate(std::span<const Byte> data)
+{
+	z_stream stream = {};
+	REQUIRE(deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+
+	std::vector<Byte> out(deflateBound(&stream, static_cast<uLong>(data.size())));
+	stream.next_in = const_cast<Byte*>(data.data());
+	stream.avail_in = static_cast<uInt>(data.size());
+	stream.next_out = out.data();
+	stream.avail_out = static_cast<uInt>(out.size());
+	REQUIRE(deflate(&stream, Z_FINISH) == Z_STREAM_END);
+	out.resize(stream.total_out);
+	deflateEnd(&stream);
+
+	return out;
+}
+
+static std::vector<Byte> ReadFile(const fs::path& path)
+{
+	std::vector<Byte> data;
+	const File file = File::Open(path, File::Flags::Open | File::Flags::Read);
+	REQUIRE(file);
+	REQUIRE(file.ReadAll(data));
+	return data;
+}
+
 }
 
 TEST_CASE("GameFileUnpackTest_DirectoryTreeTest")
 {
-	DirectoryTree tree;
-
-	tree.Insert(FileRecord{ "", "content/testFile.txt" });
-	std::optional<TreeNode> record1 = tree.Find("content/testFile.txt");
-	REQUIRE(record1);
-	REQUIRE(record1.value().File);
-	REQUIRE(record1.value().File.value().Path == "content/testFile.txt");
-
-	tree.Insert(FileRecord{ "", "content/testFile2.txt" });
-	std::optional<TreeNode> record2 = tree.Find("content/");
-	REQUIRE(record2);
-	REQUIRE_FALSE(record2.value().File);
-	REQUIRE(record2.value().Nodes.contains("testFile.txt"));
-	REQUIRE(record2.value().Nodes.contains("testFile2.txt"));
-	REQUIRE_FALSE(record2.value().File.has_value());
+	const std::vector<FileRecord> records =
+	{
+		FileRecord{ "a.pkg", "content/testFile.txt" },
+		FileRecord{ "a.pkg", "content/testFile2.txt" },
+		FileRecord{ "b.pkg", "content/sub/testFile3.txt" },
+		FileRecord{ "b.pkg", "content.txt" },
+		FileRecord{ "b.pkg", "contentFile.txt" },
+	};
+	const DirectoryTree tree(records);
+	REQUIRE(tree.Size() == 5);
+
+	const DirectoryTree::Files record1 = tree.Find("content/testFile.txt");
+	REQUIRE(record1.size() == 1);
+	REQUIRE((*record1.begin()).Path == "content/testFile.txt");
+	REQUIRE((*record1.begin()).PkgName == "a.pkg");
+
+	const DirectoryTree::Files record2 = tree.Find("content/");
+	REQUIRE(record2.size() == 3);
+	REQUIRE(std::ranges::all_of(record2, [](const FileView& file) { return file.Path.starts_with("content/"); }));
+
+	REQUIRE(tree.Find("").size() == 5);
+	REQUIRE(tree.Find("cont").empty());
+
+	const std::vector<FileView> glob = tree.Glob("content/*.txt");
+	REQUIRE(glob.size() == 2);
+	REQUIRE(glob[0].Path == "content/testFile.txt");
+	REQUIRE(glob[1].Path == "content/testFile2.txt");
+	REQUIRE(tree.Glob("content*.txt").size() == 2);
+}
+
+TEST_CASE("GameFileUnpackTest_InflateFileTest")
+{
+	// larger than a single inflate buffer and noisy enough to not compress to almost nothing
+	std::vector<Byte> data(2 * MappedInflateSize + 123);
+	uint32_t state = 1;
+	for (Byte& b : data)
+	{
+		state = state * 1103515245 + 12345;
+		b = static_cast<Byte>((state >> 16) % 16);
+	}
+	const std::vector<Byte> compressed = Deflate(data);
+	const std::vector<Byte> expected = Zlib::Inflate(compressed, false, data.size());
+	REQUIRE(expected == data);
+
+	const fs::path dst = GetTempDirectory() / "InflateFileTest.bin";
+	constexpr uint64_t neverMapped = std::numeric_limits<uint64_t>::max();
+
+	// inflated into a mapping of the file
+	REQUIRE(InflateFile(dst, compressed, data.size()));
+	REQUIRE(fs::file_size(dst) == data.size());
+	REQUIRE(ReadFile(dst) == expected);
+
+	// inflated through a buffer
+	REQUIRE(InflateFile(dst, compressed, data.size(), neverMapped));
+	REQUIRE(fs::file_size(dst) == data.size());
+	REQUIRE(ReadFile(dst) == expected);
+
+	// the data inflates to more or less than the size on both paths
+	REQUIRE_FALSE(InflateFile(dst, compressed, data.size() - 1));
+	REQUIRE_FALSE(InflateFile(dst, compressed, data.size() + 1));
+	REQUIRE_FALSE(InflateFile(dst, compressed, data.size() - 1, neverMapped));
+	REQUIRE_FALSE(InflateFile(dst, compressed, data.size() + 1, neverMapped));
+
+	std::error_code ec;
+	fs::remove(dst, ec);
 }
 
 TEST_CASE("GameFileUnpackTest_IdxFileTest")
@@ -117,3 +202,35 @@ TEST_CASE("GameFileUnpackTest_UnpackerTest")
 		GetTempDirectory())
 	);
 }
+
+TEST_CASE("GameFileUnpackTest_UnpackerCacheTest")
+{
+	const fs::path cacheFile = GetTempDirectory() / "idx.bin";
+	std::error_code ec;
+	fs::remove(cacheFile, ec);
+
+	{
+		const Unpacker unpacker(GetGameFileRootPath(), GetGameFileRootPath(), cacheFile);
+		REQUIRE(fs::exists(cacheFile));
+	}
+
+	// the second unpacker loads its index from the cache
+	const fs::path dst = GetTempDirectory() / "UnpackerCacheTest";
+	fs::remove_all(dst, ec);
+	const Unpacker unpacker(GetGameFileRootPath(), GetGameFileRootPath(), cacheFile);
+	REQUIRE(unpacker.Extract("content/gameplay/usa/gun/secondary/textures/AGS206_3in50_MK21_Sub_ao.dds", dst));
+	REQUIRE(fs::file_size(dst / "content/gameplay/usa/gun/secondary/textures/AGS206_3in50_MK21_Sub_ao.dds") == 2872);
+}
+
+TEST_CASE("GameFileUnpackTest_UnpackerOpenTest")
+{
+	const Unpacker unpacker(GetGameFileRootPath(), GetGameFileRootPath());
+	REQUIRE(unpacker.Exists("content/gameplay/usa/gun/secondary/textures/AGS206_3in50_MK21_Sub_ao.dds"));
+	REQUIRE_FALSE(unpacker.Exists("content/gameplay/usa/gun/secondary/textures"));
+	REQUIRE_FALSE(unpacker.Open("content/doesNotExist.dds"));
+
+	const std::optional<GameFile> file = unpacker.Open("content/gameplay/usa/gun/secondary/textures/AGS206_3in50_MK21_Sub_ao.dds");
+	REQUIRE(file);
+	REQUIRE(file->Size() == 2872);
+	REQUIRE(file->Data().size() == 2872);
+}
@@ -0,0 +1,352 @@
+// Copyright 2024 <github.com/razaqq>
+
+#include "Core/Blowfish.hpp"
+#include "Core/Bytes.hpp"
+#include "Core/Log.hpp"
+#include "Core/Process.hpp"
+#include "Core/Result.hpp"
+#include "Core/StandardPaths.hpp"
+#include "Core/Version.hpp"
+#include "Core/Zlib.hpp"
+
+#include "ReplayParser/GameFiles.hpp"
+#include "ReplayParser/PacketParser.hpp"
+#include "ReplayParser/ReplayParser.hpp"
+#include "ReplayParser/TypeProgram.hpp"
+#include "ReplayParser/Types.hpp"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_all.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+using PotatoAlert::Core::Blowfish;
+using PotatoAlert::Core::Byte;
+using PotatoAlert::Core::GetModuleRootPath;
+using PotatoAlert::Core::Result;
+using PotatoAlert::Core::Take;
+using PotatoAlert::Core::Version;
+namespace Zlib = PotatoAlert::Core::Zlib;
+using namespace PotatoAlert::ReplayParser;
+namespace fs = std::filesystem;
+
+namespace {
+
+static struct test_init
+{
+	test_init()
+	{
+		PotatoAlert::Core::Log::Init(PotatoAlert::Core::AppDataPath("PotatoAlert") / "ReplayBenchmark.log");
+	}
+} test_init_instance;
+
+static fs::path GetRootPath()
+{
+	if (Result<fs::path> rootPath = GetModuleRootPath())
+	{
+		return rootPath.value().remove_filename();
+	}
+
+	PotatoAlert::Core::ExitCurrentProcess(1);
+}
+
+static fs::path GetGameFilePath()
+{
+	return GetRootPath() / "ReplayVersions";
+}
+
+static fs::path GetReplay(std::string_view name)
+{
+	return GetRootPath() / "Replays" / name;
+}
+
+static std::vector<fs::path> GetReplays()
+{
+	std::vector<fs::path> replays;
+	for (const fs::directory_entry& entry : fs::directory_iterator(GetRootPath() / "Replays"))
+	{
+		if (entry.path().extension() == ".wowsreplay")
+			replays.emplace_back(entry.path());
+	}
+	std::ranges::sort(replays);
+	return replays;
+}
+
+// the replay every single stage is measured on
+static constexpr std::string_view ReferenceReplay = "20201107_155356_PISC110-Venezia_19_OC_prey.wowsreplay";
+
+// the encrypted packet stream of a replay, read without decoding any of it
+struct EncryptedStream
+{
+	std::vector<Byte> Data;
+	uint32_t DecompressedSize;
+};
+
+static std::optional<EncryptedStream> ReadEncryptedStream(const fs::path& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	const std::vector<Byte> bytes{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+
+	const ReplayResult<ReplayLayout> layout = ReadLayout(bytes);
+	if (!layout)
+		return std::nullopt;
+
+	return EncryptedStream{ { layout->Stream.begin(), layout->Stream.end() }, layout->DecompressedSize };
+}
+
+static std::vector<Byte> DecryptBlockwise(std::span<const Byte> src)
+{
+	const Blowfish blowfish(ReplayKey);
+
+	std::vector<Byte> dst(src.size());
+	std::array<Byte, 8> prev = {};
+	for (size_t offset = 0; offset + Blowfish::BlockSize() <= src.size(); offset += Blowfish::BlockSize())
+	{
+		uint32_t block[2];
+		std::memcpy(block, src.data() + offset, sizeof(block));
+
+		Blowfish::ReverseByteOrder(block[0]);
+		Blowfish::ReverseByteOrder(block[1]);
+		blowfish.DecryptBlock(&block[0], &block[1]);
+		Blowfish::ReverseByteOrder(block[0]);
+		Blowfish::ReverseByteOrder(block[1]);
+
+		std::memcpy(dst.data() + offset, block, sizeof(block));
+		for (size_t j = 0; j < Blowfish::BlockSize(); j++)
+		{
+			dst[offset + j] = dst[offset + j] ^ prev[j];
+			prev[j] = dst[offset + j];
+		}
+	}
+	return dst;
+}
+
+static std::vector<Byte> Decrypt(std::span<const Byte> src)
+{
+	const Blowfish blowfish(ReplayKey);
+
+	std::vector<Byte> dst(src.size());
+	std::array<Byte, 8> prev = {};
+	blowfish.DecryptCbcLike(src.first(src.size() - src.size() % Blowfish::BlockSize()), dst, prev);
+	return dst;
+}
+
+static size_t ParsePackets(std::span<const Byte> stream, const std::shared_ptr<const std::vector<EntitySpec>>& specs, Version version)
+{
+	std::pmr::monotonic_buffer_resource arena;
+	PacketParser parser;
+	parser.Specs = specs;
+	parser.Memory = &arena;
+
+	size_t count = 0;
+	while (stream.size() >= 3 * sizeof(uint32_t))
+	{
+		uint32_t size;
+		std::memcpy(&size, stream.data(), sizeof(size));
+		if (stream.size() < 3 * sizeof(uint32_t) + size)
+			break;
+
+		std::span<const Byte> packet = Take(stream, 3 * sizeof(uint32_t) + size);
+		if (ParsePacket(packet, parser, version))
+			count++;
+	}
+	return count;
+}
+
+}
+
+TEST_CASE( "BlowfishDecryptBenchmark" )
+{
+	const std::optional<EncryptedStream> stream = ReadEncryptedStream(GetReplay(ReferenceReplay));
+	REQUIRE(stream);
+
+	REQUIRE(Decrypt(stream->Data) == DecryptBlockwise(stream->Data));
+
+	BENCHMARK("DecryptBlock " + std::to_string(stream->Data.size() / 1024) + " KiB")
+	{
+		return DecryptBlockwise(stream->Data);
+	};
+
+	BENCHMARK("DecryptCbcLike " + std::to_string(stream->Data.size() / 1024) + " KiB")
+	{
+		return Decrypt(stream->Data);
+	};
+}
+
+TEST_CASE( "ZlibInflateBenchmark" )
+{
+	const std::optional<EncryptedStream> stream = ReadEncryptedStream(GetReplay(ReferenceReplay));
+	REQUIRE(stream);
+	const std::vector<Byte> compressed = Decrypt(stream->Data);
+	REQUIRE(Zlib::Inflate(compressed).size() == stream->DecompressedSize);
+
+	BENCHMARK("Inflate " + std::to_string(stream->DecompressedSize / 1024) + " KiB")
+	{
+		return Zlib::Inflate(compressed);
+	};
+
+	BENCHMARK("Inflate with size hint " + std::to_string(stream->DecompressedSize / 1024) + " KiB")
+	{
+		return Zlib::Inflate(compressed, true, stream->DecompressedSize);
+	};
+
+	std::vector<Byte> buffer(stream->DecompressedSize);
+	Zlib::Inflater inflater;
+	BENCHMARK("InflateAll into buffer " + std::to_string(stream->DecompressedSize / 1024) + " KiB")
+	{
+		return inflater.InflateAll(compressed, buffer);
+	};
+}
+
+TEST_CASE( "ParseScriptsBenchmark" )
+{
+	std::vector<Version> versions;
+	for (const fs::path& path : GetReplays())
+	{
+		ReplayResult<Replay> replay = Replay::FromFile(path, GetGameFilePath());
+		REQUIRE(replay);
+		if (std::ranges::find(versions, replay->Meta.ClientVersionFromExe) == versions.end())
+			versions.emplace_back(replay->Meta.ClientVersionFromExe);
+	}
+
+	for (const Version& version : versions)
+	{
+		REQUIRE_FALSE(ParseScripts(version, GetGameFilePath()).empty());
+		BENCHMARK("ParseScripts " + version.ToString())
+		{
+			return ParseScripts(version, GetGameFilePath());
+		};
+	}
+}
+
+TEST_CASE( "ParsePacketBenchmark" )
+{
+	ReplayResult<Replay> replay = Replay::FromFile(GetReplay(ReferenceReplay), GetGameFilePath());
+	REQUIRE(replay);
+
+	const std::optional<EncryptedStream> stream = ReadEncryptedStream(GetReplay(ReferenceReplay));
+	REQUIRE(stream);
+	const std::vector<Byte> decoded = Zlib::Inflate(Decrypt(stream->Data));
+	const Version version = replay->Meta.ClientVersionFromExe;
+	REQUIRE(ParsePackets(decoded, replay->Specs, version) == replay->Packets.size());
+
+	BENCHMARK("ParsePacket " + std::to_string(replay->Packets.size()) + " packets")
+	{
+		return ParsePackets(decoded, replay->Specs, version);
+	};
+}
+
+TEST_CASE( "ParseValueBenchmark" )
+{
+	const std::vector<std::pair<std::string, ArgType>> types =
+	{
+		{ "Float32", PrimitiveType{ BasicType::Float32 } },
+		{ "Vector3", PrimitiveType{ BasicType::Vector3 } },
+		{ "String", PrimitiveType{ BasicType::String } },
+		{ "Array<Uint32>", ArrayType{ std::make_shared<ArgType>(PrimitiveType{ BasicType::Uint32 }), {} } },
+		{ "FixedDict", FixedDictType
+			{
+				.AllowNone = true,
+				.Properties =
+				{
+					{ "id", std::make_shared<ArgType>(PrimitiveType{ BasicType::Int64 }) },
+					{ "name", std::make_shared<ArgType>(PrimitiveType{ BasicType::String }) },
+					{ "values", std::make_shared<ArgType>(ArrayType{ std::make_shared<ArgType>(PrimitiveType{ BasicType::Float32 }), 4 }) },
+				},
+			}
+		},
+	};
+
+	const std::vector<std::vector<Byte>> encoded =
+	{
+		{ 0x00, 0x00, 0x80, 0x3F },
+		{ 0x00, 0x00, 0x80, 0x3F, 0x00, 0x00, 0x00, 0x40, 0x00, 0x00, 0x40, 0x40 },
+		{ 0x0C, 'r', 'e', 'c', 'e', 'i', 'v', 'e', 'D', 'a', 'm', 'a', 'g' },
+		{ 0x04, 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00 },
+		{
+			0x01,
+			0x2A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x04, 'n', 'a', 'm', 'e',
+			0x00, 0x00, 0x80, 0x3F, 0x00, 0x00, 0x00, 0x40, 0x00, 0x00, 0x40, 0x40, 0x00, 0x00, 0x80, 0x40,
+		},
+	};
+
+	// values are parsed in batches, like the arguments of the method packets in a replay
+	constexpr size_t count = 1000;
+
+	for (size_t i = 0; i < types.size(); i++)
+	{
+		const auto& [name, type] = types[i];
+		const TypeProgram program = CompileType(type);
+
+		std::span<const Byte> data = encoded[i];
+		std::pmr::monotonic_buffer_resource check;
+		REQUIRE(ParseValue(data, type, &check));
+		REQUIRE(data.empty());
+
+		BENCHMARK("ParseValue " + name)
+		{
+			std::pmr::monotonic_buffer_resource arena;
+			size_t parsed = 0;
+			for (size_t n = 0; n < count; n++)
+			{
+				std::span<const Byte> value = encoded[i];
+				parsed += ParseValue(value, type, &arena)->index();
+			}
+			return parsed;
+		};
+
+		BENCHMARK("DecodeValue " + name)
+		{
+			std::pmr::monotonic_buffer_resource arena;
+			size_t decoded = 0;
+			for (size_t n = 0; n < count; n++)
+			{
+				std::span<const Byte> value = encoded[i];
+				decoded += DecodeValue(program, value, &arena)->index();
+			}
+			return decoded;
+		};
+	}
+}
+
+TEST_CASE( "ReplayAnalyzeBenchmark" )
+{
+	for (const fs::path& path : GetReplays())
+	{
+		ReplayResult<Replay> replay = Replay::FromFile(path, GetGameFilePath());
+		REQUIRE(replay);
+		REQUIRE(replay->Analyze());
+
+		BENCHMARK("Analyze " + path.filename().string())
+		{
+			return replay->Analyze();
+		};
+
+		StreamBuffers buffers;
+		BENCHMARK("AnalyzeReplay " + path.filename().string())
+		{
+			return AnalyzeReplay(path, GetGameFilePath(), buffers);
+		};
+
+		StreamBuffers parallelBuffers;
+		parallelBuffers.ParallelDecrypt = true;
+		BENCHMARK("AnalyzeReplay parallel decrypt " + path.filename().string())
+		{
+			return AnalyzeReplay(path, GetGameFilePath(), parallelBuffers);
+		};
+	}
+}
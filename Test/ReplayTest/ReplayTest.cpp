@@ -9,16 +9,22 @@
 
 #include "ReplayParser/GameFiles.hpp"
 #include "ReplayParser/ReplayParser.hpp"
+#include "ReplayParser/SummaryCache.hpp"
+#include "ReplayParser/TypeProgram.hpp"
+#include "ReplayParser/Types.hpp"
 
 #include <catch2/catch_all.hpp>
 
 #include <filesystem>
+#include <memory>
+#include <memory_resource>
 #include <numeric>
 #include <optional>
 #include <string>
 #include <vector>
 
 
+using PotatoAlert::Core::Byte;
 using PotatoAlert::Core::GetModuleRootPath;
 using PotatoAlert::Core::Result;
 using PotatoAlert::Core::Version;
@@ -121,6 +127,128 @@ TEST_CASE( "ReplayTest" )
 	REQUIRE(result8->Achievements.size() == 2);
 }
 
+TEST_CASE( "ReplayStreamTest" )
+{
+	const fs::path gameFilePath = GetModuleRootPath().value() / "ReplayVersions";
+	const fs::path replayPath = GetReplay("20201107_155356_PISC110-Venezia_19_OC_prey.wowsreplay");
+
+	size_t packetCount = 0;
+	ReplayResult<Replay> res = Replay::Stream(replayPath, gameFilePath, [&packetCount](const Replay&, const PacketType&) -> ReplayResult<void>
+	{
+		packetCount++;
+		return {};
+	});
+	REQUIRE(res);
+	REQUIRE(res->Meta.Name == "12x12");
+	REQUIRE(res->Packets.empty());
+	REQUIRE(packetCount == 153376);
+
+	PacketInterest interest;
+	interest.Packets = { PacketBaseType::EntityMethod };
+	interest.Methods = { InternName("receiveDamageStat") };
+	size_t methodCount = 0;
+	res = Replay::Stream(replayPath, gameFilePath, [&methodCount](const Replay&, const PacketType& packet) -> ReplayResult<void>
+	{
+		if (const EntityMethodPacket* method = std::get_if<EntityMethodPacket>(&packet))
+		{
+			REQUIRE(method->MethodName == "receiveDamageStat");
+			REQUIRE(method->MethodNameId == InternName("receiveDamageStat"));
+			methodCount++;
+		}
+		return {};
+	}, interest);
+	REQUIRE(res);
+	REQUIRE(methodCount > 0);
+
+	ReplayResult<ReplaySummary> streamed = AnalyzeReplay(replayPath, gameFilePath);
+	REQUIRE(streamed);
+	ReplayResult<Replay> replay = Replay::FromFile(replayPath, gameFilePath);
+	REQUIRE(replay);
+	ReplayResult<ReplaySummary> stored = replay->Analyze();
+	REQUIRE(stored);
+	REQUIRE(streamed->Hash == stored->Hash);
+	REQUIRE(streamed->Outcome == stored->Outcome);
+	REQUIRE(streamed->DamageDealt == stored->DamageDealt);
+	REQUIRE(streamed->DamageTaken == stored->DamageTaken);
+	REQUIRE(streamed->Ribbons == stored->Ribbons);
+	REQUIRE(streamed->Achievements == stored->Achievements);
+
+	// buffers reused for another replay in between give the same result
+	StreamBuffers buffers;
+	ReplayResult<ReplaySummary> first = AnalyzeReplay(replayPath, gameFilePath, buffers);
+	REQUIRE(first);
+	ReplayResult<ReplaySummary> other = AnalyzeReplay(GetReplay("20210914_212320_PRSC610-Smolensk_25_sea_hope.wowsreplay"), gameFilePath, buffers);
+	REQUIRE(other);
+	REQUIRE(other->Hash != first->Hash);
+	ReplayResult<ReplaySummary> second = AnalyzeReplay(replayPath, gameFilePath, buffers);
+	REQUIRE(second);
+	REQUIRE(second->Hash == stored->Hash);
+	REQUIRE(second->DamageDealt == stored->DamageDealt);
+	REQUIRE(second->Ribbons == stored->Ribbons);
+	REQUIRE(second->Achievements == stored->Achievements);
+
+	// decrypting the whole stream on all cores first gives the same result
+	StreamBuffers parallelBuffers;
+	parallelBuffers.ParallelDecrypt = true;
+	ReplayResult<ReplaySummary> parallel = AnalyzeReplay(replayPath, gameFilePath, parallelBuffers);
+	REQUIRE(parallel);
+	REQUIRE(parallel->Hash == stored->Hash);
+	REQUIRE(parallel->DamageDealt == stored->DamageDealt);
+	REQUIRE(parallel->Ribbons == stored->Ribbons);
+	REQUIRE(parallel->Achievements == stored->Achievements);
+}
+
+TEST_CASE( "ReplayMetaTest" )
+{
+	const fs::path gameFilePath = GetModuleRootPath().value() / "ReplayVersions";
+	const fs::path replayPath = GetReplay("20201107_155356_PISC110-Venezia_19_OC_prey.wowsreplay");
+
+	ReplayResult<Replay> replay = Replay::FromFile(replayPath, gameFilePath);
+	REQUIRE(replay);
+
+	ReplayResult<std::string> metaString = ReadMetaString(replayPath);
+	REQUIRE(metaString);
+	REQUIRE(metaString.value() == replay->MetaString);
+
+	ReplayResult<ReplayMeta> meta = ReplayMeta::ReadFromFile(replayPath);
+	REQUIRE(meta);
+	REQUIRE(meta->Name == "12x12");
+	REQUIRE(meta->DateTime == "07.11.2020 15:53:56");
+	REQUIRE(meta->ClientVersionFromExe == replay->Meta.ClientVersionFromExe);
+	REQUIRE(meta->PlayerName == replay->Meta.PlayerName);
+	REQUIRE(meta->Vehicles.size() == replay->Meta.Vehicles.size());
+
+	REQUIRE_FALSE(ReadMetaString(GetReplay("does_not_exist.wowsreplay")));
+}
+
+TEST_CASE( "ReplayLayoutTest" )
+{
+	// signature, two blocks, a meta of 2 bytes, one block of 1 byte, then the decompressed and stream size of 8 stream bytes
+	const std::vector<Byte> bytes =
+	{
+		0x12, 0x32, 0x34, 0x11, 0x02, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, '{', '}',
+		0x01, 0x00, 0x00, 0x00, 0xFF,
+		0x20, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00,
+		0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+	};
+
+	const ReplayResult<ReplayLayout> layout = ReadLayout(bytes);
+	REQUIRE(layout);
+	REQUIRE(layout->Meta.size() == 2);
+	REQUIRE(layout->Meta[0] == '{');
+	REQUIRE(layout->DecompressedSize == 32);
+	REQUIRE(layout->Stream.size() == 8);
+	REQUIRE(layout->Stream[0] == 0x01);
+
+	// no block at all has to fail instead of walking 2^32 - 1 blocks
+	std::vector<Byte> noBlocks = bytes;
+	noBlocks[4] = 0x00;
+	REQUIRE_FALSE(ReadLayout(noBlocks));
+
+	REQUIRE_FALSE(ReadLayout(std::span(bytes).first(bytes.size() - 1)));
+	REQUIRE_FALSE(ReadLayout(std::span(bytes).first(16)));
+}
+
 TEST_CASE( "ReplayGameFileTest" )
 {
 	const fs::path gameFilePath = GetModuleRootPath().value() / "ReplayVersions";
@@ -139,3 +267,220 @@ TEST_CASE( "ReplayGameFileTest" )
 	REQUIRE(spec[0].BaseProperties.size() == 1);
 	REQUIRE(spec[0].Name == "Avatar");
 }
+
+TEST_CASE( "ReplayGameFileCacheTest" )
+{
+	const fs::path gameFilePath = GetModuleRootPath().value() / "ReplayVersions";
+
+	const std::shared_ptr<const std::vector<EntitySpec>> specs = GetEntitySpecs(Version(0, 10, 8, 0), gameFilePath);
+	REQUIRE(specs);
+	REQUIRE(specs == GetEntitySpecs(Version(0, 10, 8, 0), gameFilePath));
+	REQUIRE(fs::exists(gameFilePath / "0.10.8.0" / "scripts.bin"));
+
+	const std::vector<EntitySpec> parsed = ParseScripts(Version(0, 10, 8, 0), gameFilePath);
+	REQUIRE(specs->size() == parsed.size());
+	for (size_t i = 0; i < parsed.size(); i++)
+	{
+		REQUIRE((*specs)[i].Name == parsed[i].Name);
+		REQUIRE((*specs)[i].ClientMethods.size() == parsed[i].ClientMethods.size());
+		REQUIRE((*specs)[i].AllProperties.size() == parsed[i].AllProperties.size());
+		REQUIRE((*specs)[i].ClientProperties.size() == parsed[i].ClientProperties.size());
+		for (size_t j = 0; j < parsed[i].ClientMethods.size(); j++)
+		{
+			REQUIRE((*specs)[i].ClientMethods[j].Id == parsed[i].ClientMethods[j].Id);
+			REQUIRE(parsed[i].ClientMethods[j].Id == InternName(parsed[i].ClientMethods[j].Name));
+		}
+	}
+
+	REQUIRE(GetEntitySpecs(Version(0, 1, 0, 0), gameFilePath) == nullptr);
+}
+
+TEST_CASE( "ReplaySummaryCacheTest" )
+{
+	const fs::path gameFilePath = GetModuleRootPath().value() / "ReplayVersions";
+	const fs::path replayPath = GetReplay("20201107_155356_PISC110-Venezia_19_OC_prey.wowsreplay");
+	const fs::path cachePath = GetModuleRootPath().value().remove_filename() / "summaries.bin";
+	const fs::path copyPath = GetModuleRootPath().value().remove_filename() / "copy.wowsreplay";
+	fs::remove(cachePath);
+	fs::remove(copyPath);
+
+	ReplayResult<ReplaySummary> summary = AnalyzeReplay(replayPath, gameFilePath);
+	REQUIRE(summary);
+
+	{
+		SummaryCache cache(cachePath);
+		REQUIRE_FALSE(cache.Find(replayPath));
+		cache.Insert(replayPath, summary.value());
+		REQUIRE(cache.Find(replayPath));
+		cache.Save();
+	}
+	REQUIRE(fs::exists(cachePath));
+
+	SummaryCache cache(cachePath);
+	const std::optional<ReplaySummary> cached = cache.Find(replayPath);
+	REQUIRE(cached);
+	REQUIRE(cached->Hash == summary->Hash);
+	REQUIRE(cached->Outcome == summary->Outcome);
+	REQUIRE(cached->DamageDealt == summary->DamageDealt);
+	REQUIRE(cached->Ribbons == summary->Ribbons);
+	REQUIRE(cached->Achievements == summary->Achievements);
+
+	// a copy is only found by the hash of its meta
+	fs::copy_file(replayPath, copyPath);
+	REQUIRE_FALSE(cache.Find(copyPath));
+	REQUIRE(cache.Find(copyPath, summary->Hash));
+	REQUIRE_FALSE(cache.Find(copyPath, "other"));
+
+	// the entries of deleted replays are dropped when saving
+	cache.Insert(copyPath, summary.value());
+	REQUIRE(cache.Size() == 2);
+	fs::remove(copyPath);
+	cache.Save();
+	REQUIRE(cache.Size() == 1);
+	REQUIRE(SummaryCache(cachePath).Size() == 1);
+
+	// the hash finds the remaining replay again
+	fs::copy_file(replayPath, copyPath);
+	REQUIRE(cache.Find(copyPath, summary->Hash));
+
+	fs::remove(cachePath);
+	fs::remove(copyPath);
+}
+
+TEST_CASE( "ReplayArgValueTest" )
+{
+	const ArgType type = FixedDictType
+	{
+		.AllowNone = true,
+		.Properties =
+		{
+			{ "count", std::make_shared<ArgType>(PrimitiveType{ BasicType::Uint16 }) },
+			{ "name", std::make_shared<ArgType>(PrimitiveType{ BasicType::String }) },
+		},
+	};
+
+	std::pmr::monotonic_buffer_resource arena;
+
+	const std::vector<Byte> bytes = { 0x01, 0x2A, 0x00, 0x03, 'a', 'b', 'c' };
+	std::span<const Byte> data = bytes;
+	const std::optional<ArgValue> parsed = ParseValue(data, type, &arena);
+	REQUIRE(parsed);
+	REQUIRE(data.empty());
+
+	const ArgValue& value = parsed.value();
+	const ArgDict* dict = std::get_if<ArgDict>(&value);
+	REQUIRE(dict);
+	REQUIRE(dict->Values.size() == 2);
+	REQUIRE(dict->contains("count"));
+	REQUIRE_FALSE(dict->contains("missing"));
+	REQUIRE(std::get<uint16_t>(dict->at("count")) == 42);
+	REQUIRE(std::get<ArgString>(dict->at("name")) == "abc");
+	REQUIRE(std::get<ArgString>(dict->at("name")).get_allocator().resource() == &arena);
+
+	std::pmr::monotonic_buffer_resource other;
+	const ArgValue copy = CopyValue(value, &other);
+	REQUIRE(std::get<ArgString>(std::get<ArgDict>(copy).at("name")).get_allocator().resource() == &other);
+
+	const std::vector<Byte> none = { 0x00 };
+	data = none;
+	const std::optional<ArgValue> noneValue = ParseValue(data, type, &arena);
+	REQUIRE(noneValue);
+	REQUIRE(std::get<ArgDict>(noneValue.value()).Values.empty());
+	REQUIRE_FALSE(std::get<ArgDict>(noneValue.value()).contains("count"));
+
+	data = std::span(bytes).first(5);
+	REQUIRE_FALSE(ParseValue(data, type, &arena));
+}
+
+TEST_CASE( "ReplayTypeProgramTest" )
+{
+	const std::vector<ArgType> types =
+	{
+		PrimitiveType{ BasicType::Int32 },
+		ArrayType{ std::make_shared<ArgType>(PrimitiveType{ BasicType::Float32 }), 2 },
+		FixedDictType
+		{
+			.AllowNone = false,
+			.Properties =
+			{
+				{ "id", std::make_shared<ArgType>(PrimitiveType{ BasicType::Uint8 }) },
+				{ "values", std::make_shared<ArgType>(ArrayType{ std::make_shared<ArgType>(PrimitiveType{ BasicType::Uint16 }), {} }) },
+			},
+		},
+	};
+
+	const TypeProgram fixed = CompileTypes(std::span(types).first(2));
+	REQUIRE(fixed.IsFixedSize());
+	REQUIRE(fixed.Size == 12);
+
+	const TypeProgram program = CompileTypes(types);
+	REQUIRE_FALSE(program.IsFixedSize());
+
+	const std::vector<Byte> bytes =
+	{
+		0x07, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x80, 0x3F, 0x00, 0x00, 0x00, 0x40,
+		0x05, 0x02, 0x01, 0x00, 0x02, 0x00,
+	};
+
+	std::pmr::monotonic_buffer_resource arena;
+	std::span<const Byte> data = bytes;
+	std::vector<ArgValue> values;
+	REQUIRE(DecodeValues(program, data, &arena, values));
+	REQUIRE(data.empty());
+	REQUIRE(values.size() == 3);
+	REQUIRE(std::get<int32_t>(values[0]) == 7);
+	REQUIRE(std::get<float>(std::get<ArgArray>(values[1])[1]) == 2.0f);
+	const ArgDict& dict = std::get<ArgDict>(values[2]);
+	REQUIRE(std::get<uint8_t>(dict.at("id")) == 5);
+	REQUIRE(std::get<ArgArray>(dict.at("values")).size() == 2);
+
+	// skipping and decoding a program has to consume exactly what decoding the type tree does
+	data = bytes;
+	for (size_t i = 0; i < types.size(); i++)
+	{
+		const TypeProgram single = CompileType(types[i]);
+		std::span<const Byte> skipped = data;
+		REQUIRE(SkipValue(single, skipped));
+		std::span<const Byte> decoded = data;
+		const std::optional<ArgValue> value = DecodeValue(single, decoded, &arena);
+		const std::optional<ArgValue> parsed = ParseValue(data, types[i], &arena);
+		REQUIRE(skipped.size() == data.size());
+		REQUIRE(decoded.size() == data.size());
+		REQUIRE(value);
+		REQUIRE(parsed);
+		REQUIRE(value->index() == parsed->index());
+	}
+	REQUIRE(data.empty());
+
+	// every truncation of the data has to be reported, instead of leaving the following values misaligned
+	for (size_t size = 0; size < bytes.size(); size++)
+	{
+		std::span<const Byte> truncated = std::span(bytes).first(size);
+		bool skipped = true;
+		for (const ArgType& type : types)
+		{
+			skipped = skipped && SkipValue(CompileType(type), truncated);
+		}
+		REQUIRE_FALSE(skipped);
+
+		values.clear();
+		truncated = std::span(bytes).first(size);
+		REQUIRE_FALSE(DecodeValues(program, truncated, &arena, values));
+
+		truncated = std::span(bytes).first(size);
+		bool parsed = true;
+		for (const ArgType& type : types)
+		{
+			parsed = parsed && ParseValue(truncated, type, &arena).has_value();
+		}
+		REQUIRE_FALSE(parsed);
+	}
+
+	// types that are not parsed take no bytes in both decoders, even without any data left
+	const ArgType tuple = TupleType{};
+	std::span<const Byte> empty;
+	REQUIRE(CompileType(tuple).Size == 0);
+	REQUIRE(DecodeValue(CompileType(tuple), empty, &arena));
+	REQUIRE(ParseValue(empty, tuple, &arena));
+}